@@ -0,0 +1,244 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+
+//==============================================================================
+class BatchRenderer::Worker : public juce::Thread
+{
+public:
+    Worker (BatchRenderer& owner, std::unique_ptr<DelaytutorialAudioProcessor> processor)
+        : juce::Thread ("Batch render worker"),
+          mOwner (owner),
+          mProcessor (std::move (processor))
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread (-1);
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            const int index = mOwner.mNextJob++;
+            if (index >= mOwner.mJobs.size())
+                break;
+
+            const Result result = mOwner.render (*mProcessor, mOwner.mJobs.getReference (index));
+            mOwner.mResults.getReference (index) = result;
+
+            if (mOwner.mOnJobDone)
+            {
+                const juce::ScopedLock lock (mOwner.mCallbackLock);
+                mOwner.mOnJobDone (result);
+            }
+        }
+
+        mProcessor->releaseResources();
+    }
+
+private:
+    BatchRenderer& mOwner;
+    std::unique_ptr<DelaytutorialAudioProcessor> mProcessor;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//==============================================================================
+BatchRenderer::BatchRenderer (const Settings& settings)
+    : mSettings (settings)
+{
+    mSettings.blockSize = juce::jmax (16, mSettings.blockSize);
+    mSettings.maxTailSeconds = juce::jmax (0.0, mSettings.maxTailSeconds);
+
+    mFormats.registerFormat (new juce::WavAudioFormat(), true);
+    mFormats.registerFormat (new juce::AiffAudioFormat(), false);
+    mNextJob = 0;
+}
+
+bool BatchRenderer::canRead (const juce::File& file) const
+{
+    return mFormats.findFormatForFileExtension (file.getFileExtension()) != nullptr;
+}
+
+juce::Array<BatchRenderer::Result> BatchRenderer::run (const juce::Array<Job>& jobs, std::function<void (const Result&)> onJobDone)
+{
+    mJobs = jobs;
+    mResults.clearQuick();
+    mResults.resize (jobs.size());
+    mNextJob = 0;
+    mOnJobDone = std::move (onJobDone);
+
+    const int numCores = juce::SystemStats::getNumCpus();
+    const int numWorkers = juce::jlimit (1, juce::jmax (1, jobs.size()), mSettings.numThreads > 0 ? mSettings.numThreads : numCores);
+
+    // The processors are built here, on the message thread, and only then handed over
+    juce::OwnedArray<Worker> workers;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto processor = std::make_unique<DelaytutorialAudioProcessor>();
+
+        if (mSettings.state.getSize() > 0)
+            processor->setStateInformation (mSettings.state.getData(), (int) mSettings.state.getSize());
+
+       #if DELAY_TRACING
+        // Written once below, when no worker is recording any more
+        processor->setWritesTraceOnRelease (false);
+       #endif
+
+        workers.add (new Worker (*this, std::move (processor)));
+    }
+
+    for (auto* worker : workers)
+        worker->startThread();
+
+    auto anyRunning = [&workers]
+    {
+        return std::any_of (workers.begin(), workers.end(), [] (Worker* worker) { return worker->isThreadRunning(); });
+    };
+
+    while (anyRunning())
+    {
+       #if JUCE_MODAL_LOOPS_PERMITTED
+        juce::MessageManager::getInstance()->runDispatchLoopUntil (50);
+       #else
+        juce::Thread::sleep (50);
+       #endif
+    }
+
+    workers.clear();
+    mOnJobDone = nullptr;
+
+   #if DELAY_TRACING
+    TraceRecorder::getInstance().writeChromeTrace (TraceRecorder::getDefaultFile());
+   #endif
+
+    return mResults;
+}
+
+//==============================================================================
+BatchRenderer::Result BatchRenderer::render (DelaytutorialAudioProcessor& processor, const Job& job) const
+{
+    Result result;
+    result.job = job;
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    auto* format = mFormats.findFormatForFileExtension (job.input.getFileExtension());
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader (format != nullptr ? format->createMemoryMappedReader (job.input)
+                                                                                    : nullptr);
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->numChannels == 0)
+    {
+        result.error = "can't read it as WAV or AIFF";
+        return result;
+    }
+
+    const double sampleRate = reader->sampleRate;
+    const juce::int64 length = reader->lengthInSamples;
+    const int blockSize = mSettings.blockSize;
+    result.sampleRate = sampleRate;
+
+    if (! job.output.getParentDirectory().createDirectory())
+    {
+        result.error = "can't create " + job.output.getParentDirectory().getFullPathName();
+        return result;
+    }
+
+    // Written beside the destination and moved over it once complete
+    juce::TemporaryFile temp (job.output);
+    std::unique_ptr<juce::FileOutputStream> stream (temp.getFile().createOutputStream());
+
+    // Keep the input's bit depth where the format can write it
+    const int bitsPerSample = format->getPossibleBitDepths().contains ((int) reader->bitsPerSample) ? (int) reader->bitsPerSample : 24;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (stream != nullptr && stream->openedOk())
+        writer.reset (format->createWriterFor (stream.get(), sampleRate, 2, bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+    {
+        result.error = "can't write " + job.output.getFullPathName();
+        return result;
+    }
+
+    stream.release();   // The writer owns it now
+
+    processor.setNonRealtime (true);
+    processor.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+    processor.reset();
+
+    const int latency = processor.getLatencySamples();
+    const juce::int64 quietLength = (juce::int64) (processor.getMaxDelaySeconds() * sampleRate);
+    const juce::int64 maxTail = (juce::int64) (mSettings.maxTailSeconds * sampleRate);
+
+    juce::AudioBuffer<float> block (2, blockSize);
+    juce::MidiBuffer midi;
+    juce::int64 position = 0;
+    juce::int64 quiet = 0;
+    int latencyLeft = latency;
+
+    for (;;)
+    {
+        // Past the end the input is silence. A mono file plays on both channels
+        block.clear();
+        const int numToRead = (int) juce::jlimit ((juce::int64) 0, (juce::int64) blockSize, length - position);
+
+        if (numToRead > 0)
+        {
+            const juce::Range<juce::int64> needed (position, position + numToRead);
+
+            if (! reader->getMappedSection().contains (needed)
+                && ! reader->mapSectionOfFile ({ position, juce::jmin (length, position + MAP_WINDOW) }))
+            {
+                result.error = "can't map " + job.input.getFullPathName();
+                return result;
+            }
+
+            reader->read (&block, 0, numToRead, position, true, true);
+        }
+
+        processor.processBlock (block, midi);
+        position += blockSize;
+
+        // The first latency samples come before the input's first sample
+        const int skip = juce::jmin (latencyLeft, blockSize);
+        latencyLeft -= skip;
+
+        if (skip < blockSize && ! writer->writeFromAudioSampleBuffer (block, skip, blockSize - skip))
+        {
+            result.error = "can't write " + job.output.getFullPathName();
+            return result;
+        }
+
+        if (position > length)
+        {
+            quiet = block.getMagnitude (0, blockSize) < mSettings.silenceThreshold ? quiet + blockSize : 0;
+
+            if (position >= length + latency && (quiet >= quietLength || position - length >= maxTail))
+                break;
+        }
+    }
+
+    writer.reset();
+
+    if (! temp.overwriteTargetFileWithTemporary())
+    {
+        result.error = "can't replace " + job.output.getFullPathName();
+        return result;
+    }
+
+    result.samplesRendered = position;
+    result.seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    return result;
+}
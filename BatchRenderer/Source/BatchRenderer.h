@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    BatchRenderer.h
+
+    Offline rendering of WAV and AIFF files through the delay engine, spread
+    over worker threads that each run their own processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+//==============================================================================
+/**
+    Every worker owns one DelaytutorialAudioProcessor, created and given the
+    saved state on the calling thread, and takes the next file from a shared
+    counter until none are left. A processor renders in non-realtime mode,
+    so it runs the offline quality tier.
+
+    Files stream through in blocks: the input is memory-mapped MAP_WINDOW
+    samples at a time and the output written block by block, so memory use
+    doesn't grow with file length. Each file starts from silence, whatever
+    engine snapshot the state carries. After the input the engine renders
+    its tail until the output has stayed below the silence threshold for a
+    whole delay buffer, or for at most maxTailSeconds. Output that lags the
+    input by the processor's latency is realigned.
+
+    Results go to a temporary file that replaces the destination only once
+    it is complete.
+*/
+class BatchRenderer
+{
+public:
+    static const int MAP_WINDOW = 1 << 18;      // Samples of input mapped at once
+
+    struct Settings
+    {
+        juce::MemoryBlock state;                // As getStateInformation writes it, empty for the defaults
+        int numThreads = 0;                     // 0 for one per core
+        int blockSize = 512;
+        double maxTailSeconds = 10.0;
+        float silenceThreshold = 3.0e-5f;       // About -90 dBFS
+    };
+
+    struct Job
+    {
+        juce::File input;
+        juce::File output;                      // In the input's format
+    };
+
+    struct Result
+    {
+        Job job;
+        juce::String error;                     // Empty when the file was rendered
+        double sampleRate = 0.0;
+        juce::int64 samplesRendered = 0;        // Input and tail
+        double seconds = 0.0;                   // Wall clock time of the render
+
+        bool succeeded() const noexcept         { return error.isEmpty(); }
+        double getAudioSeconds() const noexcept { return sampleRate > 0.0 ? samplesRendered / sampleRate : 0.0; }
+    };
+
+    explicit BatchRenderer (const Settings& settings);
+
+    /** Whether the file has an extension a reader is registered for. */
+    bool canRead (const juce::File& file) const;
+
+    /** Renders every job and returns when all are done, with the results in job order.
+        onJobDone is called from the workers as each job finishes, one call at a time.
+        Keeps the message loop running meanwhile, for the processors' timers.
+    */
+    juce::Array<Result> run (const juce::Array<Job>& jobs, std::function<void (const Result&)> onJobDone = {});
+
+private:
+    class Worker;
+
+    Result render (DelaytutorialAudioProcessor& processor, const Job& job) const;
+
+    Settings mSettings;
+    juce::AudioFormatManager mFormats;
+
+    // Shared with the workers for the length of a run
+    juce::Array<Job> mJobs;
+    juce::Array<Result> mResults;
+    std::atomic<int> mNextJob;
+    std::function<void (const Result&)> mOnJobDone;
+    juce::CriticalSection mCallbackLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchRenderer)
+};
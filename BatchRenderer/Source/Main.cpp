@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command line front end of the batch renderer: applies one saved plugin
+    state to every WAV or AIFF file given, or found in the folders given.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BatchRenderer.h"
+
+namespace
+{
+    const char* const USAGE =
+        "Usage: delay-3-batch --output=<folder> [options] <files or folders>...\n"
+        "\n"
+        "  --state=<file>      Plugin state to apply, as saved by the host\n"
+        "  --threads=<n>       Worker threads, one per core by default\n"
+        "  --block=<samples>   Block size, 512 by default\n"
+        "  --tail=<seconds>    Longest tail rendered after the input, 10 by default\n"
+        "\n"
+        "Folders are searched recursively and their layout is kept under the output folder.\n";
+
+    void addJobs (const BatchRenderer& renderer, const juce::File& input, const juce::File& outputFolder,
+                  juce::Array<BatchRenderer::Job>& jobs)
+    {
+        if (input.isDirectory())
+        {
+            for (const auto& entry : juce::RangedDirectoryIterator (input, true, "*", juce::File::findFiles))
+            {
+                const juce::File file = entry.getFile();
+
+                if (renderer.canRead (file))
+                    jobs.add ({ file, outputFolder.getChildFile (file.getRelativePathFrom (input)) });
+            }
+        }
+        else
+        {
+            jobs.add ({ input, outputFolder.getChildFile (input.getFileName()) });
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    const juce::String output = args.getValueForOption ("--output");
+
+    if (output.isEmpty() || args.containsOption ("--help|-h"))
+    {
+        std::cout << USAGE;
+        return output.isEmpty() ? 2 : 0;
+    }
+
+    BatchRenderer::Settings settings;
+    settings.numThreads = args.getValueForOption ("--threads").getIntValue();
+    settings.blockSize = args.containsOption ("--block") ? args.getValueForOption ("--block").getIntValue() : 512;
+    settings.maxTailSeconds = args.containsOption ("--tail") ? args.getValueForOption ("--tail").getDoubleValue() : 10.0;
+
+    if (args.containsOption ("--state"))
+    {
+        const juce::File stateFile = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--state"));
+
+        if (! stateFile.loadFileAsData (settings.state))
+        {
+            std::cerr << "Can't read the state file " << stateFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    BatchRenderer renderer (settings);
+    const juce::File outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile (output);
+    juce::Array<BatchRenderer::Job> jobs;
+
+    for (const auto& arg : args.arguments)
+    {
+        if (arg.isOption())
+            continue;
+
+        const juce::File input = arg.resolveAsFile();
+
+        if (! input.exists())
+        {
+            std::cerr << "No such file or folder: " << input.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        addJobs (renderer, input, outputFolder, jobs);
+    }
+
+    if (jobs.isEmpty())
+    {
+        std::cerr << "Nothing to render" << std::endl;
+        return 1;
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+    const auto results = renderer.run (jobs, [] (const BatchRenderer::Result& result)
+    {
+        if (result.succeeded())
+            std::cout << result.job.output.getFullPathName() << ": " << juce::String (result.getAudioSeconds(), 1) << " s in "
+                      << juce::String (result.seconds, 2) << " s" << std::endl;
+        else
+            std::cerr << result.job.input.getFullPathName() << ": " << result.error << std::endl;
+    });
+
+    const double wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    double audioSeconds = 0.0;
+    int numFailed = 0;
+
+    for (const auto& result : results)
+    {
+        audioSeconds += result.getAudioSeconds();
+
+        if (! result.succeeded())
+            ++numFailed;
+    }
+
+    // Aggregate throughput over every worker, against the wall clock
+    std::cout << results.size() - numFailed << " of " << results.size() << " files, "
+              << juce::String (audioSeconds, 1) << " s of audio in " << juce::String (wallSeconds, 2) << " s, "
+              << juce::String (wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0, 1) << "x realtime" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    CoefficientDesigner.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientDesigner.h"
+#include "TraceZones.h"
+
+//==============================================================================
+void EngineCoefficients::design (const Inputs& inputs, EngineCoefficients& result)
+{
+    const double sampleRate = inputs.sampleRate;
+
+    result.inputs = inputs;
+    result.damping = DampingFilterBank::design (inputs.lowCutHz, inputs.highCutHz, sampleRate);
+
+    static const float feedbackMatrix[NUM_LINES][NUM_LINES] = {
+        {0.2f, 0.1f, 0.05f, 0.025f},
+        {0.1f, 0.3f, 0.15f, 0.075f},
+        {0.05f, 0.15f, 0.4f, 0.2f},
+        {0.025f, 0.075f, 0.2f, 0.5f}
+    };
+
+    std::copy (&feedbackMatrix[0][0], &feedbackMatrix[0][0] + NUM_LINES * NUM_LINES, &result.feedbackMatrix[0][0]);
+
+    // Early reflections, in seconds, after a 20 ms predelay
+    static const float reflectionDelays[NUM_REFLECTIONS] = {0.05f, 0.10f, 0.15f, 0.20f, 0.25f, 0.30f, 0.35f, 0.40f};
+    static const float reflectionGains[NUM_REFLECTIONS] = {0.6f, 0.5f, 0.4f, 0.3f, 0.2f, 0.1f, 0.05f, 0.025f};
+    const int predelaySamples = static_cast<int> (0.02f * sampleRate);
+
+    for (int i = 0; i < NUM_REFLECTIONS; ++i)
+    {
+        result.reflectionDelaySamples[i] = static_cast<int> (reflectionDelays[i] * sampleRate) + predelaySamples;
+        result.reflectionGains[i] = reflectionGains[i];
+
+        // Exponentially decreasing cutoff frequency
+        float cutoff = 20000.0f * std::pow (0.99f, i);
+        float w0 = 2.0f * M_PI * cutoff / sampleRate;
+        result.reflectionFilterCoeffs[i] = std::exp (-w0);
+    }
+}
+
+//==============================================================================
+CoefficientDesignThread::CoefficientDesignThread()
+    : juce::Thread ("Coefficient design")
+{
+    startThread();
+    startTimer (RECLAIM_INTERVAL_MS);
+}
+
+CoefficientDesignThread::~CoefficientDesignThread()
+{
+    stopTimer();
+    stopThread (1000);
+}
+
+void CoefficientDesignThread::add (CoefficientDesigner* designer)
+{
+    const juce::ScopedLock lock (mLock);
+    mDesigners.add (designer);
+}
+
+void CoefficientDesignThread::remove (CoefficientDesigner* designer)
+{
+    // Once this returns the worker is not inside the designer and never will be again
+    const juce::ScopedLock lock (mLock);
+    mDesigners.removeFirstMatchingValue (designer);
+}
+
+void CoefficientDesignThread::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (POLL_INTERVAL_MS);
+
+        const juce::ScopedLock lock (mLock);
+
+        for (auto* designer : mDesigners)
+            designer->designPendingRequest();
+    }
+}
+
+void CoefficientDesignThread::timerCallback()
+{
+    const juce::ScopedLock lock (mLock);
+
+    for (auto* designer : mDesigners)
+        designer->reclaimRetired();
+}
+
+//==============================================================================
+CoefficientDesigner::CoefficientDesigner()
+{
+    mSampleRate = 44100.0;
+    mDesignedRequest = 0;
+    mRequestedLowCut = DampingFilterBank::MIN_LOW_CUT;
+    mRequestedHighCut = DampingFilterBank::MAX_HIGH_CUT;
+    mRequestCount = 0;
+    mLastLowCut = DampingFilterBank::MIN_LOW_CUT;
+    mLastHighCut = DampingFilterBank::MAX_HIGH_CUT;
+    mPending = nullptr;
+    mNumRetired = 0;
+
+    mCurrent = new EngineCoefficients();
+    EngineCoefficients::design ({ mSampleRate, mLastLowCut, mLastHighCut }, *mCurrent);
+
+    mThread->add (this);
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    mThread->remove (this);
+
+    reclaimRetired();
+    delete mPending.exchange (nullptr);
+    delete mCurrent;
+}
+
+void CoefficientDesigner::prepare (const EngineCoefficients::Inputs& inputs)
+{
+    const juce::ScopedLock lock (mDesignLock);
+
+    auto* set = new EngineCoefficients();
+    EngineCoefficients::design (inputs, *set);
+
+    delete mPending.exchange (nullptr);
+    delete mCurrent;
+    mCurrent = set;
+
+    mSampleRate = inputs.sampleRate;
+    mLastLowCut = inputs.lowCutHz;
+    mLastHighCut = inputs.highCutHz;
+    mRequestedLowCut = inputs.lowCutHz;
+    mRequestedHighCut = inputs.highCutHz;
+    mDesignedRequest = mRequestCount.load();
+}
+
+void CoefficientDesigner::request (float lowCutHz, float highCutHz) noexcept
+{
+    if (lowCutHz == mLastLowCut && highCutHz == mLastHighCut)
+        return;
+
+    mLastLowCut = lowCutHz;
+    mLastHighCut = highCutHz;
+    mRequestedLowCut.store (lowCutHz, std::memory_order_relaxed);
+    mRequestedHighCut.store (highCutHz, std::memory_order_relaxed);
+    mRequestCount.fetch_add (1, std::memory_order_release);
+}
+
+const EngineCoefficients& CoefficientDesigner::acquire() noexcept
+{
+    if (mPending.load (std::memory_order_relaxed) == nullptr || ! mRetiredLock.tryEnter())
+        return *mCurrent;
+
+    if (mNumRetired < MAX_RETIRED)
+    {
+        if (auto* set = mPending.exchange (nullptr, std::memory_order_acquire))
+        {
+            mRetired[mNumRetired++] = mCurrent;
+            mCurrent = set;
+        }
+    }
+
+    mRetiredLock.exit();
+    return *mCurrent;
+}
+
+void CoefficientDesigner::designNow()
+{
+    designPendingRequest();
+
+    // Offline the audio thread may free memory itself
+    if (auto* set = mPending.exchange (nullptr, std::memory_order_acquire))
+    {
+        delete mCurrent;
+        mCurrent = set;
+    }
+}
+
+//==============================================================================
+void CoefficientDesigner::designPendingRequest()
+{
+    const juce::ScopedLock lock (mDesignLock);
+
+    const int requestCount = mRequestCount.load (std::memory_order_acquire);
+
+    if (requestCount == mDesignedRequest)
+        return;
+
+    // Values torn by a request arriving now are fixed by designing again for it
+    mDesignedRequest = requestCount;
+    DELAY_TRACE_ZONE("design coefficients");
+
+    auto* set = new EngineCoefficients();
+    EngineCoefficients::design ({ mSampleRate,
+                                  mRequestedLowCut.load (std::memory_order_relaxed),
+                                  mRequestedHighCut.load (std::memory_order_relaxed) }, *set);
+
+    // A set the audio thread never picked up was never seen by it
+    delete mPending.exchange (set, std::memory_order_acq_rel);
+}
+
+void CoefficientDesigner::reclaimRetired()
+{
+    EngineCoefficients* retired[MAX_RETIRED];
+    int numRetired;
+
+    {
+        const juce::SpinLock::ScopedLockType lock (mRetiredLock);
+        numRetired = mNumRetired;
+        std::copy (mRetired, mRetired + numRetired, retired);
+        mNumRetired = 0;
+    }
+
+    for (int i = 0; i < numRetired; ++i)
+        delete retired[i];
+}
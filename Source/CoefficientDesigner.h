@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    CoefficientDesigner.h
+
+    Designs the engine's filter, reflection and matrix coefficients on a
+    background thread and hands each finished set to the audio thread with
+    a single pointer swap.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DampingFilterBank.h"
+
+//==============================================================================
+/** Everything derived from the sample rate and the cut parameters. Never
+    changed once published, so the audio thread reads it without locking.
+*/
+struct EngineCoefficients
+{
+    static const int NUM_LINES = 4;
+    static const int NUM_REFLECTIONS = 8;
+
+    struct Inputs
+    {
+        double sampleRate;
+        float lowCutHz;
+        float highCutHz;
+    };
+
+    static void design (const Inputs& inputs, EngineCoefficients& result);
+
+    Inputs inputs;
+    DampingFilterBank::Design damping;
+    float feedbackMatrix[NUM_LINES][NUM_LINES];
+    int reflectionDelaySamples[NUM_REFLECTIONS];     // Including the predelay
+    float reflectionFilterCoeffs[NUM_REFLECTIONS];
+    float reflectionGains[NUM_REFLECTIONS];
+};
+
+class CoefficientDesigner;
+
+//==============================================================================
+/**
+    One worker thread for every designer in the process, polling for requests
+    every POLL_INTERVAL_MS, and a timer that frees retired sets on the message
+    thread. Designers register themselves through a SharedResourcePointer.
+*/
+class CoefficientDesignThread : private juce::Thread,
+                                private juce::Timer
+{
+public:
+    static const int POLL_INTERVAL_MS = 5;
+    static const int RECLAIM_INTERVAL_MS = 50;
+
+    CoefficientDesignThread();
+    ~CoefficientDesignThread() override;
+
+    void add (CoefficientDesigner* designer);
+    void remove (CoefficientDesigner* designer);
+
+private:
+    void run() override;
+    void timerCallback() override;
+
+    juce::CriticalSection mLock;
+    juce::Array<CoefficientDesigner*> mDesigners;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CoefficientDesignThread)
+};
+
+//==============================================================================
+/**
+    The audio thread queues a request when a parameter moves; the worker
+    builds a new set and publishes it through mPending, replacing any set the
+    audio thread has not picked up yet. acquire swaps the published set in
+    and moves the one it replaces to a retired list, which the message
+    thread empties. The audio thread only touches atomics and a try-lock,
+    and skips the swap until the next block if the lock is busy or the
+    retired list is full.
+*/
+class CoefficientDesigner
+{
+public:
+    static const int MAX_RETIRED = 64;    // More than the worker can publish between reclaims
+
+    CoefficientDesigner();
+    ~CoefficientDesigner();
+
+    /** Designs for inputs at once and makes them current. Only while the audio
+        thread is stopped, as in prepareToPlay.
+    */
+    void prepare (const EngineCoefficients::Inputs& inputs);
+
+    /** Queues a redesign when the cut frequencies moved. Audio thread, never blocks. */
+    void request (float lowCutHz, float highCutHz) noexcept;
+
+    /** The newest published set, to be used for the rest of the block. Audio thread, never blocks. */
+    const EngineCoefficients& acquire() noexcept;
+
+    /** Designs any queued request on the calling thread and swaps it in. For
+        offline rendering, where a block must see its own parameter changes.
+    */
+    void designNow();
+
+private:
+    friend class CoefficientDesignThread;
+
+    void designPendingRequest();    // Worker thread
+    void reclaimRetired();          // Message thread
+
+    juce::SharedResourcePointer<CoefficientDesignThread> mThread;
+
+    // Held by the worker while designing and by prepare, so nothing designed
+    // for an old sample rate is published after it
+    juce::CriticalSection mDesignLock;
+    double mSampleRate;
+    int mDesignedRequest;
+
+    // Latest request from the audio thread; the count is bumped after the values
+    std::atomic<float> mRequestedLowCut;
+    std::atomic<float> mRequestedHighCut;
+    std::atomic<int> mRequestCount;
+    float mLastLowCut, mLastHighCut;
+
+    std::atomic<EngineCoefficients*> mPending;
+    EngineCoefficients* mCurrent;
+
+    juce::SpinLock mRetiredLock;
+    EngineCoefficients* mRetired[MAX_RETIRED];
+    int mNumRetired;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CoefficientDesigner)
+};
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    DampingFilterBank.cpp
+
+  ==============================================================================
+*/
+
+#include "DampingFilterBank.h"
+
+//==============================================================================
+DampingFilterBank::DampingFilterBank()
+{
+    static_assert (MAX_LANES == KernelDispatch::NUM_LANES, "The kernels run a fixed number of lanes");
+
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+    mNumLanes = MAX_LANES;
+    mLowCutActive = false;
+    mHighCutActive = false;
+    setDesign (design (MIN_LOW_CUT, MAX_HIGH_CUT, 44100.0));
+
+    reset();
+}
+
+void DampingFilterBank::prepare (int numLanes)
+{
+    jassert (numLanes <= MAX_LANES);
+
+    mNumLanes = juce::jmin (numLanes, (int) MAX_LANES);
+    reset();
+}
+
+void DampingFilterBank::reset()
+{
+    for (int lane = 0; lane < MAX_LANES; ++lane)
+    {
+        mLowCutIc1[lane] = 0.0f;
+        mLowCutIc2[lane] = 0.0f;
+        mHighCutIc1[lane] = 0.0f;
+        mHighCutIc2[lane] = 0.0f;
+    }
+}
+
+DampingFilterBank::Design DampingFilterBank::design (float lowCutHz, float highCutHz, double sampleRate)
+{
+    Design d;
+    d.lowCut = designStage (lowCutHz, sampleRate);
+    d.highCut = designStage (highCutHz, sampleRate);
+    d.lowCutActive = lowCutHz > MIN_LOW_CUT;
+    d.highCutActive = highCutHz < MAX_HIGH_CUT;
+    return d;
+}
+
+void DampingFilterBank::setDesign (const Design& newDesign) noexcept
+{
+    mLowCut = newDesign.lowCut;
+    mHighCut = newDesign.highCut;
+
+    const bool lowCutActive = newDesign.lowCutActive;
+    const bool highCutActive = newDesign.highCutActive;
+
+    // A stage coming back in starts from silence rather than a stale state
+    if (lowCutActive && ! mLowCutActive)
+    {
+        std::fill (mLowCutIc1, mLowCutIc1 + MAX_LANES, 0.0f);
+        std::fill (mLowCutIc2, mLowCutIc2 + MAX_LANES, 0.0f);
+    }
+
+    if (highCutActive && ! mHighCutActive)
+    {
+        std::fill (mHighCutIc1, mHighCutIc1 + MAX_LANES, 0.0f);
+        std::fill (mHighCutIc2, mHighCutIc2 + MAX_LANES, 0.0f);
+    }
+
+    mLowCutActive = lowCutActive;
+    mHighCutActive = highCutActive;
+}
+
+DampingFilterBank::Coefficients DampingFilterBank::designStage (double cutoff, double sampleRate)
+{
+    // Zavalishin's trapezoidal SVF with a Butterworth Q
+    cutoff = juce::jlimit (1.0, sampleRate * 0.49, cutoff);
+
+    const double g = std::tan (M_PI * cutoff / sampleRate);
+    const double k = std::sqrt (2.0);
+
+    Coefficients c;
+    c.k = (float) k;
+    c.a1 = (float) (1.0 / (1.0 + g * (g + k)));
+    c.a2 = (float) (g * c.a1);
+    c.a3 = (float) (g * c.a2);
+    return c;
+}
+
+//==============================================================================
+void DampingFilterBank::process (float* lanes) noexcept
+{
+    // Always run the full MAX_LANES width: unused lanes just filter zeros, and a
+    // fixed trip count lets each kernel build emit one vector op per step
+    alignas (32) float x[MAX_LANES];
+
+    for (int lane = 0; lane < MAX_LANES; ++lane)
+        x[lane] = lane < mNumLanes ? lanes[lane] : 0.0f;
+
+    if (mHighCutActive)
+        mKernels->svfHighCut (x, mHighCutIc1, mHighCutIc2, mHighCut.a1, mHighCut.a2, mHighCut.a3);
+
+    if (mLowCutActive)
+        mKernels->svfLowCut (x, mLowCutIc1, mLowCutIc2, mLowCut.k, mLowCut.a1, mLowCut.a2, mLowCut.a3);
+
+    for (int lane = 0; lane < mNumLanes; ++lane)
+        lanes[lane] = x[lane];
+}
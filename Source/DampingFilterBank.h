@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    DampingFilterBank.h
+
+    High- and low-cut damping of the feedback path, every signal it is
+    given run as one batch of TPT state-variable filters.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "KernelDispatch.h"
+
+//==============================================================================
+/**
+    Each lane is one signal, in the processor one channel. The lanes share their
+    coefficients and keep their state in separate arrays, so the per-sample
+    loops run across all lanes at once and compile to plain vector code.
+
+    The bank never designs its own coefficients: design() runs ahead of the
+    audio thread, normally on CoefficientDesigner's thread, and setDesign
+    only copies the result in.
+*/
+class DampingFilterBank
+{
+public:
+    static const int MAX_LANES = 8;
+
+    /** Cutoffs at or beyond these turn the corresponding stage off. */
+    static constexpr float MIN_LOW_CUT = 20.0f;
+    static constexpr float MAX_HIGH_CUT = 20000.0f;
+
+    struct Coefficients
+    {
+        float k, a1, a2, a3;
+    };
+
+    struct Design
+    {
+        Coefficients lowCut, highCut;
+        bool lowCutActive, highCutActive;
+    };
+
+    static Design design (float lowCutHz, float highCutHz, double sampleRate);
+
+    DampingFilterBank();
+
+    void prepare (int numLanes);
+    void reset();
+
+    /** The kernel build the filters run on, see KernelDispatch. */
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    /** Takes over a design. Cheap enough to call every block. */
+    void setDesign (const Design& newDesign) noexcept;
+
+    /** Filters one sample of every lane in place. */
+    void process (float* lanes) noexcept;
+
+    bool isActive() const noexcept  { return mLowCutActive || mHighCutActive; }
+
+    /** Calls visit (data, numBytes) for the filter state of every lane, see EngineSnapshot. */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        visit (mLowCutIc1, sizeof (mLowCutIc1));
+        visit (mLowCutIc2, sizeof (mLowCutIc2));
+        visit (mHighCutIc1, sizeof (mHighCutIc1));
+        visit (mHighCutIc2, sizeof (mHighCutIc2));
+    }
+
+private:
+    static Coefficients designStage (double cutoff, double sampleRate);
+
+    const KernelDispatch::Kernels* mKernels;
+    int mNumLanes;
+
+    bool mLowCutActive;
+    bool mHighCutActive;
+
+    Coefficients mLowCut;
+    Coefficients mHighCut;
+
+    alignas (32) float mLowCutIc1[MAX_LANES];
+    alignas (32) float mLowCutIc2[MAX_LANES];
+    alignas (32) float mHighCutIc1[MAX_LANES];
+    alignas (32) float mHighCutIc2[MAX_LANES];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DampingFilterBank)
+};
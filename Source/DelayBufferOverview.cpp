@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    DelayBufferOverview.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayBufferOverview.h"
+
+//==============================================================================
+DelayBufferOverview::Pyramid::Pyramid (int length)
+    : bufferLength (length)
+{
+    int bins = (length + BASE_BIN_SIZE - 1) / BASE_BIN_SIZE;
+    totalBins = 0;
+
+    for (int level = 0; level < NUM_LEVELS; ++level)
+    {
+        numBins[level] = juce::jmax (1, bins);
+        levelOffset[level] = totalBins;
+        totalBins += numBins[level];
+        bins = (bins + 1) / 2;
+    }
+
+    mins.reset (new std::atomic<float>[totalBins]);
+    maxs.reset (new std::atomic<float>[totalBins]);
+
+    for (int i = 0; i < totalBins; ++i)
+    {
+        mins[i].store (0.0f, std::memory_order_relaxed);
+        maxs[i].store (0.0f, std::memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+DelayBufferOverview::DelayBufferOverview()
+{
+    mAudioPyramid = nullptr;
+    mBufferLength = 0;
+    mWritePosition = 0;
+    mBinMin = 0.0f;
+    mBinMax = 0.0f;
+}
+
+void DelayBufferOverview::prepare (int bufferLength)
+{
+    if (mAudioPyramid == nullptr || mAudioPyramid->bufferLength != bufferLength)
+    {
+        auto pyramid = std::make_shared<Pyramid> (bufferLength);
+        mAudioPyramid = pyramid.get();
+        std::atomic_store (&mPyramid, pyramid);
+    }
+
+    clear();
+    mBufferLength = bufferLength;
+}
+
+void DelayBufferOverview::clear()
+{
+    if (mAudioPyramid != nullptr)
+    {
+        for (int i = 0; i < mAudioPyramid->totalBins; ++i)
+        {
+            mAudioPyramid->mins[i].store (0.0f, std::memory_order_relaxed);
+            mAudioPyramid->maxs[i].store (0.0f, std::memory_order_relaxed);
+        }
+    }
+
+    mWritePosition = 0;
+    mBinMin = 0.0f;
+    mBinMax = 0.0f;
+}
+
+void DelayBufferOverview::write (int position, float sample) noexcept
+{
+    auto* pyramid = mAudioPyramid;
+
+    if (position % BASE_BIN_SIZE == 0)
+    {
+        mBinMin = sample;
+        mBinMax = sample;
+    }
+    else
+    {
+        mBinMin = std::min (mBinMin, sample);
+        mBinMax = std::max (mBinMax, sample);
+    }
+
+    mWritePosition.store (position, std::memory_order_relaxed);
+
+    // Only a finished level 0 bin touches the pyramid
+    if (position % BASE_BIN_SIZE != BASE_BIN_SIZE - 1 && position != pyramid->bufferLength - 1)
+        return;
+
+    int bin = position / BASE_BIN_SIZE;
+    publishBin (0, bin, mBinMin, mBinMax);
+
+    for (int level = 1; level < NUM_LEVELS; ++level)
+    {
+        const int childOffset = pyramid->levelOffset[level - 1];
+        const int firstChild = (bin / 2) * 2;
+        const int lastChild = std::min (firstChild + 1, pyramid->numBins[level - 1] - 1);
+
+        float parentMin = pyramid->mins[childOffset + firstChild].load (std::memory_order_relaxed);
+        float parentMax = pyramid->maxs[childOffset + firstChild].load (std::memory_order_relaxed);
+
+        if (lastChild != firstChild)
+        {
+            parentMin = std::min (parentMin, pyramid->mins[childOffset + lastChild].load (std::memory_order_relaxed));
+            parentMax = std::max (parentMax, pyramid->maxs[childOffset + lastChild].load (std::memory_order_relaxed));
+        }
+
+        bin /= 2;
+        publishBin (level, bin, parentMin, parentMax);
+    }
+}
+
+void DelayBufferOverview::publishBin (int level, int bin, float binMin, float binMax) noexcept
+{
+    const int index = mAudioPyramid->levelOffset[level] + bin;
+    mAudioPyramid->mins[index].store (binMin, std::memory_order_relaxed);
+    mAudioPyramid->maxs[index].store (binMax, std::memory_order_relaxed);
+}
+
+//==============================================================================
+bool DelayBufferOverview::getColumns (int startPosition, int numSamples, float* columnMins, float* columnMaxs, int numColumns) const
+{
+    auto pyramid = std::atomic_load (&mPyramid);
+
+    if (pyramid == nullptr || numColumns <= 0)
+        return false;
+
+    const int length = pyramid->bufferLength;
+    numSamples = juce::jlimit (1, length, numSamples);
+    startPosition = ((startPosition % length) + length) % length;
+
+    const double samplesPerColumn = (double) numSamples / numColumns;
+
+    // Coarsest level whose bins still fit inside one column
+    int level = 0;
+    while (level + 1 < NUM_LEVELS && (double) (BASE_BIN_SIZE << (level + 1)) <= samplesPerColumn)
+        ++level;
+
+    const int binSize = BASE_BIN_SIZE << level;
+    const auto* mins = pyramid->mins.get() + pyramid->levelOffset[level];
+    const auto* maxs = pyramid->maxs.get() + pyramid->levelOffset[level];
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const int columnStart = startPosition + (int) (column * samplesPerColumn);
+        const int columnEnd = std::max (columnStart + 1, startPosition + (int) ((column + 1) * samplesPerColumn));
+
+        float columnMin = std::numeric_limits<float>::max();
+        float columnMax = std::numeric_limits<float>::lowest();
+
+        for (int position = columnStart; position < columnEnd;)
+        {
+            const int wrapped = position % length;
+            const int bin = wrapped / binSize;
+
+            columnMin = std::min (columnMin, mins[bin].load (std::memory_order_relaxed));
+            columnMax = std::max (columnMax, maxs[bin].load (std::memory_order_relaxed));
+
+            position += std::min ((bin + 1) * binSize, length) - wrapped;
+        }
+
+        columnMins[column] = columnMin;
+        columnMaxs[column] = columnMax;
+    }
+
+    return true;
+}
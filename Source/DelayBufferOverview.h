@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    DelayBufferOverview.h
+
+    Min/max summary pyramid of one circular delay buffer, updated by the
+    audio thread as the write head advances and read by the editor without
+    locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Level 0 holds one min/max pair per BASE_BIN_SIZE buffer samples and every
+    level above halves the resolution of the one below. Each completed level 0
+    bin refreshes its ancestors, so the cost per written sample is
+    NUM_LEVELS / BASE_BIN_SIZE comparisons on average.
+*/
+class DelayBufferOverview
+{
+public:
+    static const int BASE_BIN_SIZE = 64;
+    static const int NUM_LEVELS = 10;
+
+    DelayBufferOverview();
+
+    /** Sizes the pyramid for a buffer of the given length and clears it. Not audio-thread safe. */
+    void prepare (int bufferLength);
+
+    /** Clears the summary without reallocating. */
+    void clear();
+
+    /** Records the sample just written at the given buffer position. Audio thread only. */
+    void write (int position, float sample) noexcept;
+
+    /** Fills one min/max pair per column for numColumns columns spanning numSamples
+        buffer positions from startPosition (wrapping around the buffer end). Returns
+        false if the overview has not been prepared yet. Cost is proportional to numColumns.
+    */
+    bool getColumns (int startPosition, int numSamples, float* columnMins, float* columnMaxs, int numColumns) const;
+
+    int getBufferLength() const noexcept    { return mBufferLength.load (std::memory_order_relaxed); }
+    int getWritePosition() const noexcept   { return mWritePosition.load (std::memory_order_relaxed); }
+
+private:
+    struct Pyramid
+    {
+        Pyramid (int bufferLength);
+
+        int bufferLength;
+        int numBins[NUM_LEVELS];
+        int levelOffset[NUM_LEVELS];
+        int totalBins;
+        std::unique_ptr<std::atomic<float>[]> mins;
+        std::unique_ptr<std::atomic<float>[]> maxs;
+    };
+
+    void publishBin (int level, int bin, float binMin, float binMax) noexcept;
+
+    // The editor takes its own reference so a re-prepare can't free the storage under it
+    std::shared_ptr<Pyramid> mPyramid;
+    Pyramid* mAudioPyramid;
+
+    std::atomic<int> mBufferLength;
+    std::atomic<int> mWritePosition;
+
+    float mBinMin;
+    float mBinMax;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayBufferOverview)
+};
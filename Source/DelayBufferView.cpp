@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    DelayBufferView.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayBufferView.h"
+
+//==============================================================================
+DelayBufferView::DelayBufferView (const DelayBufferOverview& left, const DelayBufferOverview& right)
+    : mOverviewLeft (left), mOverviewRight (right)
+{
+    mSampleRate = 44100.0;
+    mVisibleSeconds = 1.0;
+
+    setOpaque (true);
+    startTimerHz (30);
+}
+
+DelayBufferView::~DelayBufferView()
+{
+    stopTimer();
+}
+
+void DelayBufferView::setSampleRate (double sampleRate)
+{
+    if (sampleRate > 0.0)
+        mSampleRate = sampleRate;
+}
+
+//==============================================================================
+void DelayBufferView::paint (juce::Graphics& g)
+{
+    g.fillAll (juce::Colours::black);
+
+    auto area = getLocalBounds();
+    auto topHalf = area.removeFromTop (area.getHeight() / 2);
+
+    drawChannel (g, mOverviewLeft, topHalf);
+    drawChannel (g, mOverviewRight, area);
+
+    g.setColour (juce::Colours::grey);
+    g.setFont (12.0f);
+    g.drawText (juce::String (mVisibleSeconds, 2) + " s", getLocalBounds().reduced (4), juce::Justification::topLeft);
+}
+
+void DelayBufferView::drawChannel (juce::Graphics& g, const DelayBufferOverview& overview, juce::Rectangle<int> area)
+{
+    const int numColumns = (int) mColumnMins.size();
+    const int bufferLength = overview.getBufferLength();
+
+    if (numColumns == 0 || bufferLength == 0)
+        return;
+
+    // Newest sample sits at the right edge
+    const int numSamples = juce::jlimit (numColumns, bufferLength, (int) (mVisibleSeconds * mSampleRate));
+    const int startPosition = overview.getWritePosition() + 1 - numSamples;
+
+    if (! overview.getColumns (startPosition, numSamples, mColumnMins.data(), mColumnMaxs.data(), numColumns))
+        return;
+
+    const float centreY = (float) area.getCentreY();
+    const float halfHeight = area.getHeight() * 0.5f;
+
+    g.setColour (juce::Colours::orange);
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const float top = centreY - juce::jlimit (-1.0f, 1.0f, mColumnMaxs[(size_t) column]) * halfHeight;
+        const float bottom = centreY - juce::jlimit (-1.0f, 1.0f, mColumnMins[(size_t) column]) * halfHeight;
+        g.drawVerticalLine (area.getX() + column, top, std::max (bottom, top + 1.0f));
+    }
+}
+
+void DelayBufferView::resized()
+{
+    mColumnMins.resize ((size_t) std::max (0, getWidth()));
+    mColumnMaxs.resize ((size_t) std::max (0, getWidth()));
+}
+
+void DelayBufferView::mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails& wheel)
+{
+    const double bufferSeconds = std::max (0.005, mOverviewLeft.getBufferLength() / mSampleRate);
+    mVisibleSeconds = juce::jlimit (0.005, bufferSeconds, mVisibleSeconds * std::pow (0.5, wheel.deltaY * 4.0));
+    repaint();
+}
+
+void DelayBufferView::timerCallback()
+{
+    repaint();
+}
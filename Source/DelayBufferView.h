@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    DelayBufferView.h
+
+    Scrolling min/max display of the delay buffer contents, drawn from the
+    processor's DelayBufferOverview.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayBufferOverview.h"
+
+//==============================================================================
+/**
+    Shows the most recent part of the left and right delay buffers ending at
+    the write head. The mouse wheel zooms between a few milliseconds and the
+    full buffer; repainting only ever touches one summary bin range per pixel.
+*/
+class DelayBufferView  : public juce::Component,
+                         private juce::Timer
+{
+public:
+    DelayBufferView (const DelayBufferOverview& left, const DelayBufferOverview& right);
+    ~DelayBufferView() override;
+
+    void setSampleRate (double sampleRate);
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails&) override;
+
+private:
+    void timerCallback() override;
+    void drawChannel (juce::Graphics&, const DelayBufferOverview&, juce::Rectangle<int> area);
+
+    const DelayBufferOverview& mOverviewLeft;
+    const DelayBufferOverview& mOverviewRight;
+
+    double mSampleRate;
+    double mVisibleSeconds;
+
+    std::vector<float> mColumnMins;
+    std::vector<float> mColumnMaxs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayBufferView)
+};
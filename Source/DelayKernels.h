@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    DelayKernels.h
+
+    The per-sample building blocks of the delay engine, kept free of any
+    processor state so each one can be timed and tested on its own.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace DelayKernels
+{
+    //==============================================================================
+    /** Linear interpolation between two neighbouring buffer samples. */
+    inline float linearInterpolate (float sample_x, float sample_x1, float inPhase) noexcept
+    {
+        return (1 - inPhase) * sample_x + inPhase * sample_x1;
+    }
+
+    /** Reads the buffer between index x and the next one with linear interpolation. The
+        sample after the last one is the first, faded by how far the neighbour index has wrapped.
+    */
+    inline float readInterpolated (const float* buffer, int length, int x, float fraction) noexcept
+    {
+        int x1 = (x + 1) % length;
+
+        if (x1 < x)
+            return linearInterpolate (buffer[x], buffer[0], (float) x1 / length);
+
+        return linearInterpolate (buffer[x], buffer[x1], fraction);
+    }
+
+    inline float readInterpolated (const float* buffer, int length, float readHead) noexcept
+    {
+        const int x = static_cast<int>(readHead);
+        return readInterpolated (buffer, length, x, readHead - x);
+    }
+
+    /** Copies numSamples consecutive buffer samples starting at start, wrapping at the buffer end. */
+    inline void copyContiguous (const float* buffer, int length, int start, float* dest, int numSamples) noexcept
+    {
+        start = ((start % length) + length) % length;
+        const int firstPart = std::min (numSamples, length - start);
+
+        std::memcpy (dest, buffer + start, (size_t) firstPart * sizeof (float));
+
+        if (firstPart < numSamples)
+            std::memcpy (dest + firstPart, buffer, (size_t) (numSamples - firstPart) * sizeof (float));
+    }
+
+    /** out[k] = linearInterpolate (source[k], source[k + 1], inPhase): a whole segment
+        read at a constant fractional offset. source must hold numSamples + 1 samples.
+    */
+    inline void interpolateFixedPhase (const float* source, float inPhase, float* out, int numSamples) noexcept
+    {
+        for (int k = 0; k < numSamples; ++k)
+            out[k] = linearInterpolate (source[k], source[k + 1], inPhase);
+    }
+
+    /** 4-point, 3rd-order Hermite interpolation between x0 and x1. */
+    inline float hermiteInterpolate (float xm1, float x0, float x1, float x2, float inPhase) noexcept
+    {
+        const float c1 = 0.5f * (x1 - xm1);
+        const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * inPhase + c2) * inPhase + c1) * inPhase + x0;
+    }
+
+    /** Hermite counterpart of interpolateFixedPhase: source holds numSamples + 3 samples
+        and out[k] lies between source[k + 1] and source[k + 2].
+    */
+    inline void hermiteFixedPhase (const float* source, float inPhase, float* out, int numSamples) noexcept
+    {
+        for (int k = 0; k < numSamples; ++k)
+            out[k] = hermiteInterpolate (source[k], source[k + 1], source[k + 2], source[k + 3], inPhase);
+    }
+
+    //==============================================================================
+    /** Piecewise polynomial saturation used on every delay line. */
+    inline float softClip (float x) noexcept
+    {
+        float absX = std::abs(x);
+        if (absX <= 1.0f / 3.0f) {
+            return 2.0f * x;
+        } else if (absX <= 2.0f / 3.0f) {
+            return x * (3.0f - powf(2.0f - 3.0f * absX, 2.0f)) / 3.0f;
+        } else {
+            return ((x > 0.0f) ? 1.0f : -1.0f);
+        }
+    }
+
+    //==============================================================================
+    /** out[i] = sum over j of matrix[i][j] * in[j], for a square matrix of the given order. */
+    inline void mixFeedbackMatrix (const float* matrix, int order, const float* in, float* out) noexcept
+    {
+        for (int i = 0; i < order; ++i) {
+            float sum = 0.0f;
+            for (int j = 0; j < order; ++j)
+                sum += in[j] * matrix[i * order + j];
+            out[i] = sum;
+        }
+    }
+
+    //==============================================================================
+    /** Input DC blocker. The feedback term is scaled down with the input gain compensation. */
+    inline float inputDcBlock (float input, float& lastInput, float& lastOutput, float R, float inputGainCompensation) noexcept
+    {
+        float output = input - lastInput + R * lastOutput * inputGainCompensation;
+        lastInput = input;
+        lastOutput = output;
+        return output;
+    }
+
+    /** Output DC blocker acting on the combined wet signal. */
+    inline float outputDcBlock (float input, float& state, float coeff) noexcept
+    {
+        float output = input - state + coeff * state;
+        state = output;
+        return output;
+    }
+
+    //==============================================================================
+    /** Raised-cosine modulation shape of the delay-time LFO, for a phase in [0, 1). */
+    inline float raisedCosineLfo (float phase) noexcept
+    {
+        return (1.0f - std::cos(2.0f * M_PI * phase)) * 0.0725f;
+    }
+
+    //==============================================================================
+    /** Updates one one-pole low-pass state per reflection tap from the taps' buffer positions.
+        Buffer is any sample store with a float read (int position) member, such as DelayLineStorage.
+    */
+    template <typename Buffer>
+    inline void processReflectionTaps (const Buffer& buffer, int length, int writeHead,
+                                       const int* tapDelaySamples, const float* tapCoeffs,
+                                       float* tapStates, int numTaps) noexcept
+    {
+        for (int i = 0; i < numTaps; ++i) {
+            int readIndex = (writeHead - tapDelaySamples[i] + length) % length;
+            tapStates[i] = tapCoeffs[i] * tapStates[i] + (1.0f - tapCoeffs[i]) * buffer.read (readIndex);
+        }
+    }
+}
@@ -0,0 +1,313 @@
+/*
+  ==============================================================================
+
+    DelayLineStorage.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayLineStorage.h"
+#include "DelayKernels.h"
+
+//==============================================================================
+DelayLineStorage::DelayLineStorage()
+{
+    mLength = 0;
+    mFormat = Format::float32;
+    mPinned = false;
+    mNumChannels = 1;
+    mChannel = 0;
+    mData = nullptr;
+    mFloatData = nullptr;
+    mHalfData = nullptr;
+    mIntData = nullptr;
+    mDitherState = 0x12345678;
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+}
+
+bool DelayLineStorage::allocate (int length, Format format, bool pinned, int numChannels)
+{
+    jassert (numChannels > 0);
+    mChannel = 0;
+
+    if (length != mLength || format != mFormat || pinned != mPinned || numChannels != mNumChannels
+        || mMemory.getData() == nullptr)
+    {
+        mLength = length;
+        mFormat = format;
+        mPinned = pinned;
+        mNumChannels = numChannels;
+
+        // A pinned block falls back to heap memory by itself, so this is out of memory
+        if (! mMemory.allocate (getSizeInBytes(), pinned))
+        {
+            mLength = 0;
+            setData (nullptr);
+            return false;
+        }
+
+        setData (mMemory.getData());
+    }
+
+    clear();
+    return true;
+}
+
+void DelayLineStorage::clear()
+{
+    // Zero is all-bits-zero in every format
+    if (mData != nullptr && mChannel == 0)
+        std::memset (mData, 0, getSizeInBytes());
+
+    mDitherState = 0x12345678;
+}
+
+size_t DelayLineStorage::getSizeInBytes (int length, Format format, int numChannels) noexcept
+{
+    return (size_t) length * (size_t) numChannels * (format == Format::float32 ? sizeof (float) : sizeof (uint16_t));
+}
+
+//==============================================================================
+void DelayLineStorage::attach (void* memory, int length, Format format, int numChannels, int channel) noexcept
+{
+    jassert (mMemory.getData() == nullptr);
+    jassert (channel >= 0 && channel < numChannels);
+
+    mLength = length;
+    mFormat = format;
+    mNumChannels = numChannels;
+    mChannel = channel;
+    setData (memory);
+}
+
+void DelayLineStorage::detach() noexcept
+{
+    jassert (mMemory.getData() == nullptr);
+    setData (nullptr);
+}
+
+void DelayLineStorage::releaseMemory()
+{
+    mMemory.free();
+    setData (nullptr);
+}
+
+void DelayLineStorage::setData (void* data) noexcept
+{
+    mData = data;
+    mFloatData = mFormat == Format::float32 && data != nullptr ? static_cast<float*> (data) + mChannel : nullptr;
+    mHalfData = mFormat == Format::float16 && data != nullptr ? static_cast<uint16_t*> (data) + mChannel : nullptr;
+    mIntData = mFormat == Format::int16 && data != nullptr ? static_cast<int16_t*> (data) + mChannel : nullptr;
+}
+
+//==============================================================================
+float DelayLineStorage::readInterpolated (double readHead) const noexcept
+{
+    // The fraction is taken in double precision and only then narrowed
+    int x = static_cast<int>(readHead);
+    const float fraction = (float) (readHead - x);
+
+    if (mFormat == Format::float32 && mNumChannels == 1)
+        return DelayKernels::readInterpolated (mFloatData, mLength, x, fraction);
+
+    int x1 = (x + 1) % mLength;
+
+    if (x1 < x)
+        return DelayKernels::linearInterpolate (read (x), read (0), (float) x1 / mLength);
+
+    return DelayKernels::linearInterpolate (read (x), read (x1), fraction);
+}
+
+float DelayLineStorage::readCubic (double readHead) const noexcept
+{
+    int x = static_cast<int>(readHead);
+    const float fraction = (float) (readHead - x);
+
+    // Float rounding can land a wrapped read head exactly on the length
+    if (x >= mLength)
+        x -= mLength;
+
+    const int xm1 = x > 0 ? x - 1 : mLength - 1;
+    const int x1 = x + 1 < mLength ? x + 1 : x + 1 - mLength;
+    const int x2 = x + 2 < mLength ? x + 2 : x + 2 - mLength;
+
+    return DelayKernels::hermiteInterpolate (read (xm1), read (x), read (x1), read (x2), fraction);
+}
+
+void DelayLineStorage::readContiguous (int start, float* dest, int numSamples) const noexcept
+{
+    if (mNumChannels > 1)
+    {
+        // One sample a frame: gather ours
+        int position = ((start % mLength) + mLength) % mLength;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            dest[i] = read (position);
+
+            if (++position == mLength)
+                position = 0;
+        }
+
+        return;
+    }
+
+    if (mFormat == Format::float32)
+    {
+        DelayKernels::copyContiguous (mFloatData, mLength, start, dest, numSamples);
+        return;
+    }
+
+    readContiguousFrames (start, dest, numSamples);
+}
+
+void DelayLineStorage::readContiguousFrames (int start, float* dest, int numFrames) const noexcept
+{
+    start = ((start % mLength) + mLength) % mLength;
+    const int firstPart = std::min (numFrames, mLength - start);
+
+    convertToFloat (start * mNumChannels, dest, firstPart * mNumChannels);
+
+    if (firstPart < numFrames)
+        convertToFloat (0, dest + firstPart * mNumChannels, (numFrames - firstPart) * mNumChannels);
+}
+
+bool DelayLineStorage::isStereoPair (const DelayLineStorage& left, const DelayLineStorage& right) noexcept
+{
+    return left.mData != nullptr && left.mData == right.mData && left.mNumChannels == 2
+        && left.mChannel == 0 && right.mChannel == 1;
+}
+
+void DelayLineStorage::readContiguousMono (const DelayLineStorage& left, const DelayLineStorage& right, int start,
+                                           float* dest, float* scratch, int numSamples) noexcept
+{
+    if (isStereoPair (left, right))
+    {
+        left.readContiguousFrames (start, scratch, numSamples);
+
+        for (int k = 0; k < numSamples; ++k)
+            dest[k] = 0.5f * (scratch[2 * k] + scratch[2 * k + 1]);
+
+        return;
+    }
+
+    left.readContiguous (start, dest, numSamples);
+    right.readContiguous (start, scratch, numSamples);
+
+    for (int k = 0; k < numSamples; ++k)
+        dest[k] = 0.5f * (dest[k] + scratch[k]);
+}
+
+void DelayLineStorage::convertToFloat (int start, float* dest, int numSamples) const noexcept
+{
+    // start counts samples from the start of the block, whatever our channel
+    if (mFormat == Format::float32)
+    {
+        std::memcpy (dest, static_cast<const float*> (mData) + start, (size_t) numSamples * sizeof (float));
+        return;
+    }
+
+    if (mFormat == Format::int16)
+    {
+        const int16_t* source = static_cast<const int16_t*> (mData) + start;
+        const float scale = INT16_HEADROOM / 32768.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = source[i] * scale;
+
+        return;
+    }
+
+    mKernels->halfToFloat (static_cast<const uint16_t*> (mData) + start, dest, numSamples);
+}
+
+//==============================================================================
+int16_t DelayLineStorage::floatToInt16 (float sample) noexcept
+{
+    // Below one step the dither alone would keep a decayed feedback loop at
+    // about one LSB of noise forever, so the tail is stored as exact silence
+    const float level = sample * (32768.0f / INT16_HEADROOM);
+
+    if (std::abs (level) < 1.0f)
+        return 0;
+
+    // Triangular dither of one step from two draws of a 32-bit LCG
+    mDitherState = mDitherState * 1664525u + 1013904223u;
+    const float r1 = (float) (mDitherState >> 8) * (1.0f / 16777216.0f);
+    mDitherState = mDitherState * 1664525u + 1013904223u;
+    const float r2 = (float) (mDitherState >> 8) * (1.0f / 16777216.0f);
+
+    const float scaled = level + (r1 - r2);
+    return (int16_t) juce::jlimit (-32768.0f, 32767.0f, std::round (scaled));
+}
+
+uint16_t DelayLineStorage::floatToHalf (float sample) noexcept
+{
+    // Round-to-nearest-even conversion after F. Giesen's float_to_half_fast3_rtne
+    uint32_t f;
+    std::memcpy (&f, &sample, sizeof (f));
+
+    const uint32_t sign = f & 0x80000000u;
+    f ^= sign;
+
+    uint16_t half;
+
+    if (f >= 0x47800000u)
+    {
+        // Overflow becomes infinity, NaN stays NaN
+        half = (uint16_t) (f > 0x7f800000u ? 0x7e00 : 0x7c00);
+    }
+    else if (f < 0x38800000u)
+    {
+        // Subnormal half: let the float adder do the rounding
+        float magnitude;
+        std::memcpy (&magnitude, &f, sizeof (f));
+        magnitude += 0.5f;
+
+        uint32_t bits;
+        std::memcpy (&bits, &magnitude, sizeof (bits));
+        half = (uint16_t) (bits - 0x3f000000u);
+    }
+    else
+    {
+        const uint32_t mantissaOdd = (f >> 13) & 1;
+        f += ((uint32_t) (15 - 127) << 23) + 0xfff;
+        f += mantissaOdd;
+        half = (uint16_t) (f >> 13);
+    }
+
+    return (uint16_t) (half | (sign >> 16));
+}
+
+float DelayLineStorage::halfToFloat (uint16_t half) noexcept
+{
+    const uint32_t shiftedExponent = 0x7c00u << 13;
+
+    uint32_t bits = ((uint32_t) half & 0x7fffu) << 13;
+    const uint32_t exponent = shiftedExponent & bits;
+    bits += (uint32_t) (127 - 15) << 23;
+
+    float result;
+
+    if (exponent == shiftedExponent)
+    {
+        bits += (uint32_t) (128 - 16) << 23;    // Inf or NaN
+        std::memcpy (&result, &bits, sizeof (result));
+    }
+    else if (exponent == 0)
+    {
+        // Zero or subnormal: renormalise with a float subtraction
+        bits += 1u << 23;
+        const uint32_t magicBits = 113u << 23;
+        float magic;
+        std::memcpy (&result, &bits, sizeof (result));
+        std::memcpy (&magic, &magicBits, sizeof (magic));
+        result -= magic;
+    }
+    else
+    {
+        std::memcpy (&result, &bits, sizeof (result));
+    }
+
+    return (half & 0x8000u) != 0 ? -result : result;
+}
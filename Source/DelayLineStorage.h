@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    DelayLineStorage.h
+
+    Sample memory of one circular delay buffer, kept as 32-bit floats or in
+    one of two 16-bit formats that halve the memory and cache footprint, on
+    its own or as one channel of a buffer of interleaved frames.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayMemoryBlock.h"
+#include "KernelDispatch.h"
+
+//==============================================================================
+/**
+    float16 stores IEEE half floats: about 11 bits of precision relative to the
+    signal level, so its noise follows the signal down. int16 stores dithered
+    fixed point with INT16_HEADROOM of headroom above full scale, which gives a
+    constant noise floor around -84 dBFS. Samples below one step are stored as
+    exact zero, so a decaying tail ends in silence instead of dither noise.
+
+    Samples are converted one at a time on write, since the feedback loop
+    produces them one at a time, and whole segments are converted at once by
+    readContiguous, with the half float kernel of the selected KernelDispatch build.
+
+    A buffer of numChannels channels stores frames of one sample per channel
+    side by side. Channel 0 owns the memory and the other channels attach to
+    it, each object then reading and writing its own channel. Channels read at
+    the same position share a cache line and a page instead of touching one of
+    each per channel, and readContiguousFrames reads them all in one pass.
+*/
+class DelayLineStorage
+{
+public:
+    enum class Format
+    {
+        float32 = 0,
+        float16,
+        int16
+    };
+
+    static constexpr float INT16_HEADROOM = 4.0f;
+
+    DelayLineStorage();
+
+    /** Reallocates only if the length, format, channels or pinning changed, and clears the
+        samples. This becomes channel 0 of numChannels. Pinned memory is locked in RAM, see
+        DelayMemoryBlock. False if there wasn't the memory, which leaves the storage without
+        any. Not audio-thread safe.
+    */
+    bool allocate (int length, Format format, bool pinned = false, int numChannels = 1);
+
+    /** Clears the samples of every channel when called on channel 0. */
+    void clear();
+
+    /** Runs as the given channel on memory owned elsewhere, such as a DelayMemoryPool slot
+        or another channel's block, of at least getSizeInBytes (length, format, numChannels)
+        zeroed bytes. Nothing is allocated, freed or cleared, so both are audio-thread safe.
+        Any memory of its own is freed first by releaseMemory, which is not.
+    */
+    void attach (void* memory, int length, Format format, int numChannels = 1, int channel = 0) noexcept;
+    void detach() noexcept;
+    void releaseMemory();
+
+    bool hasMemory() const noexcept         { return mData != nullptr; }
+    static size_t getSizeInBytes (int length, Format format, int numChannels = 1) noexcept;
+
+    int getLength() const noexcept          { return mLength; }
+    Format getFormat() const noexcept       { return mFormat; }
+    int getNumChannels() const noexcept     { return mNumChannels; }
+    int getChannel() const noexcept         { return mChannel; }
+    size_t getSizeInBytes() const noexcept  { return getSizeInBytes (mLength, mFormat, mNumChannels); }
+    const DelayMemoryBlock& getMemory() const noexcept  { return mMemory; }
+
+    /** Start of the samples section visitState reports, all channels' frames in turn. */
+    const void* getData() const noexcept    { return mData; }
+
+    /** Calls visit (data, numBytes) for the samples and the dither state, see EngineSnapshot.
+        Channel 0 reports the frames of every channel.
+    */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        visit (mData, hasMemory() && mChannel == 0 ? getSizeInBytes() : 0);
+        visit (&mDitherState, sizeof (mDitherState));
+    }
+
+    void write (int position, float sample) noexcept
+    {
+        switch (mFormat)
+        {
+            case Format::float16:   mHalfData[position * mNumChannels] = floatToHalf (sample); break;
+            case Format::int16:     mIntData[position * mNumChannels] = floatToInt16 (sample); break;
+            case Format::float32:
+            default:                mFloatData[position * mNumChannels] = sample; break;
+        }
+    }
+
+    float read (int position) const noexcept
+    {
+        switch (mFormat)
+        {
+            case Format::float16:   return halfToFloat (mHalfData[position * mNumChannels]);
+            case Format::int16:     return mIntData[position * mNumChannels] * (INT16_HEADROOM / 32768.0f);
+            case Format::float32:
+            default:                return mFloatData[position * mNumChannels];
+        }
+    }
+
+    /** Same reading rules as DelayKernels::readInterpolated. The read head is a double
+        so that its fraction survives in buffers of millions of samples.
+    */
+    float readInterpolated (double readHead) const noexcept;
+
+    /** Hermite interpolated read, wrapping at both ends of the buffer. */
+    float readCubic (double readHead) const noexcept;
+
+    /** Copies numSamples consecutive samples from start as floats, wrapping at the buffer end. */
+    void readContiguous (int start, float* dest, int numSamples) const noexcept;
+
+    /** Copies numFrames whole frames from start as floats, every channel's sample in turn. */
+    void readContiguousFrames (int start, float* dest, int numFrames) const noexcept;
+
+    /** Whether the two are channels 0 and 1 of the same stereo frames. */
+    static bool isStereoPair (const DelayLineStorage& left, const DelayLineStorage& right) noexcept;
+
+    /** dest[k] = 0.5 * (left + right) at start + k, with scratch room for 2 * numSamples floats.
+        A stereo pair is read as frames, in half the memory accesses, with the same result.
+    */
+    static void readContiguousMono (const DelayLineStorage& left, const DelayLineStorage& right, int start,
+                                    float* dest, float* scratch, int numSamples) noexcept;
+
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    //==============================================================================
+    static uint16_t floatToHalf (float sample) noexcept;
+    static float halfToFloat (uint16_t half) noexcept;
+
+private:
+    int16_t floatToInt16 (float sample) noexcept;
+
+    void convertToFloat (int start, float* dest, int numSamples) const noexcept;
+    void setData (void* data) noexcept;
+
+    int mLength;
+    Format mFormat;
+    bool mPinned;
+    int mNumChannels;       // Samples per frame, the step between our samples
+    int mChannel;
+
+    // One block of memory, our own or attached, seen through the pointer that matches the
+    // format. Those point at our channel, mData at the start of the block
+    DelayMemoryBlock mMemory;
+    void* mData;
+    float* mFloatData;
+    uint16_t* mHalfData;
+    int16_t* mIntData;
+
+    uint32_t mDitherState;
+    const KernelDispatch::Kernels* mKernels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayLineStorage)
+};
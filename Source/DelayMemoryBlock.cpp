@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    DelayMemoryBlock.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayMemoryBlock.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+#if JUCE_MAC
+ #include <mach/vm_statistics.h>
+#endif
+
+namespace
+{
+    const size_t hugePageSize = 2 * 1024 * 1024;
+    const size_t cacheLineSize = 64;
+
+    size_t roundUp (size_t numBytes, size_t granularity)
+    {
+        return (numBytes + granularity - 1) / granularity * granularity;
+    }
+}
+
+//==============================================================================
+DelayMemoryBlock::DelayMemoryBlock()
+{
+    mData = nullptr;
+    mAllocation = nullptr;
+    mSize = 0;
+    mMappedSize = 0;
+    mMapped = false;
+    mLocked = false;
+    mHugePages = false;
+}
+
+DelayMemoryBlock::~DelayMemoryBlock()
+{
+    free();
+}
+
+bool DelayMemoryBlock::allocate (size_t numBytes, bool pinned)
+{
+    free();
+
+    if (numBytes == 0)
+        return true;
+
+    if (pinned && allocatePinned (numBytes))
+        return true;
+
+    // Rounded out to whole cache lines on both ends
+    mAllocation = std::calloc (roundUp (numBytes, cacheLineSize) + cacheLineSize, 1);
+
+    if (mAllocation == nullptr)
+        return false;
+
+    mData = reinterpret_cast<void*> (roundUp (reinterpret_cast<size_t> (mAllocation), cacheLineSize));
+    mSize = numBytes;
+    return true;
+}
+
+void DelayMemoryBlock::free()
+{
+    if (mData == nullptr)
+        return;
+
+    if (mMapped)
+    {
+       #if JUCE_WINDOWS
+        if (mLocked && ! mHugePages)
+            VirtualUnlock (mData, mMappedSize);
+
+        VirtualFree (mData, 0, MEM_RELEASE);
+       #else
+        if (mLocked)
+            munlock (mData, mMappedSize);
+
+        munmap (mData, mMappedSize);
+       #endif
+    }
+    else
+    {
+        std::free (mAllocation);
+    }
+
+    mData = nullptr;
+    mAllocation = nullptr;
+    mSize = 0;
+    mMappedSize = 0;
+    mMapped = false;
+    mLocked = false;
+    mHugePages = false;
+}
+
+//==============================================================================
+bool DelayMemoryBlock::allocatePinned (size_t numBytes)
+{
+   #if JUCE_WINDOWS
+    // Large pages need SeLockMemoryPrivilege and are never paged out
+    const size_t largePageSize = GetLargePageMinimum();
+
+    if (largePageSize > 0)
+    {
+        mMappedSize = roundUp (numBytes, largePageSize);
+        mData = VirtualAlloc (nullptr, mMappedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        mHugePages = mLocked = mData != nullptr;
+    }
+
+    if (mData == nullptr)
+    {
+        mMappedSize = roundUp (numBytes, (size_t) juce::SystemStats::getPageSize());
+        mData = VirtualAlloc (nullptr, mMappedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+        if (mData == nullptr)
+            return false;
+    }
+   #else
+    mMappedSize = roundUp (numBytes, hugePageSize);
+
+   #if JUCE_LINUX
+    mData = mmap (nullptr, mMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+   #elif JUCE_MAC && JUCE_INTEL
+    mData = mmap (nullptr, mMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+   #else
+    mData = MAP_FAILED;
+   #endif
+
+    mHugePages = mData != MAP_FAILED;
+
+    if (! mHugePages)
+    {
+        mData = mmap (nullptr, mMappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+
+        if (mData == MAP_FAILED)
+        {
+            mData = nullptr;
+            mMappedSize = 0;
+            return false;
+        }
+
+       #if JUCE_LINUX
+        madvise (mData, mMappedSize, MADV_HUGEPAGE);
+       #endif
+    }
+   #endif
+
+    mMapped = true;
+    mSize = numBytes;
+
+    // Fault every page in now rather than on the audio thread's first pass
+    const size_t pageSize = (size_t) juce::SystemStats::getPageSize();
+
+    for (size_t offset = 0; offset < mMappedSize; offset += pageSize)
+        static_cast<volatile char*> (mData)[offset] = 0;
+
+   #if JUCE_WINDOWS
+    if (! mLocked)
+        mLocked = VirtualLock (mData, mMappedSize) != 0;
+   #else
+    mLocked = mlock (mData, mMappedSize) == 0;
+   #endif
+
+    return true;
+}
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    DelayMemoryBlock.h
+
+    Raw zeroed memory for the delay buffers. Long buffers can be pinned:
+    backed by huge pages where the system provides them, faulted in up
+    front and locked in RAM, so the audio thread never takes a page fault
+    or a TLB walk per 4 KB of delay.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Pinning is best effort. Explicit huge pages are tried first, then ordinary
+    pages with a transparent huge page hint; locking can fail when the memory
+    lock limit is too low, which isLocked() reports. An unpinned block is
+    zeroed heap memory.
+
+    Either way the block starts and ends on a cache line boundary, so two
+    instances writing neighbouring blocks from different cores never share one.
+*/
+class DelayMemoryBlock
+{
+public:
+    DelayMemoryBlock();
+    ~DelayMemoryBlock();
+
+    /** Frees any previous memory and allocates numBytes of zeros. Not audio-thread safe. */
+    bool allocate (size_t numBytes, bool pinned);
+    void free();
+
+    void* getData() const noexcept          { return mData; }
+    size_t getSize() const noexcept         { return mSize; }
+    bool isPinned() const noexcept          { return mMapped; }
+    bool isLocked() const noexcept          { return mLocked; }
+    bool usesHugePages() const noexcept     { return mHugePages; }
+
+private:
+    bool allocatePinned (size_t numBytes);
+
+    void* mData;
+    void* mAllocation;      // What the heap returned, for unpinned blocks
+    size_t mSize;
+    size_t mMappedSize;
+    bool mMapped;
+    bool mLocked;
+    bool mHugePages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayMemoryBlock)
+};
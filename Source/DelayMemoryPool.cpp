@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayMemoryPool.h"
+
+//==============================================================================
+DelayMemoryPool::DelayMemoryPool()
+{
+    mNumSizeClasses = 0;
+    mNumFreeSlots = 0;
+    startTimer (200);
+}
+
+DelayMemoryPool::~DelayMemoryPool()
+{
+    stopTimer();
+}
+
+void DelayMemoryPool::reserve (size_t slotBytes, bool pinned)
+{
+    const juce::ScopedLock refillLock (mRefillLock);
+
+    if (findSizeClass (slotBytes, pinned) == nullptr)
+    {
+        if (mNumSizeClasses == MAX_SIZE_CLASSES)
+        {
+            jassertfalse;   // Far more sample rates and modes in use than expected
+            return;
+        }
+
+        auto newClass = std::make_unique<SizeClass>();
+        newClass->slotBytes = slotBytes;
+        newClass->pinned = pinned;
+
+        const juce::SpinLock::ScopedLockType lock (mLock);
+        mSizeClasses[mNumSizeClasses++] = std::move (newClass);
+    }
+
+    // Instances waiting on other sizes get served here too, with or without a message loop
+    refillAll();
+}
+
+void DelayMemoryPool::refillAll()
+{
+    // Size classes are only added under this lock, so the count can't change under us
+    const juce::ScopedLock refillLock (mRefillLock);
+
+    for (int i = 0; i < mNumSizeClasses; ++i)
+        refill (*mSizeClasses[i]);
+}
+
+void* DelayMemoryPool::tryAcquire (size_t slotBytes, bool pinned, bool& isWaiting) noexcept
+{
+    if (isWaiting && mNumFreeSlots.load (std::memory_order_relaxed) == 0)
+        return nullptr;
+
+    if (! mLock.tryEnter())
+        return nullptr;
+
+    void* slot = nullptr;
+    auto* sizeClass = findSizeClass (slotBytes, pinned);
+
+    if (sizeClass != nullptr)
+    {
+        if (! sizeClass->freeSlots.empty())
+        {
+            slot = sizeClass->freeSlots.back();
+            sizeClass->freeSlots.pop_back();
+            ++sizeClass->numInUse;
+            updateFreeSlotCount();
+
+            if (isWaiting)
+                --sizeClass->numWaiting;
+
+            isWaiting = false;
+        }
+        else if (! isWaiting)
+        {
+            ++sizeClass->numWaiting;
+            isWaiting = true;
+        }
+    }
+
+    mLock.exit();
+    return slot;
+}
+
+void DelayMemoryPool::stopWaiting (size_t slotBytes, bool pinned, bool& isWaiting)
+{
+    if (! isWaiting)
+        return;
+
+    const juce::SpinLock::ScopedLockType lock (mLock);
+
+    if (auto* sizeClass = findSizeClass (slotBytes, pinned))
+        --sizeClass->numWaiting;
+
+    isWaiting = false;
+}
+
+bool DelayMemoryPool::tryRelease (void* slot, size_t slotBytes, bool pinned) noexcept
+{
+    if (! mLock.tryEnter())
+        return false;
+
+    auto* sizeClass = findSizeClass (slotBytes, pinned);
+    jassert (sizeClass != nullptr);
+
+    // Capacity is kept at the number of blocks, so this never allocates
+    sizeClass->returnedSlots.push_back (slot);
+    --sizeClass->numInUse;
+
+    mLock.exit();
+    return true;
+}
+
+void DelayMemoryPool::release (void* slot, size_t slotBytes, bool pinned)
+{
+    const juce::SpinLock::ScopedLockType lock (mLock);
+
+    auto* sizeClass = findSizeClass (slotBytes, pinned);
+    jassert (sizeClass != nullptr);
+
+    sizeClass->returnedSlots.push_back (slot);
+    --sizeClass->numInUse;
+}
+
+size_t DelayMemoryPool::getAllocatedBytes() const
+{
+    const juce::SpinLock::ScopedLockType lock (mLock);
+
+    size_t total = 0;
+
+    for (int i = 0; i < mNumSizeClasses; ++i)
+        total += mSizeClasses[i]->blocks.size() * mSizeClasses[i]->slotBytes;
+
+    return total;
+}
+
+//==============================================================================
+DelayMemoryPool::SizeClass* DelayMemoryPool::findSizeClass (size_t slotBytes, bool pinned) const noexcept
+{
+    for (int i = 0; i < mNumSizeClasses; ++i)
+        if (mSizeClasses[i]->slotBytes == slotBytes && mSizeClasses[i]->pinned == pinned)
+            return mSizeClasses[i].get();
+
+    return nullptr;
+}
+
+void DelayMemoryPool::refill (SizeClass& sizeClass)
+{
+    // Called with mRefillLock held, so only the audio thread competes for the slots
+    std::vector<void*> dirtySlots;
+
+    {
+        const juce::SpinLock::ScopedLockType lock (mLock);
+        dirtySlots = sizeClass.returnedSlots;
+        sizeClass.returnedSlots.clear();
+    }
+
+    // Zeroing megabytes happens here rather than on the audio thread
+    for (auto* slot : dirtySlots)
+        std::memset (slot, 0, sizeClass.slotBytes);
+
+    int numFree, numWanted;
+
+    {
+        const juce::SpinLock::ScopedLockType lock (mLock);
+        sizeClass.freeSlots.insert (sizeClass.freeSlots.end(), dirtySlots.begin(), dirtySlots.end());
+        numFree = (int) sizeClass.freeSlots.size();
+        updateFreeSlotCount();
+        numWanted = FREE_SLOTS_PER_SIZE + sizeClass.numWaiting;
+    }
+
+    // Allocating and faulting in a slot can take a while, so it's done outside the lock
+    while (numFree < numWanted)
+    {
+        auto block = std::make_unique<DelayMemoryBlock>();
+
+        if (! block->allocate (sizeClass.slotBytes, sizeClass.pinned))
+            break;
+
+        const juce::SpinLock::ScopedLockType lock (mLock);
+        sizeClass.freeSlots.reserve (sizeClass.blocks.size() + 1);
+        sizeClass.returnedSlots.reserve (sizeClass.blocks.size() + 1);
+        sizeClass.freeSlots.push_back (block->getData());
+        sizeClass.blocks.push_back (std::move (block));
+        numFree = (int) sizeClass.freeSlots.size();
+        updateFreeSlotCount();
+    }
+
+    // Give back memory that idle instances no longer need
+    while (numFree > numWanted)
+    {
+        std::unique_ptr<DelayMemoryBlock> unusedBlock;
+
+        {
+            const juce::SpinLock::ScopedLockType lock (mLock);
+
+            // The audio thread may have taken one in the meantime
+            if ((int) sizeClass.freeSlots.size() <= FREE_SLOTS_PER_SIZE + sizeClass.numWaiting)
+                break;
+
+            void* slot = sizeClass.freeSlots.back();
+            sizeClass.freeSlots.pop_back();
+
+            auto block = std::find_if (sizeClass.blocks.begin(), sizeClass.blocks.end(),
+                                       [slot] (const std::unique_ptr<DelayMemoryBlock>& b) { return b->getData() == slot; });
+            jassert (block != sizeClass.blocks.end());
+
+            unusedBlock = std::move (*block);
+            sizeClass.blocks.erase (block);
+            numFree = (int) sizeClass.freeSlots.size();
+            updateFreeSlotCount();
+        }
+    }
+}
+
+void DelayMemoryPool::updateFreeSlotCount() noexcept
+{
+    // Called with the lock held
+    int total = 0;
+
+    for (int i = 0; i < mNumSizeClasses; ++i)
+        total += (int) mSizeClasses[i]->freeSlots.size();
+
+    mNumFreeSlots.store (total, std::memory_order_relaxed);
+}
+
+void DelayMemoryPool::timerCallback()
+{
+    refillAll();
+}
@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    DelayMemoryPool.h
+
+    Process-wide pool of delay memory shared by every plugin instance that
+    runs in on-demand mode, so only instances that are actually making
+    sound hold a delay buffer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayMemoryBlock.h"
+
+//==============================================================================
+/**
+    Slots are grouped by size. The audio thread only ever pops and pushes
+    pointers under a try-lock, so it never waits: if the lock is busy or no
+    slot is free it simply tries again on the next block. refillAll zeroes
+    returned slots, keeps FREE_SLOTS_PER_SIZE slots of every size ready on top
+    of one for each instance left waiting, and frees anything beyond that.
+
+    A timer calls refillAll on the message thread, and so does every reserve,
+    since hosts call prepareToPlay from threads of their own and a pool without
+    a message loop would otherwise never refill. Both take mRefillLock, so any
+    number of threads may reserve and refill at once.
+
+    Get at it through a juce::SharedResourcePointer<DelayMemoryPool>.
+*/
+class DelayMemoryPool : private juce::Timer
+{
+public:
+    static const int FREE_SLOTS_PER_SIZE = 2;
+    static const int MAX_SIZE_CLASSES = 16;
+
+    DelayMemoryPool();
+    ~DelayMemoryPool() override;
+
+    /** Registers a slot size and refills every size. Any thread but the audio thread. */
+    void reserve (size_t slotBytes, bool pinned);
+
+    /** Zeroes returned slots and tops up or trims the free list of every size.
+        Any thread but the audio thread.
+    */
+    void refillAll();
+
+    /** A zeroed slot of a reserved size, or nullptr. Never blocks. A caller that
+        found the pool empty is marked as waiting through isWaiting, so the next
+        refill allocates a slot for it.
+    */
+    void* tryAcquire (size_t slotBytes, bool pinned, bool& isWaiting) noexcept;
+
+    /** Withdraws a caller that no longer wants the slot it was waiting for. */
+    void stopWaiting (size_t slotBytes, bool pinned, bool& isWaiting);
+
+    /** Returns a slot from the audio thread. Returns false, keeping the slot
+        with the caller, if the pool is busy. Never blocks.
+    */
+    bool tryRelease (void* slot, size_t slotBytes, bool pinned) noexcept;
+
+    /** Returns a slot from outside the audio thread. */
+    void release (void* slot, size_t slotBytes, bool pinned);
+
+    /** Bytes currently allocated by the pool, in use or not. */
+    size_t getAllocatedBytes() const;
+
+private:
+    struct SizeClass
+    {
+        size_t slotBytes = 0;
+        bool pinned = false;
+        int numInUse = 0;
+        int numWaiting = 0;
+        std::vector<std::unique_ptr<DelayMemoryBlock>> blocks;
+        std::vector<void*> freeSlots;       // Zeroed, ready for the audio thread
+        std::vector<void*> returnedSlots;   // Waiting to be zeroed
+    };
+
+    SizeClass* findSizeClass (size_t slotBytes, bool pinned) const noexcept;
+    void refill (SizeClass& sizeClass);
+    void timerCallback() override;
+
+    void updateFreeSlotCount() noexcept;
+
+    // Held while size classes are added or refilled, never by the audio thread
+    juce::CriticalSection mRefillLock;
+
+    // Every instance's audio thread try-locks this, so it gets a cache line of its own
+    alignas (64) juce::SpinLock mLock;
+    std::unique_ptr<SizeClass> mSizeClasses[MAX_SIZE_CLASSES];
+    int mNumSizeClasses;
+
+    // Free slots of all sizes. Waiting instances poll this rather than the lock, so
+    // while the pool is empty they only read a line that nobody is writing
+    alignas (64) std::atomic<int> mNumFreeSlots;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayMemoryPool)
+};
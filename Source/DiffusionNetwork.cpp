@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    DiffusionNetwork.cpp
+
+  ==============================================================================
+*/
+
+#include "DiffusionNetwork.h"
+
+namespace
+{
+    bool isPrime (int n) noexcept
+    {
+        if (n < 2)
+            return false;
+
+        for (int divisor = 2; divisor * divisor <= n; ++divisor)
+            if (n % divisor == 0)
+                return false;
+
+        return true;
+    }
+
+    // Section lengths grow from stage to stage, and spread across the lines and channels
+    const double STAGE_MILLISECONDS[KernelDispatch::NUM_DIFFUSION_STAGES] = { 2.3, 3.7, 5.9, 9.1 };
+    const double LINE_SPREAD = 0.11;
+    const double RIGHT_CHANNEL_SPREAD = 0.053;
+}
+
+//==============================================================================
+DiffusionNetwork::DiffusionNetwork()
+{
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+    mRingMask = 0;
+    mWritePosition = 0;
+
+    for (int stage = 0; stage < NUM_STAGES; ++stage)
+    {
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            mDelays[stage][lane] = 1;
+            mReadOffsets[stage * NUM_LANES + lane] = 0;
+        }
+    }
+}
+
+void DiffusionNetwork::prepare (double sampleRate)
+{
+    const int linesPerChannel = NUM_LANES / 2;
+    std::vector<int> used;
+    int longest = 1;
+
+    for (int stage = 0; stage < NUM_STAGES; ++stage)
+    {
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            const int line = lane % linesPerChannel;
+            const bool isRight = lane >= linesPerChannel;
+            const double spread = 1.0 + LINE_SPREAD * line + (isRight ? RIGHT_CHANNEL_SPREAD : 0.0);
+
+            // The next prime up that no other section has taken
+            int delay = (int) (STAGE_MILLISECONDS[stage] * 0.001 * sampleRate * spread);
+
+            while (! isPrime (delay) || std::find (used.begin(), used.end(), delay) != used.end())
+                ++delay;
+
+            used.push_back (delay);
+            mDelays[stage][lane] = delay;
+            longest = std::max (longest, delay);
+        }
+    }
+
+    const int numRows = juce::nextPowerOfTwo (longest + 1);
+    mRingMask = numRows * NUM_LANES - 1;
+
+    for (int stage = 0; stage < NUM_STAGES; ++stage)
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+            mReadOffsets[stage * NUM_LANES + lane] = lane - mDelays[stage][lane] * NUM_LANES;
+
+    const size_t ringBytes = (size_t) NUM_STAGES * (size_t) (mRingMask + 1) * sizeof (float);
+
+    if (mRing.getData() == nullptr || mRing.getSize() != ringBytes)
+        mRing.allocate (ringBytes, false);
+
+    reset();
+}
+
+void DiffusionNetwork::reset()
+{
+    if (mRing.getData() != nullptr)
+        std::memset (mRing.getData(), 0, mRing.getSize());
+
+    mWritePosition = 0;
+}
+
+bool DiffusionNetwork::isStateValid() const noexcept
+{
+    return mWritePosition >= 0 && mWritePosition <= mRingMask && mWritePosition % NUM_LANES == 0;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    DiffusionNetwork.h
+
+    Schroeder all-pass diffusion for every delay line and channel, with all
+    sections of all lanes in one contiguous ring.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "KernelDispatch.h"
+#include "DelayMemoryBlock.h"
+
+//==============================================================================
+/**
+    Lanes are laid out as in DampingFilterBank. Every lane runs a cascade of
+    NUM_DIFFUSION_STAGES all-passes whose delays are distinct primes, so no
+    two sections anywhere in the network share a common period, and the left
+    and right lanes of a line diffuse differently.
+
+    The ring holds one block of rows per stage, each row one sample of every
+    lane, and all sections write at the same position. A section's read is
+    that position plus an offset worked out in prepare, masked to the ring.
+    The saturation in front of the diffusion runs in the same kernel, see
+    KernelDispatch::Kernels::processLines.
+*/
+class DiffusionNetwork
+{
+public:
+    static const int NUM_STAGES = KernelDispatch::NUM_DIFFUSION_STAGES;
+    static const int NUM_LANES = KernelDispatch::NUM_LANES;
+
+    DiffusionNetwork();
+
+    /** Picks the delays for the sample rate and allocates the ring. Not audio-thread safe. */
+    void prepare (double sampleRate);
+    void reset();
+
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    /** Saturates and diffuses one sample of every lane in place. */
+    void process (float* lanes, float allpassGain) noexcept
+    {
+        mKernels->processLines (lanes, static_cast<float*> (mRing.getData()), mReadOffsets,
+                                mWritePosition, mRingMask, allpassGain);
+        mWritePosition = (mWritePosition + NUM_LANES) & mRingMask;
+    }
+
+    /** Calls visit (data, numBytes) for the ring and its position, see EngineSnapshot. */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        visit (mRing.getData(), mRing.getData() != nullptr ? mRing.getSize() : 0);
+        visit (&mWritePosition, sizeof (mWritePosition));
+    }
+
+    /** After a restore, whether the write position visitState copied in is a row of the ring. */
+    bool isStateValid() const noexcept;
+
+    /** Delay of one section in samples. */
+    int getDelay (int stage, int lane) const noexcept   { return mDelays[stage][lane]; }
+
+private:
+    const KernelDispatch::Kernels* mKernels;
+    DelayMemoryBlock mRing;
+    int mRingMask;          // Floats per stage, less one
+    int mWritePosition;     // Float index of the current row within a stage
+    int mDelays[NUM_STAGES][NUM_LANES];
+    int mReadOffsets[NUM_STAGES * NUM_LANES];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiffusionNetwork)
+};
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    EngineSnapshot.cpp
+
+  ==============================================================================
+*/
+
+#include "EngineSnapshot.h"
+
+namespace
+{
+    const int MAGIC = 0x324e5344;       // "DSN2"
+
+    enum BlockType
+    {
+        zeroBlock = 0,
+        rawBlock,
+        runBlock
+    };
+
+    // Zero runs and literal runs alternate, each count a 16-bit word
+    size_t encodeRuns (const juce::uint32* words, int numWords, juce::MemoryOutputStream& out)
+    {
+        const auto start = out.getPosition();
+        int i = 0;
+
+        while (i < numWords)
+        {
+            int zeros = 0;
+            while (i + zeros < numWords && words[i + zeros] == 0)
+                ++zeros;
+
+            int literals = 0;
+            while (i + zeros + literals < numWords && words[i + zeros + literals] != 0)
+                ++literals;
+
+            out.writeShort ((short) zeros);
+            out.writeShort ((short) literals);
+            out.write (words + i + zeros, (size_t) literals * sizeof (juce::uint32));
+            i += zeros + literals;
+        }
+
+        return (size_t) (out.getPosition() - start);
+    }
+
+    bool decodeRuns (juce::MemoryInputStream& in, juce::uint32* words, int numWords)
+    {
+        int i = 0;
+
+        while (i < numWords)
+        {
+            const int zeros = (juce::uint16) in.readShort();
+            const int literals = (juce::uint16) in.readShort();
+
+            if (zeros + literals == 0 || i + zeros + literals > numWords)
+                return false;
+
+            std::fill (words + i, words + i + zeros, 0u);
+            i += zeros;
+
+            const auto literalBytes = (size_t) literals * sizeof (juce::uint32);
+            if (in.read (words + i, (int) literalBytes) != (int) literalBytes)
+                return false;
+
+            i += literals;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+void EngineSnapshot::prepare (const Layout& layout, size_t numBytes)
+{
+    mLayout = layout;
+    mNumBytes = numBytes;
+    mData.assign ((numBytes + sizeof (juce::uint32) - 1) / sizeof (juce::uint32), 0u);
+}
+
+void EngineSnapshot::clear()
+{
+    mLayout = {};
+    mNumBytes = 0;
+    mData.clear();
+    mData.shrink_to_fit();
+}
+
+void EngineSnapshot::encode (juce::MemoryBlock& destination) const
+{
+    juce::MemoryOutputStream out (destination, true);
+
+    out.writeInt (MAGIC);
+    out.writeDouble (mLayout.sampleRate);
+    out.writeInt (mLayout.engine);
+    out.writeInt (mLayout.bufferLength);
+    out.writeInt (mLayout.storageFormat);
+    out.writeInt (mLayout.fftOrder);
+    out.writeBool (mLayout.interleaved);
+    out.writeInt64 ((juce::int64) mNumBytes);
+
+    // Scratch for a run-encoded block, kept only when it beats the raw words
+    juce::MemoryBlock runs;
+    const int numWords = (int) mData.size();
+
+    for (int start = 0; start < numWords; start += BLOCK_WORDS)
+    {
+        const int blockWords = juce::jmin (BLOCK_WORDS, numWords - start);
+        const juce::uint32* words = mData.data() + start;
+
+        if (std::all_of (words, words + blockWords, [] (juce::uint32 word) { return word == 0; }))
+        {
+            out.writeByte (zeroBlock);
+            continue;
+        }
+
+        runs.reset();
+        juce::MemoryOutputStream runOut (runs, false);
+        const size_t runBytes = encodeRuns (words, blockWords, runOut);
+        runOut.flush();
+
+        if (runBytes < (size_t) blockWords * sizeof (juce::uint32))
+        {
+            out.writeByte (runBlock);
+            out.write (runOut.getData(), runBytes);
+        }
+        else
+        {
+            out.writeByte (rawBlock);
+            out.write (words, (size_t) blockWords * sizeof (juce::uint32));
+        }
+    }
+}
+
+bool EngineSnapshot::decode (const void* data, size_t numBytes)
+{
+    clear();
+    juce::MemoryInputStream in (data, numBytes, false);
+
+    const int magic = numBytes >= 40 ? in.readInt() : 0;
+    if (magic != MAGIC)
+        return false;
+
+    Layout layout;
+    layout.sampleRate = in.readDouble();
+    layout.engine = in.readInt();
+    layout.bufferLength = in.readInt();
+    layout.storageFormat = in.readInt();
+    layout.fftOrder = in.readInt();
+    layout.interleaved = in.readBool();
+    const auto stateBytes = in.readInt64();
+
+    // Even all-zero blocks take a byte each, which bounds what the data can hold
+    const auto maxBytes = (juce::int64) numBytes * BLOCK_WORDS * (juce::int64) sizeof (juce::uint32);
+    if (stateBytes <= 0 || stateBytes > maxBytes)
+        return false;
+
+    prepare (layout, (size_t) stateBytes);
+    const int numWords = (int) mData.size();
+
+    for (int start = 0; start < numWords; start += BLOCK_WORDS)
+    {
+        const int blockWords = juce::jmin (BLOCK_WORDS, numWords - start);
+        juce::uint32* words = mData.data() + start;
+        bool ok = true;
+
+        switch (in.readByte())
+        {
+            case zeroBlock:
+                break;
+
+            case rawBlock:
+            {
+                const auto blockBytes = (int) ((size_t) blockWords * sizeof (juce::uint32));
+                ok = in.read (words, blockBytes) == blockBytes;
+                break;
+            }
+
+            case runBlock:
+                ok = decodeRuns (in, words, blockWords);
+                break;
+
+            default:
+                ok = false;
+                break;
+        }
+
+        if (! ok)
+        {
+            clear();
+            return false;
+        }
+    }
+
+    return true;
+}
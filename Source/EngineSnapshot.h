@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    EngineSnapshot.h
+
+    The running state of the engine, delay memory included, gathered into
+    one block and stored compressed with the plugin state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The engine and its parts report their state as a sequence of raw
+    sections through visitState functions, each calling visit (data,
+    numBytes). capture copies the sections into one block, and restore copies
+    them back in the same order. Both need the engine prepared exactly as
+    the Layout describes. A snapshot made for a different sample rate,
+    engine or buffer is refused, and the engine keeps its cleared state.
+    restore copies bytes without looking at them, so the engine checks every
+    position and count it got back, and clears itself again if one is out of
+    range.
+
+    The block compressor works on 32-bit words in runs of BLOCK_WORDS. An
+    all-zero block costs one byte, which covers silence and unused delay
+    memory. Other blocks store their zero runs as counts and everything
+    else verbatim, whichever is smaller. Audio that isn't silent doesn't
+    compress much, but encoding runs at memory speed.
+
+    Capture and restore are plain copies. encode and decode do the work, and
+    run on the message thread. Both copies can also go through a function
+    that copies each section itself, so that an engine that kept running
+    during a first copy only needs what it changed since copied again.
+*/
+class EngineSnapshot
+{
+public:
+    static const int BLOCK_WORDS = 1024;
+
+    /** What the engine was prepared for. */
+    struct Layout
+    {
+        double sampleRate = 0.0;
+        int engine = 0;
+        int bufferLength = 0;
+        int storageFormat = 0;
+        int fftOrder = 0;
+        bool interleaved = false;
+
+        bool operator== (const Layout& other) const noexcept
+        {
+            return sampleRate == other.sampleRate && engine == other.engine && bufferLength == other.bufferLength
+                && storageFormat == other.storageFormat && fftOrder == other.fftOrder && interleaved == other.interleaved;
+        }
+    };
+
+    EngineSnapshot() = default;
+
+    /** Bytes the visitState function reports. */
+    template <typename VisitState>
+    static size_t measure (VisitState&& visitState)
+    {
+        size_t numBytes = 0;
+        auto visit = [&numBytes] (const void*, size_t sectionBytes) { numBytes += sectionBytes; };
+        visitState (visit);
+        return numBytes;
+    }
+
+    /** Sizes the block for numBytes of state. Allocates, so call it before capture,
+        outside anything the audio thread waits on.
+    */
+    void prepare (const Layout& layout, size_t numBytes);
+
+    /** Copies the reported state in. False if it no longer matches prepare. */
+    template <typename VisitState>
+    bool capture (VisitState&& visitState)
+    {
+        return capture (visitState, [] (const void* data, void* destination, size_t numBytes)
+        {
+            std::memcpy (destination, data, numBytes);
+        });
+    }
+
+    /** The same with copySection (data, destination, numBytes) copying each
+        section that isn't empty, all of it or the part that changed.
+    */
+    template <typename VisitState, typename CopySection>
+    bool capture (VisitState&& visitState, CopySection&& copySection)
+    {
+        size_t offset = 0;
+        bool fits = true;
+
+        auto visit = [this, &offset, &fits, &copySection] (const void* data, size_t sectionBytes)
+        {
+            fits = fits && offset + sectionBytes <= mNumBytes;
+
+            if (fits && sectionBytes > 0)
+                copySection (data, reinterpret_cast<char*> (mData.data()) + offset, sectionBytes);
+
+            offset += sectionBytes;
+        };
+
+        visitState (visit);
+        return fits && offset == mNumBytes;
+    }
+
+    /** Copies the state back into an engine prepared for layout. Nothing is
+        written, and false returned, unless the layout and every section match.
+    */
+    template <typename VisitState>
+    bool restore (const Layout& layout, VisitState&& visitState) const
+    {
+        return restore (layout, visitState, [] (void* data, const void* source, size_t numBytes)
+        {
+            std::memcpy (data, source, numBytes);
+        });
+    }
+
+    /** The same with copySection (data, source, numBytes) copying each section
+        that isn't empty, all of it, part of it or none.
+    */
+    template <typename VisitState, typename CopySection>
+    bool restore (const Layout& layout, VisitState&& visitState, CopySection&& copySection) const
+    {
+        if (isEmpty() || ! (layout == mLayout) || measure (visitState) != mNumBytes)
+            return false;
+
+        size_t offset = 0;
+
+        auto visit = [this, &offset, &copySection] (void* data, size_t sectionBytes)
+        {
+            if (sectionBytes > 0)
+                copySection (data, reinterpret_cast<const char*> (mData.data()) + offset, sectionBytes);
+
+            offset += sectionBytes;
+        };
+
+        visitState (visit);
+        return true;
+    }
+
+    /** Appends the header and the compressed state. */
+    void encode (juce::MemoryBlock& destination) const;
+
+    /** Reads what encode wrote. Leaves the snapshot empty if the data is damaged. */
+    bool decode (const void* data, size_t numBytes);
+
+    bool isEmpty() const noexcept   { return mNumBytes == 0; }
+    void clear();
+
+private:
+    Layout mLayout;
+    size_t mNumBytes = 0;
+    std::vector<juce::uint32> mData;    // Whole words, the padding past mNumBytes zeroed
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EngineSnapshot)
+};
@@ -0,0 +1,306 @@
+/*
+  ==============================================================================
+
+    GranularCloud.cpp
+
+  ==============================================================================
+*/
+
+#include "GranularCloud.h"
+
+namespace
+{
+    // Window shapes over x from 0 to 1, all 0 at both ends
+    float windowShape (GranularCloud::Window window, float x)
+    {
+        const float twoPi = juce::MathConstants<float>::twoPi;
+
+        switch (window)
+        {
+            case GranularCloud::Window::triangle:
+                return 1.0f - std::abs (2.0f * x - 1.0f);
+
+            case GranularCloud::Window::tukey:
+            {
+                // Cosine tapers over the first and last quarter, flat in between
+                const float edge = std::min (x, 1.0f - x);
+                return edge < 0.25f ? 0.5f - 0.5f * std::cos (2.0f * twoPi * edge) : 1.0f;
+            }
+
+            case GranularCloud::Window::hann:
+            default:
+                return 0.5f - 0.5f * std::cos (twoPi * x);
+        }
+    }
+}
+
+//==============================================================================
+GranularCloud::GranularCloud()
+{
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+    mSampleRate = 44100.0;
+
+    setSettings ({});
+
+    mWindowTables.assign ((size_t) (NUM_WINDOWS * WINDOW_TABLE_STRIDE), 0.0f);
+
+    for (int window = 0; window < NUM_WINDOWS; ++window)
+    {
+        float* table = mWindowTables.data() + window * WINDOW_TABLE_STRIDE;
+
+        // The end point stays 0, and one more past it covers rounding in the last step
+        for (int i = 1; i < WINDOW_TABLE_SIZE; ++i)
+            table[i] = windowShape ((Window) window, (float) i / WINDOW_TABLE_SIZE);
+    }
+
+    mBatch.segments = mSegments;
+    mBatch.segmentStride = SEGMENT_STRIDE;
+    mBatch.windows = mWindowTables.data();
+    mBatch.windowSize = WINDOW_TABLE_SIZE;
+    mBatch.numGrains = 0;
+
+    reset();
+}
+
+void GranularCloud::prepare (double sampleRate)
+{
+    mSampleRate = sampleRate;
+    reset();
+}
+
+void GranularCloud::reset() noexcept
+{
+    // Popped from the end, so slot 0 goes first
+    for (int slot = 0; slot < MAX_GRAINS; ++slot)
+    {
+        mFreeList[slot] = MAX_GRAINS - 1 - slot;
+        mActive[slot] = 0;
+        mPosition[slot] = 0;
+        mFraction[slot] = 0.0f;
+        mRate[slot] = 1.0f;
+        mPhase[slot] = 0.0f;
+        mPhaseIncrement[slot] = 0.0f;
+        mGainLeft[slot] = 0.0f;
+        mGainRight[slot] = 0.0f;
+        mWindowOffset[slot] = 0;
+        mSamplesLeft[slot] = 0;
+    }
+
+    mNumFree = MAX_GRAINS;
+    mNumActive = 0;
+    mNumDropped = 0;
+    mNumSpawned = 0;
+    mChunkPosition = 0;
+    mSamplesToNextGrain = 0.0f;
+    mRandomState = 0x12345678;
+}
+
+bool GranularCloud::isStateValid (int bufferLength) const noexcept
+{
+    if (mNumActive < 0 || mNumFree < 0 || mNumActive + mNumFree != MAX_GRAINS
+         || mChunkPosition < 0 || mChunkPosition >= CHUNK_SIZE)
+        return false;
+
+    // Every slot on exactly one of the two lists
+    bool listed[MAX_GRAINS] = {};
+
+    auto list = [&listed] (int slot)
+    {
+        if (slot < 0 || slot >= MAX_GRAINS || listed[slot])
+            return false;
+
+        listed[slot] = true;
+        return true;
+    };
+
+    for (int i = 0; i < mNumFree; ++i)
+        if (! list (mFreeList[i]))
+            return false;
+
+    for (int i = 0; i < mNumActive; ++i)
+    {
+        const int slot = mActive[i];
+
+        if (! list (slot))
+            return false;
+
+        // What processChunk reads: a chunk's segment at up to twice the speed, and the
+        // window up to its last sample. The comparisons are false for NaNs as well
+        const float lastWindow = (mPhase[slot] + (float) (mSamplesLeft[slot] - 1) * mPhaseIncrement[slot]) * WINDOW_TABLE_SIZE;
+
+        if (mPosition[slot] < 0 || mPosition[slot] >= bufferLength
+             || ! (mFraction[slot] >= 0.0f && mFraction[slot] <= 1.0f)
+             || ! (mRate[slot] >= 0.5f && mRate[slot] <= 2.0f)
+             || mSamplesLeft[slot] <= 0
+             || ! (mPhase[slot] >= 0.0f && mPhaseIncrement[slot] >= 0.0f && lastWindow < (float) (WINDOW_TABLE_STRIDE - 1))
+             || mWindowOffset[slot] < 0 || mWindowOffset[slot] % WINDOW_TABLE_STRIDE != 0
+             || mWindowOffset[slot] / WINDOW_TABLE_STRIDE >= NUM_WINDOWS)
+            return false;
+    }
+
+    return true;
+}
+
+void GranularCloud::setSettings (const Settings& settings) noexcept
+{
+    mDensity = juce::jlimit (0.1f, MAX_DENSITY, settings.density);
+    mGrainSeconds = juce::jlimit (MIN_GRAIN_SECONDS, MAX_GRAIN_SECONDS, settings.grainSeconds);
+    mPositionSpread = std::max (0.0f, settings.positionSpread);
+    mPitchSpread = juce::jlimit (0.0f, MAX_PITCH_SPREAD, settings.pitchSpread);
+    mWindow = juce::jlimit (0, NUM_WINDOWS - 1, (int) settings.window);
+}
+
+GranularCloud::Settings GranularCloud::getSettings() const noexcept
+{
+    Settings settings;
+    settings.density = mDensity;
+    settings.grainSeconds = mGrainSeconds;
+    settings.positionSpread = mPositionSpread;
+    settings.pitchSpread = mPitchSpread;
+    settings.window = (Window) mWindow.load();
+    return settings;
+}
+
+float GranularCloud::nextRandom() noexcept
+{
+    // The same 32-bit LCG as the int16 dither, so renders repeat exactly
+    mRandomState = mRandomState * 1664525u + 1013904223u;
+    return (float) (mRandomState >> 8) * (1.0f / 16777216.0f);
+}
+
+//==============================================================================
+void GranularCloud::process (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int blockStart,
+                             float* left, float* right, int numSamples, float delaySamples, float gain) noexcept
+{
+    // Samples older than this have been overwritten by the block
+    const float maxDelay = (float) (bufferLeft.getLength() - numSamples - 4);
+
+    if (maxDelay < 2.0f)
+        return;
+
+    // A chunk the last block didn't finish is carried on first
+    for (int start = 0; start < numSamples;)
+    {
+        const int chunkSamples = juce::jmin (CHUNK_SIZE - mChunkPosition, numSamples - start);
+        processChunk (bufferLeft, bufferRight, blockStart + start, left + start, right + start,
+                      chunkSamples, delaySamples, gain, maxDelay);
+        start += chunkSamples;
+    }
+}
+
+void GranularCloud::spawnGrain (int chunkStart, int bufferLength, int grainLength, float delaySamples, float maxDelay) noexcept
+{
+    ++mNumSpawned;
+
+    if (mNumFree == 0)
+    {
+        ++mNumDropped;
+        return;
+    }
+
+    const float rate = std::exp2 ((2.0f * nextRandom() - 1.0f) * mPitchSpread / 12.0f);
+    const float offset = (2.0f * nextRandom() - 1.0f) * mPositionSpread * (float) mSampleRate;
+    const float pan = nextRandom() * juce::MathConstants<float>::halfPi;
+
+    // Faster than the write head the grain's delay shrinks over its length, slower
+    // it grows; either way it has to stay between written and overwritten samples
+    const float drift = (rate - 1.0f) * grainLength;
+    const float lowest = 2.0f + std::max (drift, 0.0f);
+    const float highest = maxDelay + std::min (drift, 0.0f);
+
+    if (lowest > highest)
+        return;
+
+    const double start = (double) chunkStart - juce::jlimit (lowest, highest, delaySamples + offset);
+    const int position = (int) std::floor (start);
+
+    // Overlapping grains add up, so keep the cloud's level near one grain's
+    const float level = 1.0f / std::sqrt (std::max (1.0f, mDensity * mGrainSeconds));
+
+    const int slot = mFreeList[--mNumFree];
+    mActive[mNumActive++] = slot;
+
+    mPosition[slot] = ((position % bufferLength) + bufferLength) % bufferLength;
+    mFraction[slot] = (float) (start - position);
+    mRate[slot] = rate;
+    mPhase[slot] = 0.0f;
+    mPhaseIncrement[slot] = 1.0f / grainLength;
+    mGainLeft[slot] = level * std::cos (pan);
+    mGainRight[slot] = level * std::sin (pan);
+    mWindowOffset[slot] = mWindow * WINDOW_TABLE_STRIDE;
+    mSamplesLeft[slot] = grainLength;
+}
+
+void GranularCloud::processChunk (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int chunkStart,
+                                  float* left, float* right, int numSamples, float delaySamples, float gain, float maxDelay) noexcept
+{
+    const int bufferLength = bufferLeft.getLength();
+    const int grainLength = std::max (1, juce::roundToInt (mGrainSeconds * mSampleRate));
+
+    // Grains only start where a chunk does, whichever call that falls in
+    if (mChunkPosition == 0)
+    {
+        mSamplesToNextGrain -= CHUNK_SIZE;
+
+        for (int spawned = 0; mSamplesToNextGrain <= 0.0f && spawned < MAX_SPAWNS_PER_CHUNK; ++spawned)
+        {
+            spawnGrain (chunkStart, bufferLength, grainLength, delaySamples, maxDelay);
+            mSamplesToNextGrain += (float) mSampleRate / mDensity * (0.5f + nextRandom());
+        }
+
+        // Whatever is still due is over the bound and skipped
+        mSamplesToNextGrain = std::max (mSamplesToNextGrain, 0.0f);
+    }
+
+    mChunkPosition = (mChunkPosition + numSamples) % CHUNK_SIZE;
+
+    for (int first = 0; first < mNumActive; first += BATCH_SIZE)
+    {
+        const int numGrains = juce::jmin (BATCH_SIZE, mNumActive - first);
+        mBatch.numGrains = numGrains;
+
+        for (int grain = 0; grain < numGrains; ++grain)
+        {
+            const int slot = mActive[first + grain];
+
+            // Everything the grain reads in this chunk, plus the sample after it
+            float* segment = mSegments + grain * SEGMENT_STRIDE;
+            const int span = (int) (mFraction[slot] + numSamples * mRate[slot]) + 2;
+
+            DelayLineStorage::readContiguousMono (bufferLeft, bufferRight, mPosition[slot], segment, mSegmentFrames, span);
+
+            mBatch.numSamples[grain] = std::min (numSamples, mSamplesLeft[slot]);
+            mBatch.windowOffset[grain] = mWindowOffset[slot];
+            mBatch.fraction[grain] = mFraction[slot];
+            mBatch.rate[grain] = mRate[slot];
+            mBatch.phase[grain] = mPhase[slot];
+            mBatch.phaseIncrement[grain] = mPhaseIncrement[slot];
+            mBatch.gainLeft[grain] = mGainLeft[slot] * gain;
+            mBatch.gainRight[grain] = mGainRight[slot] * gain;
+        }
+
+        mKernels->renderGrains (mBatch, left, right);
+    }
+
+    // Move every grain on, and put the finished ones back on the free-list
+    for (int i = 0; i < mNumActive;)
+    {
+        const int slot = mActive[i];
+        const float advanced = mFraction[slot] + numSamples * mRate[slot];
+        const int whole = (int) advanced;
+
+        mPosition[slot] = (mPosition[slot] + whole) % bufferLength;
+        mFraction[slot] = advanced - whole;
+        mPhase[slot] += numSamples * mPhaseIncrement[slot];
+        mSamplesLeft[slot] -= numSamples;
+
+        if (mSamplesLeft[slot] > 0)
+        {
+            ++i;
+            continue;
+        }
+
+        mFreeList[mNumFree++] = slot;
+        mActive[i] = mActive[--mNumActive];
+    }
+}
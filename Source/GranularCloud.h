@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    GranularCloud.h
+
+    A cloud of short grains read from the delay lines' circular buffers at
+    random positions, pitches and pans, from a fixed pool of grain slots.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayLineStorage.h"
+#include "KernelDispatch.h"
+
+//==============================================================================
+/**
+    Grains live in MAX_GRAINS preallocated slots, held as one array per
+    field. Free slots sit on a free-list stack, and the slots in use are
+    kept in a packed list. Spawning pops a slot and retiring pushes it back,
+    so nothing is allocated after construction. When the pool is empty a new
+    grain is dropped, not delayed.
+
+    Like MultiTapDelay, the cloud reads the buffers after the lines engine
+    has written its block. It reads the mono sum of both channels. Grains
+    start on CHUNK_SIZE boundaries counted from the last reset, not from the
+    block, so the host's block size doesn't move them. At most
+    MAX_SPAWNS_PER_CHUNK start per chunk, with random intervals around the
+    density. Each grain reads the segment it spans in a chunk in one go. The
+    renderGrains kernel then resamples GRAIN_BATCH grains per call, applies
+    their windows from tables and pans them into both channels.
+
+    Hard bound: a chunk spawns at most MAX_SPAWNS_PER_CHUNK grains and
+    renders at most MAX_GRAINS. A block of N samples starts at most
+    ceil (N / CHUNK_SIZE) chunks and touches at most one more, so it never
+    spawns more than MAX_SPAWNS_PER_CHUNK * ceil (N / CHUNK_SIZE) grains or
+    does more than MAX_GRAINS * (ceil (N / CHUNK_SIZE) + 1) grain-chunks of
+    work, whatever the settings.
+*/
+class GranularCloud
+{
+public:
+    static const int MAX_GRAINS = 128;
+    static const int CHUNK_SIZE = 64;
+    static const int MAX_SPAWNS_PER_CHUNK = 4;
+    static const int BATCH_SIZE = KernelDispatch::GRAIN_BATCH;
+    static const int WINDOW_TABLE_SIZE = 512;
+    static const int WINDOW_TABLE_STRIDE = WINDOW_TABLE_SIZE + 2;
+    static const int SEGMENT_STRIDE = 2 * CHUNK_SIZE + 4;           // A chunk's span at twice the speed
+
+    static constexpr float MAX_DENSITY = 500.0f;            // Grains per second
+    static constexpr float MIN_GRAIN_SECONDS = 0.01f;
+    static constexpr float MAX_GRAIN_SECONDS = 0.5f;
+    static constexpr float MAX_PITCH_SPREAD = 12.0f;        // Semitones, so grains play at half to twice the speed
+
+    enum class Window
+    {
+        hann = 0,
+        triangle,
+        tukey
+    };
+
+    static const int NUM_WINDOWS = 3;
+
+    struct Settings
+    {
+        float density = 20.0f;
+        float grainSeconds = 0.1f;
+        float positionSpread = 0.25f;       // Seconds either side of the delay time
+        float pitchSpread = 0.0f;           // Semitones either side of the original pitch
+        Window window = Window::hann;
+    };
+
+    GranularCloud();
+
+    void prepare (double sampleRate);
+
+    /** Retires every grain and restarts the random sequence. */
+    void reset() noexcept;
+
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    /** Any thread. Grains already playing keep the settings they started with. */
+    void setSettings (const Settings& settings) noexcept;
+    Settings getSettings() const noexcept;
+
+    /** Adds the cloud to left and right, scaled by gain, for the numSamples written to the
+        buffers from blockStart on. Grains start around delaySamples behind the write head.
+    */
+    void process (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int blockStart,
+                  float* left, float* right, int numSamples, float delaySamples, float gain) noexcept;
+
+    int getNumActiveGrains() const noexcept     { return mNumActive; }
+
+    /** Grains the schedule has called for since the last reset, dropped ones included. */
+    uint32_t getNumSpawnedGrains() const noexcept   { return mNumSpawned; }
+
+    /** Grains not spawned because the pool was full, since the last reset. */
+    int getNumDroppedGrains() const noexcept    { return mNumDropped; }
+
+    /** Calls visit (data, numBytes) for the pool, its lists and the random state, see EngineSnapshot. */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        for (auto* field : { mFraction, mRate, mPhase, mPhaseIncrement, mGainLeft, mGainRight })
+            visit (field, MAX_GRAINS * sizeof (float));
+
+        for (auto* field : { mPosition, mWindowOffset, mSamplesLeft, mFreeList, mActive })
+            visit (field, MAX_GRAINS * sizeof (int));
+
+        visit (&mNumFree, sizeof (mNumFree));
+        visit (&mNumActive, sizeof (mNumActive));
+        visit (&mNumDropped, sizeof (mNumDropped));
+        visit (&mNumSpawned, sizeof (mNumSpawned));
+        visit (&mChunkPosition, sizeof (mChunkPosition));
+        visit (&mSamplesToNextGrain, sizeof (mSamplesToNextGrain));
+        visit (&mRandomState, sizeof (mRandomState));
+    }
+
+    /** After a restore, whether the lists visitState copied in hold every slot once and
+        each playing grain reads inside a buffer of bufferLength and its window table.
+    */
+    bool isStateValid (int bufferLength) const noexcept;
+
+private:
+    float nextRandom() noexcept;
+    void spawnGrain (int chunkStart, int bufferLength, int grainLength, float delaySamples, float maxDelay) noexcept;
+    void processChunk (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int chunkStart,
+                       float* left, float* right, int numSamples, float delaySamples, float gain, float maxDelay) noexcept;
+
+    const KernelDispatch::Kernels* mKernels;
+    double mSampleRate;
+
+    std::atomic<float> mDensity;
+    std::atomic<float> mGrainSeconds;
+    std::atomic<float> mPositionSpread;
+    std::atomic<float> mPitchSpread;
+    std::atomic<int> mWindow;
+
+    // Window tables back to back, WINDOW_TABLE_STRIDE apart with zeros after the end
+    std::vector<float> mWindowTables;
+
+    // The pool, one entry per slot. A grain reads from mPosition + mFraction,
+    // mRate samples a sample, through its window from mPhase to 1
+    int mPosition[MAX_GRAINS];
+    float mFraction[MAX_GRAINS];
+    float mRate[MAX_GRAINS];
+    float mPhase[MAX_GRAINS];
+    float mPhaseIncrement[MAX_GRAINS];
+    float mGainLeft[MAX_GRAINS];
+    float mGainRight[MAX_GRAINS];
+    int mWindowOffset[MAX_GRAINS];
+    int mSamplesLeft[MAX_GRAINS];
+
+    int mFreeList[MAX_GRAINS];
+    int mNumFree;
+    int mActive[MAX_GRAINS];
+    int mNumActive;
+    int mNumDropped;
+    uint32_t mNumSpawned;               // Wraps, only differences mean anything
+
+    int mChunkPosition;                 // Samples of the current chunk already processed
+    float mSamplesToNextGrain;
+    uint32_t mRandomState;
+
+    // What one kernel call renders, and the segments it reads
+    KernelDispatch::GrainBatch mBatch;
+    float mSegments[BATCH_SIZE * SEGMENT_STRIDE];
+    float mSegmentFrames[2 * SEGMENT_STRIDE];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GranularCloud)
+};
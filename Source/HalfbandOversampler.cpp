@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    HalfbandOversampler.cpp
+
+  ==============================================================================
+*/
+
+#include "HalfbandOversampler.h"
+
+//==============================================================================
+HalfbandOversampler::HalfbandOversampler()
+{
+    design (mCoefficients, NUM_COEFFICIENTS, TRANSITION_BANDWIDTH);
+
+    // The linear part of process() is both chains in series, each section
+    // (a + z^-1) / (1 + a z^-1) adding (1 - a) / (1 + a) samples at DC
+    mGroupDelay = 0.0f;
+    for (int i = 0; i < NUM_COEFFICIENTS; ++i)
+        mGroupDelay += (1.0f - mCoefficients[i]) / (1.0f + mCoefficients[i]);
+
+    reset();
+}
+
+void HalfbandOversampler::reset()
+{
+    for (int i = 0; i < NUM_COEFFICIENTS; ++i)
+    {
+        mUpState.x[i] = mUpState.y[i] = 0.0f;
+        mDownState.x[i] = mDownState.y[i] = 0.0f;
+    }
+}
+
+//==============================================================================
+void HalfbandOversampler::design (float* coefficients, int numCoefficients, double transition)
+{
+    // Elliptic half-band design for a given transition bandwidth, as in HIIR's PolyphaseIir2Designer
+    double k = std::tan ((1.0 - 2.0 * transition) * M_PI / 4.0);
+    k *= k;
+
+    const double kksqrt = std::pow (1.0 - k * k, 0.25);
+    const double e = 0.5 * (1.0 - kksqrt) / (1.0 + kksqrt);
+    const double e4 = e * e * e * e;
+    const double q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+
+    const int order = numCoefficients * 2 + 1;
+
+    for (int index = 0; index < numCoefficients; ++index)
+    {
+        const int c = index + 1;
+
+        double numerator = 0.0, term = 0.0, sign = 1.0;
+
+        for (int i = 0; i == 0 || std::abs (term) > 1.0e-100; ++i, sign = -sign)
+        {
+            term = std::pow (q, i * (i + 1)) * std::sin ((i * 2 + 1) * c * M_PI / order) * sign;
+            numerator += term;
+        }
+
+        double denominator = 0.0;
+        sign = -1.0;
+
+        for (int i = 1; i == 1 || std::abs (term) > 1.0e-100; ++i, sign = -sign)
+        {
+            term = std::pow (q, i * i) * std::cos (i * 2 * c * M_PI / order) * sign;
+            denominator += term;
+        }
+
+        const double ww = numerator * std::pow (q, 0.25) / (denominator + 0.5);
+        const double wwsq = ww * ww;
+        const double x = std::sqrt ((1.0 - wwsq * k) * (1.0 - wwsq / k)) / (1.0 + wwsq);
+
+        coefficients[index] = (float) ((1.0 - x) / (1.0 + x));
+    }
+}
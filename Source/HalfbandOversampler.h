@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    HalfbandOversampler.h
+
+    Runs a memoryless nonlinearity at twice the sample rate, so the
+    harmonics it adds above Nyquist are filtered out instead of folding
+    back as aliases.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Both rate changes use the same polyphase IIR half-band filter: two chains
+    of first-order all-pass sections running at the base rate, after
+    L. de Soras' HIIR. The pair delays the signal by getGroupDelay() base
+    rate samples at low frequencies, a little more towards the band edge.
+    Nothing is reported as latency since this only runs on the wet signal,
+    but callers with it inside a feedback loop have to shorten the loop.
+*/
+class HalfbandOversampler
+{
+public:
+    static const int NUM_COEFFICIENTS = 8;      // About 100 dB of image rejection above 0.54 fs
+    static constexpr double TRANSITION_BANDWIDTH = 0.04;
+
+    HalfbandOversampler();
+
+    void reset();
+
+    /** Delay of the up and down pair at DC, in base rate samples. */
+    float getGroupDelay() const noexcept    { return mGroupDelay; }
+
+    /** Calls visit (data, numBytes) for both filter states, see EngineSnapshot. */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        visit (&mUpState, sizeof (mUpState));
+        visit (&mDownState, sizeof (mDownState));
+    }
+
+    /** Upsamples one sample, applies the function to both results and downsamples again. */
+    template <typename Function>
+    float process (float input, Function&& nonlinearity) noexcept
+    {
+        float even = input, odd = input;
+        runChain (mUpState, 0, even);
+        runChain (mUpState, 1, odd);
+
+        float shapedEven = nonlinearity (even);
+        float shapedOdd = nonlinearity (odd);
+
+        runChain (mDownState, 0, shapedOdd);
+        runChain (mDownState, 1, shapedEven);
+        return 0.5f * (shapedOdd + shapedEven);
+    }
+
+private:
+    struct State
+    {
+        float x[NUM_COEFFICIENTS];
+        float y[NUM_COEFFICIENTS];
+    };
+
+    /** Sections first, first + 2, ... of one all-pass chain. */
+    void runChain (State& state, int first, float& sample) const noexcept
+    {
+        for (int i = first; i < NUM_COEFFICIENTS; i += 2)
+        {
+            const float out = (sample - state.y[i]) * mCoefficients[i] + state.x[i];
+            state.x[i] = sample;
+            state.y[i] = out;
+            sample = out;
+        }
+    }
+
+    static void design (float* coefficients, int numCoefficients, double transition);
+
+    float mCoefficients[NUM_COEFFICIENTS];
+    float mGroupDelay;
+    State mUpState;
+    State mDownState;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HalfbandOversampler)
+};
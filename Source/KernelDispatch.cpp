@@ -0,0 +1,451 @@
+/*
+  ==============================================================================
+
+    KernelDispatch.cpp
+
+  ==============================================================================
+*/
+
+#include "KernelDispatch.h"
+#include "DelayKernels.h"
+#include "DelayLineStorage.h"
+
+#if JUCE_INTEL && (JUCE_GCC || JUCE_CLANG)
+ #include <immintrin.h>
+ #include <cpuid.h>
+ #define DELAY_KERNELS_MULTIVERSION 1
+#else
+ #define DELAY_KERNELS_MULTIVERSION 0
+#endif
+
+// Both compilers fuse a * b + c wherever the target has FMA, which AVX-512
+// implies, and that would round differently from the other builds
+#if JUCE_CLANG
+ #define DELAY_KERNELS_NO_CONTRACT _Pragma ("clang fp contract(off)")
+#else
+ #define DELAY_KERNELS_NO_CONTRACT
+#endif
+
+// GCC needs the same per function. It also won't turn branches into selects
+// while comparisons may raise floating point exceptions, which nothing here looks at
+#if JUCE_GCC && ! JUCE_CLANG
+ #define DELAY_KERNELS_GCC_OPTIONS , optimize ("fp-contract=off", "no-trapping-math")
+ #define DELAY_KERNELS_PORTABLE_TARGET __attribute__ ((optimize ("fp-contract=off", "no-trapping-math")))
+#else
+ #define DELAY_KERNELS_GCC_OPTIONS
+ #define DELAY_KERNELS_PORTABLE_TARGET
+#endif
+
+namespace KernelDispatch
+{
+namespace
+{
+    //==============================================================================
+    // The kernel bodies, written once. Each variant below is a thin function with
+    // its own target attribute that these are forced into, so the compiler
+    // vectorises the same source for every instruction set.
+
+    // std::abs itself won't inline into functions built with different options
+    forcedinline float absolute (float x) noexcept
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+        bits &= 0x7fffffffu;
+        std::memcpy (&x, &bits, sizeof (x));
+        return x;
+    }
+
+    forcedinline void processLinesBody (float* __restrict lanes, float* __restrict ring, const int* __restrict readOffsets,
+                                        int writePosition, int ringMask, float allpassGain) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        const float compensationFactor = 0.5f;
+
+        // DelayKernels::softClip, with every segment computed for every lane and
+        // then picked, so the branches become vector selects
+        float knee[NUM_LANES];
+
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            const float t = 2.0f - 3.0f * absolute (lanes[lane]);
+            knee[lane] = lanes[lane] * (3.0f - t * t) / 3.0f;
+        }
+
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            const float x = lanes[lane];
+            const float absX = absolute (x);
+            const float limit = x > 0.0f ? 1.0f : -1.0f;
+            const float upper = absX <= 2.0f / 3.0f ? knee[lane] : limit;
+            lanes[lane] = (absX <= 1.0f / 3.0f ? 2.0f * x : upper) * compensationFactor;
+        }
+
+        // Schroeder all-passes, w = x + g w[n - d] and y = w[n - d] - g w. Each stage
+        // first gathers its delayed row, so the arithmetic and the row written back
+        // are plain vector operations across the lanes
+        for (int stage = 0; stage < NUM_DIFFUSION_STAGES; ++stage)
+        {
+            float* stageRing = ring + stage * (ringMask + 1);
+            const int* offsets = readOffsets + stage * NUM_LANES;
+            float delayed[NUM_LANES];
+
+            for (int lane = 0; lane < NUM_LANES; ++lane)
+                delayed[lane] = stageRing[(writePosition + offsets[lane]) & ringMask];
+
+            float* written = stageRing + writePosition;
+
+            for (int lane = 0; lane < NUM_LANES; ++lane)
+            {
+                const float w = lanes[lane] + allpassGain * delayed[lane];
+                written[lane] = w;
+                lanes[lane] = delayed[lane] - allpassGain * w;
+            }
+        }
+    }
+
+    forcedinline void svfHighCutBody (float* __restrict x, float* __restrict ic1, float* __restrict ic2, float a1, float a2, float a3) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            const float s1 = ic1[lane];
+            const float s2 = ic2[lane];
+            const float v3 = x[lane] - s2;
+            const float v1 = a1 * s1 + a2 * v3;
+            const float v2 = s2 + a2 * s1 + a3 * v3;
+            ic1[lane] = 2.0f * v1 - s1;
+            ic2[lane] = 2.0f * v2 - s2;
+            x[lane] = v2;
+        }
+    }
+
+    forcedinline void svfLowCutBody (float* __restrict x, float* __restrict ic1, float* __restrict ic2, float k, float a1, float a2, float a3) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            const float s1 = ic1[lane];
+            const float s2 = ic2[lane];
+            const float v0 = x[lane];
+            const float v3 = v0 - s2;
+            const float v1 = a1 * s1 + a2 * v3;
+            const float v2 = s2 + a2 * s1 + a3 * v3;
+            ic1[lane] = 2.0f * v1 - s1;
+            ic2[lane] = 2.0f * v2 - s2;
+            x[lane] = v0 - k * v1 - v2;
+        }
+    }
+
+    forcedinline void interpolateFixedPhaseBody (const float* __restrict source, float inPhase, float* __restrict out, int numSamples) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        for (int k = 0; k < numSamples; ++k)
+            out[k] = (1 - inPhase) * source[k] + inPhase * source[k + 1];
+    }
+
+    forcedinline void crossfadeBody (const float* from, const float* to, const float* fadeIn, float* out, int numSamples) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        for (int k = 0; k < numSamples; ++k)
+            out[k] = from[k] + fadeIn[k] * (to[k] - from[k]);
+    }
+
+    forcedinline float interpolatedDotProductBody (const float* __restrict x, const float* __restrict c0, const float* __restrict c1,
+                                                   float fraction, int numTaps) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        // One partial sum per lane, added up in the same order by every build
+        float sums[DOT_PRODUCT_WIDTH] = {};
+
+        for (int i = 0; i < numTaps; i += DOT_PRODUCT_WIDTH)
+        {
+            for (int lane = 0; lane < DOT_PRODUCT_WIDTH; ++lane)
+            {
+                const float c = c0[i + lane] + fraction * (c1[i + lane] - c0[i + lane]);
+                sums[lane] += x[i + lane] * c;
+            }
+        }
+
+        static_assert (DOT_PRODUCT_WIDTH == 8, "The final sum adds eight lanes");
+        return ((sums[0] + sums[4]) + (sums[2] + sums[6])) + ((sums[1] + sums[5]) + (sums[3] + sums[7]));
+    }
+
+    forcedinline void mixTapsBody (const float* __restrict rows, int rowStride, const float* __restrict ramps, int numRows,
+                                   float* __restrict left, float* __restrict right, int numSamples) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        int row = 0;
+
+        // Four rows per pass through the outputs, in the same grouping for every build
+        for (; row + 4 <= numRows; row += 4)
+        {
+            const float* x0 = rows + row * rowStride;
+            const float* x1 = x0 + rowStride;
+            const float* x2 = x1 + rowStride;
+            const float* x3 = x2 + rowStride;
+            const float* r = ramps + 4 * row;
+
+            for (int k = 0; k < numSamples; ++k)
+            {
+                const float t = (float) k;
+                left[k] += ((r[0] + t * r[1]) * x0[k] + (r[4] + t * r[5]) * x1[k])
+                         + ((r[8] + t * r[9]) * x2[k] + (r[12] + t * r[13]) * x3[k]);
+                right[k] += ((r[2] + t * r[3]) * x0[k] + (r[6] + t * r[7]) * x1[k])
+                          + ((r[10] + t * r[11]) * x2[k] + (r[14] + t * r[15]) * x3[k]);
+            }
+        }
+
+        for (; row < numRows; ++row)
+        {
+            const float* x = rows + row * rowStride;
+            const float* r = ramps + 4 * row;
+
+            for (int k = 0; k < numSamples; ++k)
+            {
+                const float t = (float) k;
+                left[k] += (r[0] + t * r[1]) * x[k];
+                right[k] += (r[2] + t * r[3]) * x[k];
+            }
+        }
+    }
+
+    forcedinline void renderGrainsBody (const GrainBatch& batch, float* __restrict left, float* __restrict right) noexcept
+    {
+        DELAY_KERNELS_NO_CONTRACT
+        const float windowSize = (float) batch.windowSize;
+
+        // Along each grain, so every build adds the grains in the same order. The
+        // segment and window reads are gathers, the rest is plain vector arithmetic
+        for (int grain = 0; grain < batch.numGrains; ++grain)
+        {
+            const float* __restrict segment = batch.segments + grain * batch.segmentStride;
+            const float* __restrict window = batch.windows + batch.windowOffset[grain];
+            const float fraction = batch.fraction[grain];
+            const float rate = batch.rate[grain];
+            const float phase = batch.phase[grain];
+            const float phaseIncrement = batch.phaseIncrement[grain];
+            const float gainLeft = batch.gainLeft[grain];
+            const float gainRight = batch.gainRight[grain];
+            const int numSamples = batch.numSamples[grain];
+
+            for (int k = 0; k < numSamples; ++k)
+            {
+                const float t = (float) k;
+                const float x = fraction + t * rate;
+                const int i = (int) x;
+                const float sample = segment[i] + (x - (float) i) * (segment[i + 1] - segment[i]);
+
+                const float w = (phase + t * phaseIncrement) * windowSize;
+                const int j = (int) w;
+                const float grainSample = sample * (window[j] + (w - (float) j) * (window[j + 1] - window[j]));
+
+                left[k] += grainSample * gainLeft;
+                right[k] += grainSample * gainRight;
+            }
+        }
+    }
+
+    //==============================================================================
+    namespace Portable
+    {
+        DELAY_KERNELS_PORTABLE_TARGET void processLines (float* lanes, float* ring, const int* readOffsets, int writePosition, int ringMask, float allpassGain) noexcept
+        {
+            processLinesBody (lanes, ring, readOffsets, writePosition, ringMask, allpassGain);
+        }
+
+        DELAY_KERNELS_PORTABLE_TARGET void svfHighCut (float* x, float* ic1, float* ic2, float a1, float a2, float a3) noexcept            { svfHighCutBody (x, ic1, ic2, a1, a2, a3); }
+        DELAY_KERNELS_PORTABLE_TARGET void svfLowCut (float* x, float* ic1, float* ic2, float k, float a1, float a2, float a3) noexcept    { svfLowCutBody (x, ic1, ic2, k, a1, a2, a3); }
+        DELAY_KERNELS_PORTABLE_TARGET void interpolateFixedPhase (const float* source, float inPhase, float* out, int numSamples) noexcept { interpolateFixedPhaseBody (source, inPhase, out, numSamples); }
+        DELAY_KERNELS_PORTABLE_TARGET void crossfade (const float* from, const float* to, const float* fadeIn, float* out, int numSamples) noexcept { crossfadeBody (from, to, fadeIn, out, numSamples); }
+        DELAY_KERNELS_PORTABLE_TARGET float interpolatedDotProduct (const float* x, const float* c0, const float* c1, float fraction, int numTaps) noexcept
+        {
+            return interpolatedDotProductBody (x, c0, c1, fraction, numTaps);
+        }
+
+        DELAY_KERNELS_PORTABLE_TARGET void mixTaps (const float* rows, int rowStride, const float* ramps, int numRows, float* left, float* right, int numSamples) noexcept
+        {
+            mixTapsBody (rows, rowStride, ramps, numRows, left, right, numSamples);
+        }
+
+        DELAY_KERNELS_PORTABLE_TARGET void renderGrains (const GrainBatch& batch, float* left, float* right) noexcept
+        {
+            renderGrainsBody (batch, left, right);
+        }
+
+        DELAY_KERNELS_PORTABLE_TARGET void halfToFloat (const uint16_t* source, float* dest, int numSamples) noexcept
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = DelayLineStorage::halfToFloat (source[i]);
+        }
+
+        const Kernels kernels { Variant::portable, "portable", processLines, svfHighCut, svfLowCut, interpolateFixedPhase, crossfade, interpolatedDotProduct, mixTaps, renderGrains, halfToFloat };
+    }
+
+   #if DELAY_KERNELS_MULTIVERSION
+    // FMA is deliberately kept out of both builds, see Kernels
+    #define DELAY_KERNELS_AVX2_TARGET   __attribute__ ((target ("avx2,f16c") DELAY_KERNELS_GCC_OPTIONS))
+    #define DELAY_KERNELS_AVX512_TARGET __attribute__ ((target ("avx512f,avx2,f16c") DELAY_KERNELS_GCC_OPTIONS))
+
+    namespace Avx2
+    {
+        DELAY_KERNELS_AVX2_TARGET void processLines (float* lanes, float* ring, const int* readOffsets, int writePosition, int ringMask, float allpassGain) noexcept
+        {
+            processLinesBody (lanes, ring, readOffsets, writePosition, ringMask, allpassGain);
+        }
+
+        DELAY_KERNELS_AVX2_TARGET void svfHighCut (float* x, float* ic1, float* ic2, float a1, float a2, float a3) noexcept            { svfHighCutBody (x, ic1, ic2, a1, a2, a3); }
+        DELAY_KERNELS_AVX2_TARGET void svfLowCut (float* x, float* ic1, float* ic2, float k, float a1, float a2, float a3) noexcept    { svfLowCutBody (x, ic1, ic2, k, a1, a2, a3); }
+        DELAY_KERNELS_AVX2_TARGET void interpolateFixedPhase (const float* source, float inPhase, float* out, int numSamples) noexcept { interpolateFixedPhaseBody (source, inPhase, out, numSamples); }
+        DELAY_KERNELS_AVX2_TARGET void crossfade (const float* from, const float* to, const float* fadeIn, float* out, int numSamples) noexcept { crossfadeBody (from, to, fadeIn, out, numSamples); }
+        DELAY_KERNELS_AVX2_TARGET float interpolatedDotProduct (const float* x, const float* c0, const float* c1, float fraction, int numTaps) noexcept
+        {
+            return interpolatedDotProductBody (x, c0, c1, fraction, numTaps);
+        }
+
+        DELAY_KERNELS_AVX2_TARGET void mixTaps (const float* rows, int rowStride, const float* ramps, int numRows, float* left, float* right, int numSamples) noexcept
+        {
+            mixTapsBody (rows, rowStride, ramps, numRows, left, right, numSamples);
+        }
+
+        DELAY_KERNELS_AVX2_TARGET void renderGrains (const GrainBatch& batch, float* left, float* right) noexcept
+        {
+            renderGrainsBody (batch, left, right);
+        }
+
+        DELAY_KERNELS_AVX2_TARGET void halfToFloat (const uint16_t* source, float* dest, int numSamples) noexcept
+        {
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+                _mm256_storeu_ps (dest + i, _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i*) (source + i))));
+
+            for (; i < numSamples; ++i)
+                dest[i] = DelayLineStorage::halfToFloat (source[i]);
+        }
+
+        const Kernels kernels { Variant::avx2, "avx2", processLines, svfHighCut, svfLowCut, interpolateFixedPhase, crossfade, interpolatedDotProduct, mixTaps, renderGrains, halfToFloat };
+    }
+
+    namespace Avx512
+    {
+        DELAY_KERNELS_AVX512_TARGET void processLines (float* lanes, float* ring, const int* readOffsets, int writePosition, int ringMask, float allpassGain) noexcept
+        {
+            processLinesBody (lanes, ring, readOffsets, writePosition, ringMask, allpassGain);
+        }
+
+        DELAY_KERNELS_AVX512_TARGET void svfHighCut (float* x, float* ic1, float* ic2, float a1, float a2, float a3) noexcept            { svfHighCutBody (x, ic1, ic2, a1, a2, a3); }
+        DELAY_KERNELS_AVX512_TARGET void svfLowCut (float* x, float* ic1, float* ic2, float k, float a1, float a2, float a3) noexcept    { svfLowCutBody (x, ic1, ic2, k, a1, a2, a3); }
+        DELAY_KERNELS_AVX512_TARGET void interpolateFixedPhase (const float* source, float inPhase, float* out, int numSamples) noexcept { interpolateFixedPhaseBody (source, inPhase, out, numSamples); }
+        DELAY_KERNELS_AVX512_TARGET void crossfade (const float* from, const float* to, const float* fadeIn, float* out, int numSamples) noexcept { crossfadeBody (from, to, fadeIn, out, numSamples); }
+        DELAY_KERNELS_AVX512_TARGET float interpolatedDotProduct (const float* x, const float* c0, const float* c1, float fraction, int numTaps) noexcept
+        {
+            return interpolatedDotProductBody (x, c0, c1, fraction, numTaps);
+        }
+
+        DELAY_KERNELS_AVX512_TARGET void mixTaps (const float* rows, int rowStride, const float* ramps, int numRows, float* left, float* right, int numSamples) noexcept
+        {
+            mixTapsBody (rows, rowStride, ramps, numRows, left, right, numSamples);
+        }
+
+        DELAY_KERNELS_AVX512_TARGET void renderGrains (const GrainBatch& batch, float* left, float* right) noexcept
+        {
+            renderGrainsBody (batch, left, right);
+        }
+
+        // Segments are 17 samples, too short for the 16-wide conversion to pay off
+        const Kernels kernels { Variant::avx512, "avx512", processLines, svfHighCut, svfLowCut, interpolateFixedPhase, crossfade, interpolatedDotProduct, mixTaps, renderGrains, Avx2::halfToFloat };
+    }
+   #endif
+
+    //==============================================================================
+    std::atomic<int> forcedVariant { -1 };
+
+    int getForcedVariant()
+    {
+        const int forced = forcedVariant.load();
+
+        if (forced >= 0)
+            return forced;
+
+        const auto name = juce::SystemStats::getEnvironmentVariable ("DELAY_KERNELS", {});
+
+        for (auto variant : { Variant::portable, Variant::avx2, Variant::avx512 })
+            if (name == get (variant).name)
+                return (int) variant;
+
+        return -1;
+    }
+
+   #if DELAY_KERNELS_MULTIVERSION
+    // F16C has a CPUID bit of its own, which JUCE doesn't report. AVX2 doesn't imply
+    // it: a hypervisor can pass one through without the other
+    bool hasF16C()
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid (1, &eax, &ebx, &ecx, &edx) != 0 && (ecx & bit_F16C) != 0;
+    }
+   #endif
+}
+
+//==============================================================================
+const Kernels& get (Variant variant)
+{
+   #if DELAY_KERNELS_MULTIVERSION
+    switch (variant)
+    {
+        case Variant::avx512:   return Avx512::kernels;
+        case Variant::avx2:     return Avx2::kernels;
+        case Variant::portable:
+        default:                break;
+    }
+   #else
+    juce::ignoreUnused (variant);
+   #endif
+
+    return Portable::kernels;
+}
+
+bool isSupported (Variant variant)
+{
+    switch (variant)
+    {
+       #if DELAY_KERNELS_MULTIVERSION
+        // Both builds convert half floats with F16C
+        case Variant::avx512:   return juce::SystemStats::hasAVX512F() && juce::SystemStats::hasAVX2() && hasF16C();
+        case Variant::avx2:     return juce::SystemStats::hasAVX2() && hasF16C();
+       #endif
+        case Variant::portable: return true;
+        default:                return false;
+    }
+}
+
+const Kernels& select()
+{
+    const int forced = getForcedVariant();
+
+    if (forced >= 0)
+    {
+        // Forcing an instruction set this CPU lacks would crash, so it falls back instead
+        jassert (isSupported ((Variant) forced));
+
+        if (isSupported ((Variant) forced))
+            return get ((Variant) forced);
+    }
+
+    for (auto variant : { Variant::avx512, Variant::avx2 })
+        if (isSupported (variant))
+            return get (variant);
+
+    return get (Variant::portable);
+}
+
+void setOverride (Variant variant)
+{
+    forcedVariant = (int) variant;
+}
+
+void clearOverride()
+{
+    forcedVariant = -1;
+}
+}
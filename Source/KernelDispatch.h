@@ -0,0 +1,116 @@
+/*
+  ==============================================================================
+
+    KernelDispatch.h
+
+    The engine's vectorisable kernels, compiled once per instruction set,
+    and the choice between those builds made at runtime from what the CPU
+    supports.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace KernelDispatch
+{
+    /** portable is the build for the compiler's baseline target: SSE2 on 64-bit
+        Intel, NEON on ARM and plain scalar code anywhere else. The others are
+        only available on Intel machines with GCC or Clang, and need F16C as
+        well as AVX2, or AVX-512F.
+    */
+    enum class Variant
+    {
+        portable = 0,
+        avx2,
+        avx512
+    };
+
+    static const int NUM_LANES = 8;             // One delay line of one channel per lane
+    static const int NUM_DIFFUSION_STAGES = 4;
+    static const int DOT_PRODUCT_WIDTH = 8;     // Tap counts are multiples of this
+    static const int GRAIN_BATCH = 8;
+
+    /** Up to GRAIN_BATCH grains for one renderGrains call, see GranularCloud. */
+    struct GrainBatch
+    {
+        const float* segments;          // One row of segmentStride samples per grain
+        int segmentStride;
+        const float* windows;           // Tables of windowSize points, each followed by two zeros
+        int windowSize;
+        int numGrains;
+        int numSamples[GRAIN_BATCH];    // How much of the block each grain still plays
+        int windowOffset[GRAIN_BATCH];
+        float fraction[GRAIN_BATCH];
+        float rate[GRAIN_BATCH];
+        float phase[GRAIN_BATCH];
+        float phaseIncrement[GRAIN_BATCH];
+        float gainLeft[GRAIN_BATCH];
+        float gainRight[GRAIN_BATCH];
+    };
+
+    //==============================================================================
+    /**
+        One build of every kernel. All variants run the same arithmetic in the
+        same order without fused multiply-adds, so they give bit-identical output
+        and a render doesn't depend on the machine that made it.
+    */
+    struct Kernels
+    {
+        Variant variant;
+        const char* name;
+
+        /** Saturation, level compensation and Schroeder all-pass diffusion of one sample of
+            NUM_LANES delay lines, in place; see DiffusionNetwork for the ring layout.
+        */
+        void (*processLines) (float* lanes, float* ring, const int* readOffsets, int writePosition, int ringMask, float allpassGain) noexcept;
+
+        /** One step of NUM_LANES trapezoidal SVFs, replacing x with the low-pass output. */
+        void (*svfHighCut) (float* x, float* ic1, float* ic2, float a1, float a2, float a3) noexcept;
+
+        /** One step of NUM_LANES trapezoidal SVFs, replacing x with the high-pass output. */
+        void (*svfLowCut) (float* x, float* ic1, float* ic2, float k, float a1, float a2, float a3) noexcept;
+
+        /** Same as DelayKernels::interpolateFixedPhase. */
+        void (*interpolateFixedPhase) (const float* source, float inPhase, float* out, int numSamples) noexcept;
+
+        /** out = from + fadeIn * (to - from), sample by sample. out may be to. */
+        void (*crossfade) (const float* from, const float* to, const float* fadeIn, float* out, int numSamples) noexcept;
+
+        /** The sum of x[i] * (c0[i] + fraction * (c1[i] - c0[i])): one output of a polyphase
+            filter, between two neighbouring phases. numTaps is a multiple of DOT_PRODUCT_WIDTH.
+        */
+        float (*interpolatedDotProduct) (const float* x, const float* c0, const float* c1, float fraction, int numTaps) noexcept;
+
+        /** Adds numRows rows of samples, rowStride apart, to left and right. Each row has four
+            ramp values: left gain at sample 0 and its step per sample, then the same for right.
+            Rows are added four at a time, each group summed before it goes into the output.
+        */
+        void (*mixTaps) (const float* rows, int rowStride, const float* ramps, int numRows, float* left, float* right, int numSamples) noexcept;
+
+        /** Adds each grain of the batch to the start of left and right, one after the other.
+            Sample k of a grain is its segment at fraction + k * rate, linearly interpolated,
+            times its window at phase + k * phaseIncrement, then scaled by the two gains.
+        */
+        void (*renderGrains) (const GrainBatch& batch, float* left, float* right) noexcept;
+
+        /** IEEE half floats to floats. */
+        void (*halfToFloat) (const uint16_t* source, float* dest, int numSamples) noexcept;
+    };
+
+    //==============================================================================
+    /** The forced variant if one is set and this CPU runs it, otherwise the best one it runs. */
+    const Kernels& select();
+
+    const Kernels& get (Variant variant);
+    bool isSupported (Variant variant);
+
+    /** Forces a variant for testing. Setting the DELAY_KERNELS environment variable to
+        portable, avx2 or avx512 does the same without a rebuild. Takes effect at the
+        next prepareToPlay.
+    */
+    void setOverride (Variant variant);
+    void clearOverride();
+}
@@ -0,0 +1,247 @@
+/*
+  ==============================================================================
+
+    MultiTapDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "MultiTapDelay.h"
+
+//==============================================================================
+MultiTapDelay::MultiTapDelay()
+{
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+    mSampleRate = 44100.0;
+    mMaxDelay = 1.0f;
+
+    const Tap silent;
+
+    for (int tap = 0; tap < MAX_TAPS; ++tap)
+    {
+        mTapDelaySeconds[tap] = silent.delaySeconds;
+        mTapGain[tap] = silent.gain;
+        mTapPan[tap] = silent.pan;
+        mTapHighCut[tap] = silent.highCut;
+    }
+
+    mTapVersion = 0;
+    mAppliedTapVersion = -1;
+
+    reset();
+}
+
+void MultiTapDelay::prepare (double sampleRate, double maxDelaySeconds)
+{
+    mSampleRate = sampleRate;
+    mMaxDelay = std::max (1.0f, (float) (sampleRate * maxDelaySeconds));
+    reset();
+}
+
+void MultiTapDelay::reset() noexcept
+{
+    updateTargets();
+    mAppliedTapVersion = mTapVersion;
+
+    for (int tap = 0; tap < MAX_TAPS; ++tap)
+    {
+        mDelay[tap] = mTargetDelay[tap];
+        mGainLeft[tap] = 0.0f;
+        mGainRight[tap] = 0.0f;
+        mFilterState[tap] = 0.0f;
+        mOrder[tap] = tap;
+    }
+
+    sortByDelay();
+}
+
+void MultiTapDelay::setTap (int index, const Tap& tap) noexcept
+{
+    jassert (index >= 0 && index < MAX_TAPS);
+
+    mTapDelaySeconds[index] = std::max (0.0f, tap.delaySeconds);
+    mTapGain[index] = juce::jlimit (0.0f, 2.0f, tap.gain);
+    mTapPan[index] = juce::jlimit (-1.0f, 1.0f, tap.pan);
+    mTapHighCut[index] = juce::jlimit (DampingFilterBank::MIN_LOW_CUT, DampingFilterBank::MAX_HIGH_CUT, tap.highCut);
+    ++mTapVersion;
+}
+
+MultiTapDelay::Tap MultiTapDelay::getTap (int index) const noexcept
+{
+    jassert (index >= 0 && index < MAX_TAPS);
+
+    Tap tap;
+    tap.delaySeconds = mTapDelaySeconds[index];
+    tap.gain = mTapGain[index];
+    tap.pan = mTapPan[index];
+    tap.highCut = mTapHighCut[index];
+    return tap;
+}
+
+void MultiTapDelay::updateTargets() noexcept
+{
+    for (int tap = 0; tap < MAX_TAPS; ++tap)
+    {
+        mTargetDelay[tap] = juce::jlimit (1.0f, mMaxDelay, mTapDelaySeconds[tap] * (float) mSampleRate);
+
+        // Constant-power pan
+        const float angle = (mTapPan[tap] + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+        mTargetGainLeft[tap] = mTapGain[tap] * std::cos (angle);
+        mTargetGainRight[tap] = mTapGain[tap] * std::sin (angle);
+
+        const float highCut = mTapHighCut[tap];
+        mFilterCoeff[tap] = highCut < DampingFilterBank::MAX_HIGH_CUT
+                          ? std::exp (-2.0f * juce::MathConstants<float>::pi * highCut / (float) mSampleRate)
+                          : 0.0f;
+    }
+}
+
+bool MultiTapDelay::isStateValid() const noexcept
+{
+    bool listed[MAX_TAPS] = {};
+
+    for (int i = 0; i < MAX_TAPS; ++i)
+    {
+        const int tap = mOrder[i];
+
+        // Also false for a NaN delay
+        if (tap < 0 || tap >= MAX_TAPS || listed[tap] || ! (mDelay[tap] >= 0.0f))
+            return false;
+
+        listed[tap] = true;
+    }
+
+    return true;
+}
+
+void MultiTapDelay::sortByDelay() noexcept
+{
+    // Nearly sorted already whenever one tap has moved
+    for (int i = 1; i < MAX_TAPS; ++i)
+    {
+        const int tap = mOrder[i];
+        int j = i;
+
+        for (; j > 0 && mDelay[mOrder[j - 1]] > mDelay[tap]; --j)
+            mOrder[j] = mOrder[j - 1];
+
+        mOrder[j] = tap;
+    }
+}
+
+//==============================================================================
+void MultiTapDelay::process (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int blockStart,
+                             float* left, float* right, int numSamples, float gain) noexcept
+{
+    const int version = mTapVersion.load (std::memory_order_relaxed);
+
+    if (version != mAppliedTapVersion)
+    {
+        updateTargets();
+        mAppliedTapVersion = version;
+    }
+
+    // The block has overwritten the numSamples oldest samples, and interpolation reads one more
+    const float maxDelay = std::min (mMaxDelay, (float) (bufferLeft.getLength() - numSamples - 2));
+
+    if (maxDelay < 1.0f)
+        return;
+
+    for (int start = 0; start < numSamples; start += CHUNK_SIZE)
+        processChunk (bufferLeft, bufferRight, blockStart + start, left + start, right + start,
+                      juce::jmin (CHUNK_SIZE, numSamples - start), gain, maxDelay);
+}
+
+void MultiTapDelay::processChunk (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int chunkStart,
+                                  float* left, float* right, int numSamples, float gain, float maxDelay) noexcept
+{
+    int numRows = 0;
+    int numFiltered = 0;
+    bool moved = false;
+
+    for (int i = 0; i < MAX_TAPS; ++i)
+    {
+        const int tap = mOrder[i];
+
+        // A tap that has to move fades out where it is, then jumps while silent
+        const bool moving = mDelay[tap] != mTargetDelay[tap];
+        const float endLeft = moving ? 0.0f : mTargetGainLeft[tap];
+        const float endRight = moving ? 0.0f : mTargetGainRight[tap];
+
+        if (mGainLeft[tap] == 0.0f && mGainRight[tap] == 0.0f && endLeft == 0.0f && endRight == 0.0f)
+        {
+            if (moving)
+            {
+                mDelay[tap] = mTargetDelay[tap];
+                mFilterState[tap] = 0.0f;
+                moved = true;
+            }
+
+            continue;
+        }
+
+        // Sample k sits between positions chunkStart + k - intDelay - 1 and the one after it
+        const float delay = std::min (mDelay[tap], maxDelay);
+        const int intDelay = static_cast<int> (delay);
+        const float fraction = delay - intDelay;
+
+        DelayLineStorage::readContiguousMono (bufferLeft, bufferRight, chunkStart - intDelay - 1, mSegment,
+                                              mSegmentFrames, numSamples + 1);
+
+        mKernels->interpolateFixedPhase (mSegment, 1.0f - fraction, mRows[numRows], numSamples);
+
+        if (mFilterCoeff[tap] > 0.0f)
+        {
+            mFilteredRows[numFiltered] = numRows;
+            mFilteredTaps[numFiltered] = tap;
+            ++numFiltered;
+        }
+
+        float* ramp = mRamps + 4 * numRows;
+        ramp[0] = mGainLeft[tap] * gain;
+        ramp[1] = (endLeft - mGainLeft[tap]) * gain / numSamples;
+        ramp[2] = mGainRight[tap] * gain;
+        ramp[3] = (endRight - mGainRight[tap]) * gain / numSamples;
+
+        mGainLeft[tap] = endLeft;
+        mGainRight[tap] = endRight;
+        ++numRows;
+    }
+
+    for (int first = 0; first < numFiltered; first += FILTER_BATCH)
+        filterRows (first, juce::jmin (FILTER_BATCH, numFiltered - first), numSamples);
+
+    if (numRows > 0)
+        mKernels->mixTaps (&mRows[0][0], CHUNK_SIZE, mRamps, numRows, left, right, numSamples);
+
+    if (moved)
+        sortByDelay();
+}
+
+void MultiTapDelay::filterRows (int first, int numFilters, int numSamples) noexcept
+{
+    // A one-pole filter is one long dependency chain; a batch of them side by side
+    // keeps the pipeline busy where a single one would wait on every sample
+    float coeff[FILTER_BATCH], state[FILTER_BATCH];
+    float* rows[FILTER_BATCH];
+
+    for (int i = 0; i < numFilters; ++i)
+    {
+        const int tap = mFilteredTaps[first + i];
+        coeff[i] = mFilterCoeff[tap];
+        state[i] = mFilterState[tap];
+        rows[i] = mRows[mFilteredRows[first + i]];
+    }
+
+    for (int k = 0; k < numSamples; ++k)
+    {
+        for (int i = 0; i < numFilters; ++i)
+        {
+            state[i] = coeff[i] * state[i] + (1.0f - coeff[i]) * rows[i][k];
+            rows[i][k] = state[i];
+        }
+    }
+
+    for (int i = 0; i < numFilters; ++i)
+        mFilterState[mFilteredTaps[first + i]] = state[i];
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    MultiTapDelay.h
+
+    Up to MAX_TAPS user-programmed taps on the delay lines' circular buffers,
+    each with its own time, gain, pan and high cut, for rhythmic patterns.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DelayLineStorage.h"
+#include "DampingFilterBank.h"
+#include "KernelDispatch.h"
+
+//==============================================================================
+/**
+    The taps read the buffers after the lines engine has written its block,
+    so they hear the input along with the lines' feedback. Every tap reads the
+    mono sum of both buffers at a fixed offset. A chunk of output is therefore
+    one contiguous segment per tap, interpolated at a fixed phase, and no
+    per-sample gathers are needed. The taps are kept sorted by offset, so
+    consecutive taps read neighbouring memory and close taps share cache
+    lines.
+
+    Each chunk of CHUNK_SIZE samples reads every audible tap into a row and
+    runs the tap's one-pole high cut over it, FILTER_BATCH filters at a time
+    interleaved. One mixTaps kernel call then adds all the rows to both
+    channels, with gain and pan applied as per-tap ramps. When a tap's time
+    changes, it fades out at the old offset over one chunk and back in at the
+    new one over the next. Silent taps cost nothing.
+*/
+class MultiTapDelay
+{
+public:
+    static const int MAX_TAPS = 64;
+    static const int CHUNK_SIZE = 64;
+    static const int FILTER_BATCH = 8;
+
+    struct Tap
+    {
+        float delaySeconds = 0.5f;
+        float gain = 0.0f;                                      // Unset taps are silent
+        float pan = 0.0f;                                       // -1 left to 1 right
+        float highCut = DampingFilterBank::MAX_HIGH_CUT;        // At the maximum the tap is unfiltered
+    };
+
+    MultiTapDelay();
+
+    /** Sets the tap times in samples, up to maxDelaySeconds. */
+    void prepare (double sampleRate, double maxDelaySeconds);
+
+    /** Fades every tap in from silence again and clears the filters. */
+    void reset() noexcept;
+
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    /** Any thread. */
+    void setTap (int index, const Tap& tap) noexcept;
+    Tap getTap (int index) const noexcept;
+
+    /** Adds the taps to left and right, scaled by gain, for the numSamples written to
+        the buffers from blockStart on. The buffers must already hold those samples.
+        Offsets that would reach samples overwritten in the same block are shortened.
+    */
+    void process (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int blockStart,
+                  float* left, float* right, int numSamples, float gain) noexcept;
+
+    /** Calls visit (data, numBytes) for the running offsets, gains and filters, see EngineSnapshot. */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        visit (mDelay, sizeof (mDelay));
+        visit (mGainLeft, sizeof (mGainLeft));
+        visit (mGainRight, sizeof (mGainRight));
+        visit (mFilterState, sizeof (mFilterState));
+        visit (mOrder, sizeof (mOrder));
+    }
+
+    /** After a restore, whether the order visitState copied in holds every tap once
+        and no tap reads ahead of the write head.
+    */
+    bool isStateValid() const noexcept;
+
+private:
+    void updateTargets() noexcept;
+    void sortByDelay() noexcept;
+    void processChunk (const DelayLineStorage& bufferLeft, const DelayLineStorage& bufferRight, int chunkStart,
+                       float* left, float* right, int numSamples, float gain, float maxDelay) noexcept;
+    void filterRows (int first, int numFilters, int numSamples) noexcept;
+
+    const KernelDispatch::Kernels* mKernels;
+    double mSampleRate;
+    float mMaxDelay;
+
+    // Settings from any thread, picked up at the start of a block
+    std::atomic<float> mTapDelaySeconds[MAX_TAPS];
+    std::atomic<float> mTapGain[MAX_TAPS];
+    std::atomic<float> mTapPan[MAX_TAPS];
+    std::atomic<float> mTapHighCut[MAX_TAPS];
+    std::atomic<int> mTapVersion;
+    int mAppliedTapVersion;
+
+    // Where each tap is heading, in samples and channel gains
+    float mTargetDelay[MAX_TAPS];
+    float mTargetGainLeft[MAX_TAPS];
+    float mTargetGainRight[MAX_TAPS];
+    float mFilterCoeff[MAX_TAPS];       // 0 for an unfiltered tap
+
+    // Where each tap is, ramped towards the targets a chunk at a time
+    float mDelay[MAX_TAPS];
+    float mGainLeft[MAX_TAPS];
+    float mGainRight[MAX_TAPS];
+    float mFilterState[MAX_TAPS];
+    int mOrder[MAX_TAPS];               // Tap indices by increasing mDelay
+
+    // One row per audible tap, and its gain ramps as mixTaps takes them
+    float mRows[MAX_TAPS][CHUNK_SIZE];
+    float mRamps[4 * MAX_TAPS];
+    int mFilteredRows[MAX_TAPS];        // Rows to run a high cut over, and whose filter it is
+    int mFilteredTaps[MAX_TAPS];
+    float mSegment[CHUNK_SIZE + 1];
+    float mSegmentFrames[2 * (CHUNK_SIZE + 1)];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultiTapDelay)
+};
@@ -0,0 +1,235 @@
+/*
+  ==============================================================================
+
+    OutputLimiter.cpp
+
+  ==============================================================================
+*/
+
+#include "OutputLimiter.h"
+
+namespace
+{
+    // Centre of the interpolation taps: points are placed between tap
+    // TAP_CENTRE and the next, which is TAP_CENTRE samples back from the newest
+    const int TAP_CENTRE = OutputLimiter::INTERPOLATION_TAPS / 2 - 1;
+    const int DETECTOR_DELAY = OutputLimiter::INTERPOLATION_TAPS / 2;
+    const double KAISER_BETA = 5.0;
+
+    double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+OutputLimiter::OutputLimiter()
+{
+    mLookahead = 1;
+    mWindow = 3;
+    mDelayLength = 1 + DETECTOR_DELAY;
+    mMaxBlockSize = 0;
+    mReleaseCoeff = 0.0f;
+    mDetectorCeiling = CEILING;
+    mDequeMask = 0;
+    mDequeFront = 0;
+    mDequeSize = 0;
+    mSampleIndex = 0;
+    mReleasedGain = 1.0f;
+    mAveragePosition = 0;
+    mAverageSum = 0.0;
+    mGainReduction = 1.0f;
+
+    for (auto& row : mInterpolation)
+        std::fill (std::begin (row), std::end (row), 0.0f);
+}
+
+void OutputLimiter::prepare (double sampleRate, int maxBlockSize)
+{
+    mLookahead = std::max (1, juce::roundToInt (LOOKAHEAD_MS * 0.001 * sampleRate));
+
+    // The output sample sits between the detector values of the intervals either side of it
+    mWindow = mLookahead + 2;
+    mDelayLength = mLookahead + DETECTOR_DELAY;
+    mMaxBlockSize = std::max (maxBlockSize, 1);
+    mReleaseCoeff = (float) std::exp (-1.0 / (RELEASE_MS * 0.001 * sampleRate));
+
+    // A sine's peak is at most half the point spacing from the nearest point
+    const double highestFrequency = std::min (HIGHEST_FREQUENCY, 0.45 * sampleRate);
+    mDetectorCeiling = (float) (CEILING * std::cos (M_PI * highestFrequency / (OVERSAMPLING * sampleRate)));
+
+    // Kaiser-windowed sinc at each point between two samples
+    for (int point = 0; point < NUM_INTERPOLATED; ++point)
+    {
+        const double fraction = (point + 1.0) / (NUM_INTERPOLATED + 1.0);
+
+        for (int tap = 0; tap < INTERPOLATION_TAPS; ++tap)
+        {
+            const double x = tap - TAP_CENTRE - fraction;
+            const double sinc = std::sin (M_PI * x) / (M_PI * x);
+            const double ratio = x / (INTERPOLATION_TAPS / 2);
+            const double window = besselI0 (KAISER_BETA * std::sqrt (std::max (0.0, 1.0 - ratio * ratio))) / besselI0 (KAISER_BETA);
+            mInterpolation[point][tap] = (float) (sinc * window);
+        }
+    }
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        mDetectorInput[channel].assign ((size_t) (INTERPOLATION_TAPS - 1 + mMaxBlockSize), 0.0f);
+        mDelayed[channel].assign ((size_t) (mDelayLength + mMaxBlockSize), 0.0f);
+    }
+
+    mDetector.assign ((size_t) mMaxBlockSize, 0.0f);
+    mInterpolated.assign ((size_t) mMaxBlockSize, 0.0f);
+    mGain.assign ((size_t) mMaxBlockSize, 1.0f);
+
+    const int dequeSize = juce::nextPowerOfTwo (mWindow + 1);
+    mDequeValues.assign ((size_t) dequeSize, 0.0f);
+    mDequeIndices.assign ((size_t) dequeSize, 0);
+    mDequeMask = dequeSize - 1;
+
+    mAverageHistory.assign ((size_t) mLookahead, 1.0f);
+
+    reset();
+}
+
+void OutputLimiter::reset()
+{
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        std::fill (mDetectorInput[channel].begin(), mDetectorInput[channel].end(), 0.0f);
+        std::fill (mDelayed[channel].begin(), mDelayed[channel].end(), 0.0f);
+    }
+
+    mDequeFront = 0;
+    mDequeSize = 0;
+    mSampleIndex = 0;
+
+    mReleasedGain = 1.0f;
+    std::fill (mAverageHistory.begin(), mAverageHistory.end(), 1.0f);
+    mAveragePosition = 0;
+    mAverageSum = (double) mLookahead;
+    mGainReduction = 1.0f;
+}
+
+void OutputLimiter::process (float* left, float* right, int numSamples) noexcept
+{
+    // Never prepared: pass the block through rather than loop on empty chunks
+    if (mMaxBlockSize == 0)
+        return;
+
+    float lowestGain = 1.0f;
+
+    for (int start = 0; start < numSamples; start += mMaxBlockSize)
+    {
+        const int chunk = std::min (mMaxBlockSize, numSamples - start);
+        processChunk (left + start, right + start, chunk);
+
+        for (int i = 0; i < chunk; ++i)
+            lowestGain = std::min (lowestGain, mGain[(size_t) i]);
+    }
+
+    mGainReduction = lowestGain;
+}
+
+void OutputLimiter::processChunk (float* left, float* right, int numSamples) noexcept
+{
+    const int history = INTERPOLATION_TAPS - 1;
+    float* channels[2] = { left, right };
+
+    // Pass 1: true-peak estimate of each interval, linked across the channels
+    std::fill (mDetector.begin(), mDetector.begin() + numSamples, 0.0f);
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* input = mDetectorInput[channel].data();
+        std::copy (channels[channel], channels[channel] + numSamples, input + history);
+
+        // input[i + history] is the newest sample, so the taps of interval i start at input[i]
+        float* interpolated = mInterpolated.data();
+        float* detector = mDetector.data();
+
+        juce::FloatVectorOperations::abs (interpolated, input + TAP_CENTRE, numSamples);
+        juce::FloatVectorOperations::max (detector, detector, interpolated, numSamples);
+
+        for (int point = 0; point < NUM_INTERPOLATED; ++point)
+        {
+            juce::FloatVectorOperations::clear (interpolated, numSamples);
+
+            for (int tap = 0; tap < INTERPOLATION_TAPS; ++tap)
+                juce::FloatVectorOperations::addWithMultiply (interpolated, input + tap, mInterpolation[point][tap], numSamples);
+
+            juce::FloatVectorOperations::abs (interpolated, interpolated, numSamples);
+            juce::FloatVectorOperations::max (detector, detector, interpolated, numSamples);
+        }
+
+        std::copy (input + numSamples, input + numSamples + history, input);
+    }
+
+    // Pass 2: sliding maximum, release and the lookahead average, all recurrences
+    const float inverseLookahead = 1.0f / (float) mLookahead;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float value = mDetector[(size_t) i];
+
+        while (mDequeSize > 0 && mDequeValues[(size_t) ((mDequeFront + mDequeSize - 1) & mDequeMask)] <= value)
+            --mDequeSize;
+
+        const int back = (mDequeFront + mDequeSize) & mDequeMask;
+        mDequeValues[(size_t) back] = value;
+        mDequeIndices[(size_t) back] = mSampleIndex;
+        ++mDequeSize;
+
+        if (mDequeIndices[(size_t) mDequeFront] <= mSampleIndex - mWindow)
+        {
+            mDequeFront = (mDequeFront + 1) & mDequeMask;
+            --mDequeSize;
+        }
+
+        ++mSampleIndex;
+
+        const float peak = mDequeValues[(size_t) mDequeFront];
+        const float required = peak > mDetectorCeiling ? mDetectorCeiling / peak : 1.0f;
+
+        // Instant attack, the average below turns it into a ramp
+        if (required < mReleasedGain)
+            mReleasedGain = required;
+        else
+            mReleasedGain = required + (mReleasedGain - required) * mReleaseCoeff;
+
+        mAverageSum += mReleasedGain - mAverageHistory[(size_t) mAveragePosition];
+        mAverageHistory[(size_t) mAveragePosition] = mReleasedGain;
+
+        if (++mAveragePosition == mLookahead)
+        {
+            // Start each round from an exact sum, so rounding never builds up
+            mAveragePosition = 0;
+            mAverageSum = 0.0;
+
+            for (float gain : mAverageHistory)
+                mAverageSum += gain;
+        }
+
+        mGain[(size_t) i] = (float) mAverageSum * inverseLookahead;
+    }
+
+    // Pass 3: the audio, delayed to line up with its gain
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        float* delayed = mDelayed[channel].data();
+        std::copy (channels[channel], channels[channel] + numSamples, delayed + mDelayLength);
+
+        juce::FloatVectorOperations::multiply (channels[channel], delayed, mGain.data(), numSamples);
+
+        std::copy (delayed + numSamples, delayed + numSamples + mDelayLength, delayed);
+    }
+}
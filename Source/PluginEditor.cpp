@@ -9,13 +9,29 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    template <typename ParameterType>
+    ParameterType* findParameter(juce::AudioProcessor& processor, const juce::String& parameterID)
+    {
+        for (auto* parameter : processor.getParameters())
+            if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter))
+                if (withID->paramID == parameterID)
+                    return dynamic_cast<ParameterType*>(parameter);
+        
+        jassertfalse;
+        return nullptr;
+    }
+}
+
 //==============================================================================
 DelaytutorialAudioProcessorEditor::DelaytutorialAudioProcessorEditor (DelaytutorialAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
+    : AudioProcessorEditor (&p), audioProcessor (p),
+      mBufferView (p.getOverviewLeft(), p.getOverviewRight())
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (400, 300);
+    setSize (400, 575);
     
     auto& params = processor.getParameters();
     
@@ -144,6 +160,88 @@ DelaytutorialAudioProcessorEditor::DelaytutorialAudioProcessorEditor (Delaytutor
     mLfoPhaseSlider.onDragEnd = [lfoPhaseParameter] {
         lfoPhaseParameter->endChangeGesture();
     };
+    
+    juce::AudioParameterFloat* lowCutParameter = (juce::AudioParameterFloat*)params.getUnchecked(6);
+
+    mLowCutSlider.setBounds(300, 0, 100, 100);
+    mLowCutSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    mLowCutSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    mLowCutSlider.setRange(lowCutParameter->range.start, lowCutParameter->range.end);
+    mLowCutSlider.setValue(*lowCutParameter);
+    addAndMakeVisible(mLowCutSlider);
+    
+    mLowCutSlider.onValueChange = [this, lowCutParameter] {
+        *lowCutParameter = mLowCutSlider.getValue();
+    };
+    
+    mLowCutSlider.onDragStart = [lowCutParameter] {
+        lowCutParameter->beginChangeGesture();
+    };
+    
+    mLowCutSlider.onDragEnd = [lowCutParameter] {
+        lowCutParameter->endChangeGesture();
+    };
+    
+    juce::AudioParameterFloat* highCutParameter = (juce::AudioParameterFloat*)params.getUnchecked(7);
+
+    mHighCutSlider.setBounds(300, 100, 100, 100);
+    mHighCutSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    mHighCutSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    mHighCutSlider.setRange(highCutParameter->range.start, highCutParameter->range.end);
+    mHighCutSlider.setValue(*highCutParameter);
+    addAndMakeVisible(mHighCutSlider);
+    
+    mHighCutSlider.onValueChange = [this, highCutParameter] {
+        *highCutParameter = mHighCutSlider.getValue();
+    };
+    
+    mHighCutSlider.onDragStart = [highCutParameter] {
+        highCutParameter->beginChangeGesture();
+    };
+    
+    mHighCutSlider.onDragEnd = [highCutParameter] {
+        highCutParameter->endChangeGesture();
+    };
+    
+    mBufferView.setBounds(0, 200, 400, 100);
+    mBufferView.setSampleRate(audioProcessor.getEngineSampleRate());
+    addAndMakeVisible(mBufferView);
+    
+    mMultiTapButton.setButtonText("Multi-tap");
+    attachToggle(mMultiTapButton, "multitap", 0, 300, 100, 25);
+    
+    const char* tapRows[] = { "time", "gain", "pan", "highcut" };
+    const char* tapRowNames[] = { "Time", "Gain", "Pan", "High cut" };
+    
+    for (int row = 0; row < 4; ++row) {
+        addRowLabel(mTapRowLabels[row], tapRowNames[row], 0, 325 + 40 * row, 80, 40);
+        
+        for (int tap = 0; tap < DelaytutorialAudioProcessor::NUM_TAP_PARAMETERS; ++tap)
+            attachSlider(mTapSliders[tap][row], "tap" + juce::String(tap + 1) + tapRows[row], 80 + 40 * tap, 325 + 40 * row, 40, 40);
+    }
+    
+    addRowLabel(mQualityLabel, "Quality", 0, 485, 80, 25);
+    attachComboBox(mQualityBox, "quality", 80, 485, 120, 25);
+    mAutomaticQualityButton.setButtonText("Automatic");
+    attachToggle(mAutomaticQualityButton, "autoquality", 210, 485, 100, 25);
+    mLimiterButton.setButtonText("Limiter");
+    attachToggle(mLimiterButton, "limiter", 310, 485, 90, 25);
+    
+    addRowLabel(mEngineLabel, "Engine", 0, 510, 80, 25);
+    attachComboBox(mEngineBox, "engine", 80, 510, 120, 25);
+    attachComboBox(mFftSizeBox, "fftsize", 210, 510, 80, 25);
+    mFreezeButton.setButtonText("Freeze");
+    attachToggle(mFreezeButton, "freeze", 300, 510, 100, 25);
+    
+    mGranularButton.setButtonText("Granular");
+    attachToggle(mGranularButton, "granular", 0, 542, 80, 25);
+    
+    const char* grainParameters[] = { "graindensity", "grainsize", "grainspread", "grainpitch" };
+    
+    for (int i = 0; i < 4; ++i)
+        attachSlider(mGrainSliders[i], grainParameters[i], 80 + 40 * i, 535, 40, 40);
+    
+    attachComboBox(mGrainWindowBox, "grainwindow", 250, 542, 100, 25);
 }
 
 DelaytutorialAudioProcessorEditor::~DelaytutorialAudioProcessorEditor()
@@ -166,3 +264,68 @@ void DelaytutorialAudioProcessorEditor::resized()
     // subcomponents in your editor..
 }
 
+//==============================================================================
+void DelaytutorialAudioProcessorEditor::attachSlider(juce::Slider& slider, const juce::String& parameterID, int x, int y, int width, int height)
+{
+    juce::AudioParameterFloat* parameter = findParameter<juce::AudioParameterFloat>(processor, parameterID);
+    
+    slider.setBounds(x, y, width, height);
+    slider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+    slider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+    slider.setRange(parameter->range.start, parameter->range.end);
+    slider.setSkewFactor(parameter->range.skew);
+    slider.setValue(*parameter);
+    addAndMakeVisible(slider);
+    
+    slider.onValueChange = [&slider, parameter] {
+        *parameter = slider.getValue();
+    };
+    
+    slider.onDragStart = [parameter] {
+        parameter->beginChangeGesture();
+    };
+    
+    slider.onDragEnd = [parameter] {
+        parameter->endChangeGesture();
+    };
+}
+
+void DelaytutorialAudioProcessorEditor::attachToggle(juce::ToggleButton& button, const juce::String& parameterID, int x, int y, int width, int height)
+{
+    juce::AudioParameterBool* parameter = findParameter<juce::AudioParameterBool>(processor, parameterID);
+    
+    button.setBounds(x, y, width, height);
+    button.setToggleState(*parameter, juce::dontSendNotification);
+    addAndMakeVisible(button);
+    
+    // A click is the whole gesture
+    button.onClick = [&button, parameter] {
+        parameter->beginChangeGesture();
+        *parameter = button.getToggleState();
+        parameter->endChangeGesture();
+    };
+}
+
+void DelaytutorialAudioProcessorEditor::attachComboBox(juce::ComboBox& comboBox, const juce::String& parameterID, int x, int y, int width, int height)
+{
+    juce::AudioParameterChoice* parameter = findParameter<juce::AudioParameterChoice>(processor, parameterID);
+    
+    comboBox.setBounds(x, y, width, height);
+    comboBox.addItemList(parameter->choices, 1);
+    comboBox.setSelectedItemIndex(parameter->getIndex(), juce::dontSendNotification);
+    addAndMakeVisible(comboBox);
+    
+    comboBox.onChange = [&comboBox, parameter] {
+        parameter->beginChangeGesture();
+        *parameter = comboBox.getSelectedItemIndex();
+        parameter->endChangeGesture();
+    };
+}
+
+void DelaytutorialAudioProcessorEditor::addRowLabel(juce::Label& label, const juce::String& text, int x, int y, int width, int height)
+{
+    label.setBounds(x, y, width, height);
+    label.setText(text, juce::dontSendNotification);
+    addAndMakeVisible(label);
+}
+
@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "DelayBufferView.h"
 
 //==============================================================================
 /**
@@ -36,6 +37,36 @@ private:
     juce::Slider mLfoRateSlider;
     juce::Slider mLfoDepthSlider;
     juce::Slider mLfoPhaseSlider;
+    juce::Slider mLowCutSlider;
+    juce::Slider mHighCutSlider;
+    
+    DelayBufferView mBufferView;
+    
+    // Host parameters added after the original eight, found by ID
+    void attachSlider(juce::Slider& slider, const juce::String& parameterID, int x, int y, int width, int height);
+    void attachToggle(juce::ToggleButton& button, const juce::String& parameterID, int x, int y, int width, int height);
+    void attachComboBox(juce::ComboBox& comboBox, const juce::String& parameterID, int x, int y, int width, int height);
+    void addRowLabel(juce::Label& label, const juce::String& text, int x, int y, int width, int height);
+    
+    // One column per tap: time, gain, pan and high cut from the top
+    juce::ToggleButton mMultiTapButton;
+    juce::Label mTapRowLabels[4];
+    juce::Slider mTapSliders[DelaytutorialAudioProcessor::NUM_TAP_PARAMETERS][4];
+    
+    juce::Label mQualityLabel;
+    juce::ComboBox mQualityBox;
+    juce::ToggleButton mAutomaticQualityButton;
+    juce::ToggleButton mLimiterButton;
+    
+    juce::Label mEngineLabel;
+    juce::ComboBox mEngineBox;
+    juce::ComboBox mFftSizeBox;
+    juce::ToggleButton mFreezeButton;
+    
+    // Density, size, spread and pitch spread
+    juce::ToggleButton mGranularButton;
+    juce::Slider mGrainSliders[4];
+    juce::ComboBox mGrainWindowBox;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelaytutorialAudioProcessorEditor)
 };
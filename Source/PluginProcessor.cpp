@@ -9,6 +9,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "DelayKernels.h"
 
 //==============================================================================
 DelaytutorialAudioProcessor::DelaytutorialAudioProcessor()
@@ -29,9 +30,75 @@ DelaytutorialAudioProcessor::DelaytutorialAudioProcessor()
     addParameter(mLfoRateParameter = new juce::AudioParameterFloat("lforate", "LFO rate",  0.1f, 20.f, 01.f));
     addParameter(mLfoDepthParameter = new juce::AudioParameterFloat("lfodepth", "LFO depth",  0.0f, 0.1f, 0.05f));
     addParameter(mLfoPhaseParameter = new juce::AudioParameterFloat("lfophase", "LFO phase",  0.0f, 1.f, 0.f));
+    addParameter(mLowCutParameter = new juce::AudioParameterFloat("lowcut", "Low cut",  DampingFilterBank::MIN_LOW_CUT, 1000.f, DampingFilterBank::MIN_LOW_CUT));
+    addParameter(mHighCutParameter = new juce::AudioParameterFloat("highcut", "High cut",  1000.f, DampingFilterBank::MAX_HIGH_CUT, DampingFilterBank::MAX_HIGH_CUT));
+    addParameter(mMultiTapParameter = new juce::AudioParameterBool("multitap", "Multi-tap", false));
     
-    mCircularBufferLeft = nullptr;
-    mCircularBufferRight = nullptr;
+    // Unset taps are silent, as in MultiTapDelay
+    const MultiTapDelay::Tap silentTap;
+    
+    for (int i = 0; i < NUM_TAP_PARAMETERS; ++i) {
+        const juce::String id = "tap" + juce::String(i + 1);
+        const juce::String name = "Tap " + juce::String(i + 1);
+        
+        addParameter(mTapTimeParameters[i] = new juce::AudioParameterFloat(id + "time", name + " time",  0.0f, MAX_DELAY_TIME, silentTap.delaySeconds));
+        addParameter(mTapGainParameters[i] = new juce::AudioParameterFloat(id + "gain", name + " gain",  0.0f, 2.0f, silentTap.gain));
+        addParameter(mTapPanParameters[i] = new juce::AudioParameterFloat(id + "pan", name + " pan",  -1.0f, 1.0f, silentTap.pan));
+        addParameter(mTapHighCutParameters[i] = new juce::AudioParameterFloat(id + "highcut", name + " high cut",  DampingFilterBank::MIN_LOW_CUT, DampingFilterBank::MAX_HIGH_CUT, silentTap.highCut));
+    }
+    
+    // In QualityTier order
+    addParameter(mQualityTierParameter = new juce::AudioParameterChoice("quality", "Quality", juce::StringArray { "Eco", "Normal", "High" }, (int) QualityTier::normal));
+    addParameter(mAutomaticQualityParameter = new juce::AudioParameterBool("autoquality", "Automatic quality", false));
+    addParameter(mDelayEngineParameter = new juce::AudioParameterChoice("engine", "Engine", juce::StringArray { "Delay lines", "Spectral" }, (int) DelayEngine::lines));
+    addParameter(mSpectralFftSizeParameter = new juce::AudioParameterChoice("fftsize", "FFT size", juce::StringArray { "1024", "2048", "4096" }, 11 - SpectralDelay::MIN_FFT_ORDER));
+    addParameter(mSpectralFreezeParameter = new juce::AudioParameterBool("freeze", "Freeze", false));
+    
+    // Density spans three decades, so most of its travel goes to the sparse end
+    const GranularCloud::Settings grains;
+    addParameter(mGranularParameter = new juce::AudioParameterBool("granular", "Granular", false));
+    addParameter(mGrainDensityParameter = new juce::AudioParameterFloat("graindensity", "Grain density", juce::NormalisableRange<float>(0.1f, GranularCloud::MAX_DENSITY, 0.0f, 0.3f), grains.density));
+    addParameter(mGrainSizeParameter = new juce::AudioParameterFloat("grainsize", "Grain size",  GranularCloud::MIN_GRAIN_SECONDS, GranularCloud::MAX_GRAIN_SECONDS, grains.grainSeconds));
+    addParameter(mGrainSpreadParameter = new juce::AudioParameterFloat("grainspread", "Grain spread",  0.0f, MAX_DELAY_TIME, grains.positionSpread));
+    addParameter(mGrainPitchSpreadParameter = new juce::AudioParameterFloat("grainpitch", "Grain pitch spread",  0.0f, GranularCloud::MAX_PITCH_SPREAD, grains.pitchSpread));
+    addParameter(mGrainWindowParameter = new juce::AudioParameterChoice("grainwindow", "Grain window", juce::StringArray { "Hann", "Triangle", "Tukey" }, (int) grains.window));
+    addParameter(mOutputLimiterParameter = new juce::AudioParameterBool("limiter", "Output limiter", false));
+    
+    mDelayStorageFormat = DelayLineStorage::Format::float32;
+    mInterleavedBuffers = false;
+    mKernels = &KernelDispatch::get(KernelDispatch::Variant::portable);
+    mOfflineMaximumQuality = true;
+    mActiveTier = QualityTier::normal;
+    mFadeFromTier = QualityTier::normal;
+    mTierFadeSamplesRemaining = 0;
+    mLongDelayMode = false;
+    mLongDelayMaxSeconds = DEFAULT_LONG_DELAY_TIME;
+    mDelayTimeScale = 1.0f;
+    mOnDemandMemory = false;
+    mStructuralChangeDepth = 0;
+    mStructuralChangeSuspended = false;
+    mStructuralChangePrepares = false;
+    mDelayEngine = DelayEngine::lines;
+    mSpectralFftOrder = 11;
+    mFixedInternalRate = false;
+    mResampling = false;
+    mEngineSampleRate = 44100.0;
+    mResamplerLatency = 0;
+    mResamplerBlockSize = 512;
+    mOutputLimiterEnabled = false;
+    mStateSnapshot = false;
+    mSamplesWritten = 0;
+    mEngineResets = 0;
+   #if DELAY_TRACING
+    mWritesTraceOnRelease = true;
+   #endif
+    mMultiTapRunning = false;
+    mGranularRunning = false;
+    mPoolSlot = nullptr;
+    mPoolSlotBytes = 0;
+    mPoolSlotPinned = false;
+    mWaitingForMemory = false;
+    mSilentSamples = 0;
     mCircularBufferWriteHead = 0;
     mCircularBufferLength = 0;
     mDelayReadHead_left = 0;
@@ -41,26 +108,16 @@ DelaytutorialAudioProcessor::DelaytutorialAudioProcessor()
     mLfoDepthSmooth = 0;
     mStereoOffsetSmooth = 0;
     mDelayFraction = 0.66f;
+    mControlSmoothCoeff = 0;
     
-    for (int i = 0; i < NUM_DELAY_LINES; ++i)
-    {
-        mDelayTimeInSamples_left[i] = 0.0f;
-        mDelayTimeInSamples_right[i] = 0.0f;
-    }
-
+    reset();
+    startTimer(100);
 }
 
 DelaytutorialAudioProcessor::~DelaytutorialAudioProcessor()
 {
-    if (mCircularBufferLeft != nullptr) {
-        delete [] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-    
-    if (mCircularBufferRight != nullptr) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
-    }
+    stopTimer();
+    returnPoolSlot();
 }
 
 //==============================================================================
@@ -128,49 +185,233 @@ void DelaytutorialAudioProcessor::changeProgramName (int index, const juce::Stri
 //==============================================================================
 void DelaytutorialAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    DELAY_TRACE_ZONE("prepareToPlay");
+    
+    // Whatever the host moved since, should the timer not have applied it yet
+    mDelayEngine = (DelayEngine) mDelayEngineParameter->getIndex();
+    mSpectralFftOrder = SpectralDelay::MIN_FFT_ORDER + mSpectralFftSizeParameter->getIndex();
+    mOutputLimiterEnabled = *mOutputLimiterParameter;
+    
+    // The widest kernels this CPU runs, unless a test forces a variant
+    mKernels = &KernelDispatch::select();
+    mCircularBufferLeft.setKernels(*mKernels);
+    mCircularBufferRight.setKernels(*mKernels);
+    mDampingFilters.setKernels(*mKernels);
+    mDiffusion.setKernels(*mKernels);
+    mMultiTap.setKernels(*mKernels);
+    mGranularCloud.setKernels(*mKernels);
+    
+    // With a fixed internal rate everything below runs at INTERNAL_SAMPLE_RATE and
+    // only the resamplers see the host rate
+    const double hostSampleRate = sampleRate;
+    prepareResampling(hostSampleRate, samplesPerBlock);
+    
+    // Prepared even when off, so whichever block first sees the flag finds it ready
+    mOutputLimiter.prepare(hostSampleRate, samplesPerBlock);
+    
+    sampleRate = mEngineSampleRate;
+    
+    // A fresh start runs the requested tier, which automatic mode then works down from,
+    // or straight away the high tier of an offline render
+    mActiveTier = isMaximumQualityRender() ? QualityTier::high : getQualityTier();
+    mQualityGovernor.prepare(sampleRate);
+    
+    if (mLongDelayMode) {
+        mCircularBufferLength = std::min(sampleRate * mLongDelayMaxSeconds, (double) MAX_LONG_DELAY_SAMPLES);
+        mDelayTimeScale = mCircularBufferLength / (sampleRate * MAX_DELAY_TIME);
+    } else {
+        mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+        mDelayTimeScale = 1.0f;
+    }
+
+    returnPoolSlot();
+    
+    if (mDelayEngine == DelayEngine::spectral) {
+        // The spectral engine keeps its own frame history, the lines need nothing
+        mCircularBufferLeft.releaseMemory();
+        mCircularBufferRight.releaseMemory();
+        
+        DELAY_TRACE_ZONE("prepare spectral");
+        mSpectralDelay.prepare(sampleRate, mSpectralFftOrder, MAX_DELAY_TIME);
+    } else if (mOnDemandMemory) {
+        // No memory of our own: processBlock borrows a slot when there's something to delay
+        mCircularBufferLeft.releaseMemory();
+        mCircularBufferRight.releaseMemory();
+        
+        mPoolSlotBytes = 2 * DelayLineStorage::getSizeInBytes(mCircularBufferLength, mDelayStorageFormat);
+        mPoolSlotPinned = mLongDelayMode;
+        mMemoryPool->reserve(mPoolSlotBytes, mPoolSlotPinned);
+    } else {
+        // Reallocates only when the length, storage format or mode changed. Long
+        // buffers are faulted in and locked here, not on the audio thread
+        DELAY_TRACE_ZONE("allocate delay lines");
+        
+        // A long buffer the system can't spare is halved until it fits, down to the normal
+        // range. Without even that the lines have no memory and only the dry signal passes
+        while (! allocateDelayLines() && mLongDelayMode && mCircularBufferLength / 2 >= sampleRate * MAX_DELAY_TIME) {
+            mCircularBufferLength /= 2;
+            mDelayTimeScale = mCircularBufferLength / (sampleRate * MAX_DELAY_TIME);
+        }
+    }
+    
+    if (mDelayEngine != DelayEngine::spectral)
+        mSpectralDelay.releaseMemory();
+    
+    const int engineLatency = mDelayEngine == DelayEngine::spectral ? mSpectralDelay.getLatencySamples() : 0;
+    const int limiterLatency = mOutputLimiterEnabled ? mOutputLimiter.getLatencySamples() : 0;
+    setLatencySamples(mResamplerLatency + juce::roundToInt(engineLatency * hostSampleRate / sampleRate) + limiterLatency);
+    
+    mOverviewLeft.prepare(mCircularBufferLength);
+    mOverviewRight.prepare(mCircularBufferLength);
+    
+    mDampingFilters.prepare(2);
+    mDiffusion.prepare(sampleRate);
+    mMultiTap.prepare(sampleRate, getMaxDelaySeconds());
+    mGranularCloud.prepare(sampleRate);
+    mCoefficientDesigner.prepare({ sampleRate, *mLowCutParameter, *mHighCutParameter });
+    
+    // 20 Hz one-pole smoothing, and the same smoothing applied over a whole control block
+    float smoothCoeff = std::exp(-2.0f * M_PI * 20.0f / sampleRate);
+    mControlSmoothCoeff = std::pow(smoothCoeff, (float) CONTROL_BLOCK_SIZE);
+    
+    reset();
+    
+    // A project loaded before playback gets its tail back here
+    if (! mPendingSnapshot.isEmpty()) {
+        applySnapshot(mPendingSnapshot);
+        mPendingSnapshot.clear();
+    }
+}
+
+void DelaytutorialAudioProcessor::reset()
+{
+    resetEngineState();
+    
+    mCircularBufferLeft.clear();
+    mCircularBufferRight.clear();
+    mSpectralDelay.reset();
+    mOutputLimiter.reset();
+    
+    if (mResampling) {
+        mInputResamplerLeft.reset();
+        mInputResamplerRight.reset();
+        mOutputResamplerLeft.reset(mResamplerLatency);
+        mOutputResamplerRight.reset(mResamplerLatency);
+    }
+}
+
+void DelaytutorialAudioProcessor::prepareResampling(double hostSampleRate, int samplesPerBlock)
+{
+    const int hostRate = juce::roundToInt(hostSampleRate);
+    
+    mResampling = mFixedInternalRate && hostRate != INTERNAL_SAMPLE_RATE;
+    mEngineSampleRate = mResampling ? (double) INTERNAL_SAMPLE_RATE : hostSampleRate;
+    mResamplerLatency = 0;
+    
+    if (! mResampling) {
+        mInternalBuffer.setSize(0, 0);
+        return;
+    }
+    
+    mResamplerBlockSize = std::max(samplesPerBlock, 1);
+    const int maxInternalBlock = (int) std::ceil(mResamplerBlockSize * (double) INTERNAL_SAMPLE_RATE / hostRate) + 2;
+    
+    for (auto* resampler : { &mInputResamplerLeft, &mInputResamplerRight }) {
+        resampler->setKernels(*mKernels);
+        resampler->prepare(hostRate, INTERNAL_SAMPLE_RATE, mResamplerBlockSize);
+    }
+    
+    for (auto* resampler : { &mOutputResamplerLeft, &mOutputResamplerRight }) {
+        resampler->setKernels(*mKernels);
+        resampler->prepare(INTERNAL_SAMPLE_RATE, hostRate, maxInternalBlock);
+    }
+    
+    // The way in needs its lookahead in host samples, the way out its own in internal
+    // samples, plus two to cover where block boundaries fall. The whole number of host
+    // samples above that is the exact delay of the round trip
+    mResamplerLatency = (int) std::ceil(mInputResamplerLeft.getLookahead()
+                                        + (mOutputResamplerLeft.getLookahead() + 2) * hostSampleRate / INTERNAL_SAMPLE_RATE);
+    
+    mInternalBuffer.setSize(2, maxInternalBlock);
+}
+
+void DelaytutorialAudioProcessor::resetEngineState()
+{
+    // Every piece of engine state starts from the same point, so two renders of
+    // the same input and parameters produce the same output
+    ++mEngineResets;
+    
     for (int i = 0; i < NUM_DELAY_LINES; ++i)
     {
         mDelayTimeInSamples_left[i] = 0.0f;
         mDelayTimeInSamples_right[i] = 0.0f;
+        mDelayTimeIncrement_left[i] = 0.0f;
+        mDelayTimeIncrement_right[i] = 0.0f;
+        mFeedbackLeft[i] = 0.0f;
+        mFeedbackRight[i] = 0.0f;
+    }
+    
+    for (int i = 0; i < 8; ++i)
+    {
+        mFilterStatesLeft[i] = 0.0f;
+        mFilterStatesRight[i] = 0.0f;
     }
+    
     mDelayReadHead_left = 0;
     mDelayReadHead_right = 0;
     mLfoPhase = 0;
     mLfoDepthSmooth = 0;
     mStereoOffsetSmooth = 0;
     mDelayFraction = 0.66f;
-
-    
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
-
-    if (mCircularBufferLeft == nullptr) {
-        mCircularBufferLeft = new float[mCircularBufferLength];
-    }
-    
-    juce::zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
     
-    if (mCircularBufferRight == nullptr) {
-        mCircularBufferRight = new float[mCircularBufferLength];
-    }
-    
-    juce::zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
-
+    mLastInputLeft = 0.0f;
+    mLastInputRight = 0.0f;
+    mLastOutputLeft = 0.0f;
+    mLastOutputRight = 0.0f;
+    mDcBlockerStateLeft = 0.0f;
+    mDcBlockerStateRight = 0.0f;
+    mDensityFactor = 0.0f;
+    mTremPhase = 0.0f;
+    mTremLfo = 0.0f;
+    mTremLfoIncrement = 0.0f;
+    mStereoOffsetIncrement = 0.0f;
+    mControlSamplesRemaining = 0;
+    mStaticDelayActive = false;
+    mStaticFadeSamplesRemaining = 0;
+    mStaticExitSamplesRemaining = 0;
+    mStaticExitFading = false;
+    mFadeFromTier = mActiveTier;
+    mTierFadeSamplesRemaining = 0;
+    mOutputOversamplerLeft.reset();
+    mOutputOversamplerRight.reset();
     
+    mCircularBufferWriteHead = 0;
     mDelayTimeSmooth = *mDelayTimeParameter;
+    mSilentSamples = 0;
     
-    std::fill(mCircularBufferLeft, mCircularBufferLeft + mCircularBufferLength, 0.0f);
-    std::fill(mCircularBufferRight, mCircularBufferRight + mCircularBufferLength, 0.0f);
+    mOverviewLeft.clear();
+    mOverviewRight.clear();
+    
+    mDampingFilters.reset();
+    mDiffusion.reset();
+    mMultiTap.reset();
+    mGranularCloud.reset();
 }
 
 float DelaytutorialAudioProcessor::lin_interp(float sample_x, float sample_x1, float inPhase) {
-    return (1 - inPhase) * sample_x + inPhase * sample_x1;
+    return DelayKernels::linearInterpolate(sample_x, sample_x1, inPhase);
 }
 
 void DelaytutorialAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    
+   #if DELAY_TRACING
+    // Trace builds leave the zones of the last render in the temp folder, for Perfetto
+    if (mWritesTraceOnRelease)
+        TraceRecorder::getInstance().writeChromeTrace(TraceRecorder::getDefaultFile());
+   #endif
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -202,91 +443,163 @@ bool DelaytutorialAudioProcessor::isBusesLayoutSupported (const BusesLayout& lay
 void DelaytutorialAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    DELAY_TRACE_ZONE("processBlock");
+    
+    // Checking builds abort on any allocation, lock or blocking call from here on.
+    // Offline renders are only checked with DELAY_REALTIME_CHECKS_OFFLINE as well
+    DELAY_REALTIME_CHECK_SCOPE(DELAY_REALTIME_CHECKS_OFFLINE || ! isNonRealtime());
+    
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
-    
-    const float inputGainCompensation = 0.15f;  // Reduce input by 75%
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(1);
+    if (mResampling)
+        processResampledBlock(buffer);
+    else
+        processEngineBlock(buffer);
     
-    float delayTimeInSeconds = *mDelayTimeParameter;
-    float baseDelayTimeInSamples = getSampleRate() * delayTimeInSeconds;
-    float lfoPhaseOffset = *mLfoPhaseParameter;
-    float stereoOffsetInMs = lfoPhaseOffset * 50.0f;
-    float stereoOffset = stereoOffsetInMs * 0.001f * getSampleRate();
+    if (mOutputLimiterEnabled) {
+        DELAY_TRACE_ZONE("output limiter");
+        mOutputLimiter.process(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples());
+    }
+}
+
+void DelaytutorialAudioProcessor::processResampledBlock(juce::AudioBuffer<float>& buffer)
+{
+    // The resamplers' cost is this zone less the engine zones inside it
+    DELAY_TRACE_ZONE("resampled block");
+    
+    // Hosts may exceed the block size they announced, so go in pieces the resamplers were sized for
+    for (int start = 0; start < buffer.getNumSamples(); start += mResamplerBlockSize) {
+        const int numSamples = std::min(mResamplerBlockSize, buffer.getNumSamples() - start);
+        float* left = buffer.getWritePointer(0, start);
+        float* right = buffer.getWritePointer(1, start);
+        
+        mInputResamplerLeft.push(left, numSamples);
+        mInputResamplerRight.push(right, numSamples);
+        
+        const int numInternalSamples = mInputResamplerLeft.read(mInternalBuffer.getWritePointer(0), mInternalBuffer.getNumSamples());
+        mInputResamplerRight.read(mInternalBuffer.getWritePointer(1), numInternalSamples);
+        
+        // Refers to the internal buffer's memory, nothing is allocated
+        juce::AudioBuffer<float> internalBlock(mInternalBuffer.getArrayOfWritePointers(), 2, numInternalSamples);
+        processEngineBlock(internalBlock);
+        
+        mOutputResamplerLeft.push(internalBlock.getReadPointer(0), numInternalSamples);
+        mOutputResamplerRight.push(internalBlock.getReadPointer(1), numInternalSamples);
+        
+        // The latency leaves enough internal samples for every host sample
+        const int numRead = mOutputResamplerLeft.read(left, numSamples);
+        mOutputResamplerRight.read(right, numSamples);
+        jassert(numRead == numSamples);
+    }
+}
+
+void DelaytutorialAudioProcessor::processEngineBlock(juce::AudioBuffer<float>& buffer)
+{
+    const float inputGainCompensation = 0.15f;  // Reduce input by 75%
     
-    float smoothCoeff = std::exp(-2.0f * M_PI * 20.0f / getSampleRate());
+    mSamplesWritten += buffer.getNumSamples();
+
+    if (mDelayEngine == DelayEngine::spectral) {
+        processSpectralBlock(buffer);
+        return;
+    }
 
-    const float minDelayTimeInSamples = 0.025f * getSampleRate(); // 25ms in samples
+    if ((mOnDemandMemory && ! updateOnDemandMemory(buffer)) || ! mCircularBufferLeft.hasMemory()) {
+        // No delay memory, on demand or because there was none to allocate, means
+        // nothing is ringing, so only the dry part comes out
+        buffer.applyGain(1.0f - *mDryWetParameter);
+        return;
+    }
 
+    DELAY_TRACE_ZONE("lines engine");
+    const juce::int64 blockStartTicks = juce::Time::getHighResolutionTicks();
+    
+    updateQualityTier();
+    const QualitySettings& tier = getQualitySettings(mActiveTier);
+    const QualitySettings& fadeFromTier = getQualitySettings(mFadeFromTier);
+    
+    float* leftChannel = buffer.getWritePointer(0);
+    float* rightChannel = buffer.getWritePointer(1);
+    
     // DC blocking filter coefficients
     const float R = 0.995f;
-    static float lastInputLeft = 0.0f, lastInputRight = 0.0f, lastOutputLeft = 0.0f, lastOutputRight = 0.0f;
 
-    // All-pass filter coefficients (for diffusion)
+    // Gain of the Schroeder all-passes in the diffusion network
     const float allpassCoeff = 0.7f;
-    static float allpassBufferLeft[NUM_DELAY_LINES][4] = {{0.0f}};
-    static float allpassBufferRight[NUM_DELAY_LINES][4] = {{0.0f}};
 
     // Density build-up parameters
     const float densityBuildupRate = 0.99f; // Adjust this value to control build-up speed
-    static float densityFactor = 0.0f;
-
-    // Feedback matrix
-    static const float feedbackMatrix[NUM_DELAY_LINES][NUM_DELAY_LINES] = {
-        {0.2f, 0.1f, 0.05f, 0.025f},
-        {0.1f, 0.3f, 0.15f, 0.075f},
-        {0.05f, 0.15f, 0.4f, 0.2f},
-        {0.025f, 0.075f, 0.2f, 0.5f}
-    };
-
-    // Waveshaping function
-    auto softClip = [](float x, float amount) {
-        float absX = std::abs(x);
-        if (absX <= 1.0f / 3.0f) {
-            return 2.0f * x;
-        } else if (absX <= 2.0f / 3.0f) {
-            return x * (3.0f - powf(2.0f - 3.0f * absX, 2.0f)) / 3.0f;
-        } else {
-            return ((x > 0.0f) ? 1.0f : -1.0f);
-        }
-    };
-
-    // Prime-based waveshaping amounts
-    const float primes[NUM_DELAY_LINES] = {2.0f, 3.0f, 5.0f, 7.0f};
-    const float baseWaveshapeAmount = 5.0f;
 
     // DC blocking filter
     float dcBlockCoeff = 0.995f;
-    static float dcBlockerStateLeft = 0.0f;
-    static float dcBlockerStateRight = 0.0f;
+
+    // Feedback matrix, damping and early reflections come designed from the background
+    // thread; offline there is time to design a moved cutoff before this block
+    mCoefficientDesigner.request(*mLowCutParameter, *mHighCutParameter);
+    if (isNonRealtime()) {
+        // Designing allocates and locks, which offline is allowed
+        DELAY_REALTIME_SUSPEND_SCOPE();
+        mCoefficientDesigner.designNow();
+    }
+    
+    const EngineCoefficients& coefficients = mCoefficientDesigner.acquire();
+    const auto& feedbackMatrix = coefficients.feedbackMatrix;
+    static_assert(EngineCoefficients::NUM_LINES == NUM_DELAY_LINES, "One matrix row and column per delay line");
+    
+    mDampingFilters.setDesign(coefficients.damping);
+    
+    // Loudest sample written to the delay memory in this block
+    float bufferPeak = 0.0f;
+    const int blockStartWriteHead = mCircularBufferWriteHead;
 
     for (int sample = 0; sample < buffer.getNumSamples(); sample++)
     {
+        // Modulation, delay-time smoothing and tremolo run at control rate
+        if (mControlSamplesRemaining == 0) {
+            updateControlValues();
+            mControlSamplesRemaining = CONTROL_BLOCK_SIZE;
+        }
+        
+        // Position in a tier crossfade, 1 once it has finished
+        float tierFade = 1.0f;
+        if (mTierFadeSamplesRemaining > 0) {
+            --mTierFadeSamplesRemaining;
+            tierFade = 1.0f - (float) mTierFadeSamplesRemaining / TIER_CROSSFADE_LENGTH;
+        }
+        
         // Apply DC blocking filter
         float inputLeft = leftChannel[sample];
         float inputRight = rightChannel[sample];
-        float outputLeft = inputLeft - lastInputLeft + R * lastOutputLeft * inputGainCompensation;
-        float outputRight = inputRight - lastInputRight + R * lastOutputRight * inputGainCompensation;
-        lastInputLeft = inputLeft;
-        lastInputRight = inputRight;
-        lastOutputLeft = outputLeft;
-        lastOutputRight = outputRight;
-
+        float outputLeft = DelayKernels::inputDcBlock(inputLeft, mLastInputLeft, mLastOutputLeft, R, inputGainCompensation);
+        float outputRight = DelayKernels::inputDcBlock(inputRight, mLastInputRight, mLastOutputRight, R, inputGainCompensation);
+
+        // Every line is fed back the same signal, so damping it once per channel ahead of
+        // the matrix does for all of them: the matrix only scales it line by line
+        const float* dampedLeft = mFeedbackLeft;
+        const float* dampedRight = mFeedbackRight;
+        float dampedLinesLeft[NUM_DELAY_LINES];
+        float dampedLinesRight[NUM_DELAY_LINES];
+        
+        if (mDampingFilters.isActive()) {
+            float dampingLanes[2] = { mFeedbackLeft[0], mFeedbackRight[0] };
+            mDampingFilters.process(dampingLanes);
+            
+            std::fill(dampedLinesLeft, dampedLinesLeft + NUM_DELAY_LINES, dampingLanes[0]);
+            std::fill(dampedLinesRight, dampedLinesRight + NUM_DELAY_LINES, dampingLanes[1]);
+            dampedLeft = dampedLinesLeft;
+            dampedRight = dampedLinesRight;
+        }
+        
         // Prepare feedback using the matrix
-        float feedbackLeft[NUM_DELAY_LINES] = {0.0f};
-        float feedbackRight[NUM_DELAY_LINES] = {0.0f};
+        float feedbackLeft[NUM_DELAY_LINES];
+        float feedbackRight[NUM_DELAY_LINES];
 
-        for (int i = 0; i < NUM_DELAY_LINES; ++i) {
-            for (int j = 0; j < NUM_DELAY_LINES; ++j) {
-                feedbackLeft[i] += mFeedbackLeft[j] * feedbackMatrix[i][j];
-                feedbackRight[i] += mFeedbackRight[j] * feedbackMatrix[i][j];
-            }
-        }
+        DelayKernels::mixFeedbackMatrix(&feedbackMatrix[0][0], NUM_DELAY_LINES, dampedLeft, feedbackLeft);
+        DelayKernels::mixFeedbackMatrix(&feedbackMatrix[0][0], NUM_DELAY_LINES, dampedRight, feedbackRight);
 
         // Write to circular buffer with feedback
         float summedFeedbackLeft = 0.0f;
@@ -303,177 +616,107 @@ void DelaytutorialAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
             summedFeedbackRight /= maxFeedback;
         }
         
-        mCircularBufferLeft[mCircularBufferWriteHead] = outputLeft + summedFeedbackLeft;
-        mCircularBufferRight[mCircularBufferWriteHead] = outputRight + summedFeedbackRight;
+        float bufferInputLeft = outputLeft + summedFeedbackLeft;
+        float bufferInputRight = outputRight + summedFeedbackRight;
         
-        // Smooth the stereo offset
-        mStereoOffsetSmooth = mStereoOffsetSmooth * smoothCoeff + stereoOffset * (1.0f - smoothCoeff);
-
-        float combined_delay_left = 0.0f;
-        float combined_delay_right = 0.0f;
-        float total_weight = 0.0f;
+        mCircularBufferLeft.write(mCircularBufferWriteHead, bufferInputLeft);
+        mCircularBufferRight.write(mCircularBufferWriteHead, bufferInputRight);
+        
+        mOverviewLeft.write(mCircularBufferWriteHead, bufferInputLeft);
+        mOverviewRight.write(mCircularBufferWriteHead, bufferInputRight);
+        
+        bufferPeak = std::max(bufferPeak, std::max(std::abs(bufferInputLeft), std::abs(bufferInputRight)));
+        
+        static_assert(KernelDispatch::NUM_LANES == 2 * NUM_DELAY_LINES, "One kernel lane per line and channel");
+        
+        // Left lines then right lines, as the damping filters lay them out
+        float lineLanes[KernelDispatch::NUM_LANES];
+        float lineGains[NUM_DELAY_LINES];
         
         float earlyReflectionLeft = 0.0f;
         float earlyReflectionRight = 0.0f;
 
         for (int i = 0; i < NUM_DELAY_LINES; ++i)
         {
-            // Early reflections setup
-             const int numReflections = 8;
-             float reflectionDelays[numReflections] = {0.05f, 0.10f, 0.15f, 0.20f, 0.25f, 0.30f, 0.35f, 0.40f}; // in seconds
-             float reflectionGains[numReflections] = {0.6f, 0.5f, 0.4f, 0.3f, 0.2f, 0.1f, 0.05f, 0.025f};
-             const int predelaySamples = static_cast<int>(0.02f * getSampleRate()); // 20ms predelay
-
-             // Convert reflection delays to samples
-             int reflectionDelaySamples[numReflections];
-             for (int i = 0; i < numReflections; ++i) {
-                 reflectionDelaySamples[i] = static_cast<int>(reflectionDelays[i] * getSampleRate());
-             }
+            lineGains[i] = getLineGain(i, tier, fadeFromTier, tierFade);
             
-            float filterCoeffs[numReflections];
-            for (int i = 0; i < numReflections; ++i) {
-                float cutoff = 20000.0f * std::pow(0.99f, i); // Exponentially decreasing cutoff frequency
-                float w0 = 2.0f * M_PI * cutoff / getSampleRate();
-                filterCoeffs[i] = std::exp(-w0);
+            if (lineGains[i] == 0.0f) {
+                // Not part of this tier: silent, with its delay time still following the ramp
+                lineLanes[i] = 0.0f;
+                lineLanes[NUM_DELAY_LINES + i] = 0.0f;
+                advanceDelayTimes(i);
+                continue;
             }
-
-             // Calculate early reflections with low-pass filtering, density envelope, and predelay
-                 for (int i = 0; i < numReflections; ++i)
-                 {
-                     int readIndex = (mCircularBufferWriteHead - reflectionDelaySamples[i] - predelaySamples + mCircularBufferLength) % mCircularBufferLength;
-                     
-                      // Apply low-pass filter
-                      mFilterStatesLeft[i] = filterCoeffs[i] * mFilterStatesLeft[i] + (1.0f - filterCoeffs[i]) * mCircularBufferLeft[readIndex];
-                      mFilterStatesRight[i] = filterCoeffs[i] * mFilterStatesRight[i] + (1.0f - filterCoeffs[i]) * mCircularBufferRight[readIndex];
-
-                     // Apply density envelope to early reflections (with reduced initial gain)
-                     float reflectionGain = reflectionGains[i] * 0.9f; // Reduced initial gain
-                     earlyReflectionLeft += reflectionGain;
-                     earlyReflectionRight += reflectionGain;
-                 }
-            
-            // Define prime numbers for irregular delay multipliers
-            const float delayPrimes[NUM_DELAY_LINES] = {2.0f, 3.0f, 5.0f, 7.0f};
-
-            // In the class definition, add a new member variable:
-            float mIrregularDelayFactor;
-
-            // In the constructor or prepareToPlay, initialize this factor:
-            mIrregularDelayFactor = 0.2f; // Adjust this value to control the irregularity
-
-            // In the processBlock function, replace the original delay multiplier line with:
-            float delayMultiplier = 1.0f + (delayPrimes[i] / 7.0f - 1.0f) * mIrregularDelayFactor;
-            float weight = 1.0f / (i + 1);  // Decreasing weight for each delay line
-
-            // Unique LFO phase for each delay line
-            float uniqueLfoPhase_left = mLfoPhase + (float)i / NUM_DELAY_LINES;
-            float uniqueLfoPhase_right = uniqueLfoPhase_left + lfoPhaseOffset;
-            
-            // Wrap phases between 0 and 1
-            uniqueLfoPhase_left = std::fmod(uniqueLfoPhase_left, 1.0f);
-            uniqueLfoPhase_right = std::fmod(uniqueLfoPhase_right, 1.0f);
             
-            float lfoOut_left = (1.0f - std::cos(2.0f * M_PI * uniqueLfoPhase_left)) * 0.0725f;
-            float lfoOut_right = (1.0f - std::cos(2.0f * M_PI * uniqueLfoPhase_right)) * 0.0725f;
-            
-            float lfoModulation_left = lfoOut_left * (*mLfoDepthParameter / 3);
-            float lfoModulation_right = lfoOut_right * (*mLfoDepthParameter / 3);
-            
-            float targetDelayTimeInSamples_left = baseDelayTimeInSamples * delayMultiplier * (1.0f + lfoModulation_left);
-            float targetDelayTimeInSamples_right = baseDelayTimeInSamples * delayMultiplier * (1.0f + lfoModulation_right);
-
-            // Check if delay time is below 25ms and triple it if so
-            if (targetDelayTimeInSamples_left < minDelayTimeInSamples)
-                targetDelayTimeInSamples_left *= 3.0f;
-            if (targetDelayTimeInSamples_right < minDelayTimeInSamples)
-                targetDelayTimeInSamples_right *= 3.0f;
-
-            // Smooth the delay times
-            mDelayTimeInSamples_left[i] = mDelayTimeInSamples_left[i] * smoothCoeff + targetDelayTimeInSamples_left * (1.0f - smoothCoeff);
-            mDelayTimeInSamples_right[i] = mDelayTimeInSamples_right[i] * smoothCoeff + targetDelayTimeInSamples_right * (1.0f - smoothCoeff);
-
-            float mDelayReadHead_left = mCircularBufferWriteHead - mDelayTimeInSamples_left[i];
-            float mDelayReadHead_right = mCircularBufferWriteHead - mDelayTimeInSamples_right[i] - mStereoOffsetSmooth;
-
-            // Pitch shifting logic
-            if (i % 2 == 1) {  // Odd numbered delay lines (second, fourth, etc.)
-                if (i % 4 == 1) {  // Second, sixth, tenth, etc. delay lines
-                    mDelayReadHead_left *= 2.0f;  // Octave up
-                    mDelayReadHead_right *= 2.0f;
-                } else {  // Fourth, eighth, twelfth, etc. delay lines
-                    mDelayReadHead_left *= 0.5f;  // Octave down
-                    mDelayReadHead_right *= 0.5f;
-                }
-            }
-
-            // Ensure we never go below -1 octave
-            float minReadSpeed = 0.25f;  // -1 octave
-            float maxDelayTime_left = mCircularBufferWriteHead - mDelayReadHead_left;
-            float maxDelayTime_right = mCircularBufferWriteHead - mDelayReadHead_right;
-
-            if (maxDelayTime_left > mDelayTimeInSamples_left[i] / minReadSpeed) {
-                mDelayReadHead_left = mCircularBufferWriteHead - (mDelayTimeInSamples_left[i] / minReadSpeed);
+            // Calculate early reflections with low-pass filtering, density envelope, and predelay.
+            // The tap count switches without a crossfade, the taps only feed their own filter states
+            DelayKernels::processReflectionTaps(mCircularBufferLeft, mCircularBufferLength, mCircularBufferWriteHead,
+                                                coefficients.reflectionDelaySamples, coefficients.reflectionFilterCoeffs, mFilterStatesLeft, tier.numReflectionTaps);
+            DelayKernels::processReflectionTaps(mCircularBufferRight, mCircularBufferLength, mCircularBufferWriteHead,
+                                                coefficients.reflectionDelaySamples, coefficients.reflectionFilterCoeffs, mFilterStatesRight, tier.numReflectionTaps);
+
+            for (int i = 0; i < tier.numReflectionTaps; ++i)
+            {
+                // Apply density envelope to early reflections (with reduced initial gain)
+                float reflectionGain = coefficients.reflectionGains[i] * 0.9f; // Reduced initial gain
+                earlyReflectionLeft += reflectionGain;
+                earlyReflectionRight += reflectionGain;
             }
-            if (maxDelayTime_right > mDelayTimeInSamples_right[i] / minReadSpeed) {
-                mDelayReadHead_right = mCircularBufferWriteHead - (mDelayTimeInSamples_right[i] / minReadSpeed);
-            }
-
-            // Ensure read heads are within buffer bounds
-            mDelayReadHead_left = std::fmod(mDelayReadHead_left, static_cast<float>(mCircularBufferLength));
-            mDelayReadHead_right = std::fmod(mDelayReadHead_right, static_cast<float>(mCircularBufferLength));
-            if (mDelayReadHead_left < 0) mDelayReadHead_left += mCircularBufferLength;
-            if (mDelayReadHead_right < 0) mDelayReadHead_right += mCircularBufferLength;
 
-            int readHead_x_left = static_cast<int>(mDelayReadHead_left);
-            int readHead_x1_left = (readHead_x_left + 1) % mCircularBufferLength;
-            float readHeadFloat_left = mDelayReadHead_left - readHead_x_left;
-
-            int readHead_x_right = static_cast<int>(mDelayReadHead_right);
-            int readHead_x1_right = (readHead_x_right + 1) % mCircularBufferLength;
-            float readHeadFloat_right = mDelayReadHead_right - readHead_x_right;
-
-            // Implement crossfade for buffer wraparound
             float delay_sample_left, delay_sample_right;
-            if (readHead_x1_left < readHead_x_left) {
-                float fade = (float)readHead_x1_left / mCircularBufferLength;
-                delay_sample_left = lin_interp(mCircularBufferLeft[readHead_x_left], mCircularBufferLeft[0], fade);
+            
+            if (mStaticDelayActive && isStaticLine(i)) {
+                // Already read for the whole control block
+                const int blockPosition = CONTROL_BLOCK_SIZE - mControlSamplesRemaining;
+                delay_sample_left = mStaticLineOutputLeft[i][blockPosition];
+                delay_sample_right = mStaticLineOutputRight[i][blockPosition];
             } else {
-                delay_sample_left = lin_interp(mCircularBufferLeft[readHead_x_left], mCircularBufferLeft[readHead_x1_left], readHeadFloat_left);
+            double mDelayReadHead_left, mDelayReadHead_right;
+            if (mLongDelayMode)
+                getReadHeads<double>(i, mDelayReadHead_left, mDelayReadHead_right);
+            else
+                getReadHeads<float>(i, mDelayReadHead_left, mDelayReadHead_right);
+
+            // Interpolated read in the tier's interpolation order
+            delay_sample_left = readModulatedLine(mCircularBufferLeft, mDelayReadHead_left, tier, fadeFromTier, tierFade);
+            delay_sample_right = readModulatedLine(mCircularBufferRight, mDelayReadHead_right, tier, fadeFromTier, tierFade);
+            
+            if (mStaticExitFading && isStaticLine(i)) {
+                // Just left the static path: its block read fades out under this one
+                const int blockPosition = CONTROL_BLOCK_SIZE - mControlSamplesRemaining;
+                const float staticGain = mStaticExitGain[blockPosition];
+                delay_sample_left += staticGain * (mStaticLineOutputLeft[i][blockPosition] - delay_sample_left);
+                delay_sample_right += staticGain * (mStaticLineOutputRight[i][blockPosition] - delay_sample_right);
             }
-
-            if (readHead_x1_right < readHead_x_right) {
-                float fade = (float)readHead_x1_right / mCircularBufferLength;
-                delay_sample_right = lin_interp(mCircularBufferRight[readHead_x_right], mCircularBufferRight[0], fade);
-            } else {
-                delay_sample_right = lin_interp(mCircularBufferRight[readHead_x_right], mCircularBufferRight[readHead_x1_right], readHeadFloat_right);
             }
 
-            // Apply prime-based waveshaping with smoother transition
-            float waveshapeAmount = baseWaveshapeAmount * primes[i] / 7.0f; // Normalize by the largest prime
-            delay_sample_left = softClip(delay_sample_left, waveshapeAmount);
-            delay_sample_right = softClip(delay_sample_right, waveshapeAmount);
+            lineLanes[i] = delay_sample_left;
+            lineLanes[NUM_DELAY_LINES + i] = delay_sample_right;
             
+            // Advance the smoothed delay times along this control block's ramp
+            advanceDelayTimes(i);
+        }
+        
+        mStereoOffsetSmooth += mStereoOffsetIncrement;
+        
+        // Waveshaping, volume compensation and all-pass diffusion of every line at once
+        mDiffusion.process(lineLanes, allpassCoeff);
+        
+        float combined_delay_left = 0.0f;
+        float combined_delay_right = 0.0f;
+        float total_weight = 0.0f;
+        
+        for (int i = 0; i < NUM_DELAY_LINES; ++i)
+        {
+            float weight = lineGains[i] / (i + 1);  // Decreasing weight for each delay line, faded with the tier
             float compensationFactor = 0.5f; // Adjust this value to control overall volume
-            delay_sample_left *= compensationFactor;
-            delay_sample_right *= compensationFactor;
-
+            
             // After combining delay lines, add an extra saturation stage with volume compensation
-            combined_delay_left = softClip(combined_delay_left * 2.0f, 1.0f) * 0.5f * compensationFactor;
-            combined_delay_right = softClip(combined_delay_right * 2.0f, 1.0f) * 0.5f * compensationFactor;
-
-            // Apply all-pass diffusion
-            for (int j = 0; j < 4; ++j) {
-                float allpass_out_left = allpassCoeff * (delay_sample_left - allpassBufferLeft[i][j]) + allpassBufferLeft[i][j];
-                allpassBufferLeft[i][j] = delay_sample_left;
-                delay_sample_left = allpass_out_left;
-
-                float allpass_out_right = allpassCoeff * (delay_sample_right - allpassBufferRight[i][j]) + allpassBufferRight[i][j];
-                allpassBufferRight[i][j] = delay_sample_right;
-                delay_sample_right = allpass_out_right;
-            }
-
-            combined_delay_left += delay_sample_left * weight;
-            combined_delay_right += delay_sample_right * weight;
+            combined_delay_left = DelayKernels::softClip(combined_delay_left * 2.0f) * 0.5f * compensationFactor;
+            combined_delay_right = DelayKernels::softClip(combined_delay_right * 2.0f) * 0.5f * compensationFactor;
+            
+            combined_delay_left += lineLanes[i] * weight;
+            combined_delay_right += lineLanes[NUM_DELAY_LINES + i] * weight;
             total_weight += weight;
         }
 
@@ -484,30 +727,23 @@ void DelaytutorialAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
         }
 
         // Apply density build-up
-        densityFactor = densityFactor * densityBuildupRate + (1.0f - densityBuildupRate);
-        combined_delay_left *= densityFactor;
-        combined_delay_right *= densityFactor;
+        mDensityFactor = mDensityFactor * densityBuildupRate + (1.0f - densityBuildupRate);
+        combined_delay_left *= mDensityFactor;
+        combined_delay_right *= mDensityFactor;
 
         // Apply DC blocking filter
-        float dcBlockedLeft = combined_delay_left - dcBlockerStateLeft + dcBlockCoeff * dcBlockerStateLeft;
-        dcBlockerStateLeft = dcBlockedLeft;
-        float dcBlockedRight = combined_delay_right - dcBlockerStateRight + dcBlockCoeff * dcBlockerStateRight;
-        dcBlockerStateRight = dcBlockedRight;
-
-        combined_delay_left = dcBlockedLeft;
-        combined_delay_right = dcBlockedRight;
+        combined_delay_left = DelayKernels::outputDcBlock(combined_delay_left, mDcBlockerStateLeft, dcBlockCoeff);
+        combined_delay_right = DelayKernels::outputDcBlock(combined_delay_right, mDcBlockerStateRight, dcBlockCoeff);
 
         // Soft clipping to prevent overloads
-        combined_delay_left = std::tanh(combined_delay_left);
-        combined_delay_right = std::tanh(combined_delay_right);
+        combined_delay_left = saturateOutput(combined_delay_left, mOutputOversamplerLeft, tier, fadeFromTier, tierFade);
+        combined_delay_right = saturateOutput(combined_delay_right, mOutputOversamplerRight, tier, fadeFromTier, tierFade);
         
-        const float tremRate = 2.0f; // 2 Hz
         const float tremDepth = 0.5f; // 50% depth
-        static float tremPhase = 0.0f;
-        const float tremPhaseInc = tremRate / getSampleRate();
         
         // Apply Harmonic Tremolo
-               float tremLfo = 0.5f + 0.5f * sinf(2.0f * M_PI * tremPhase);
+               float tremLfo = mTremLfo;
+               mTremLfo += mTremLfoIncrement;
                float lowPass = combined_delay_left * (1.0f - (tremDepth / mDelayFraction) * (tremLfo * 3)) + combined_delay_right * (tremDepth * tremLfo);
         
         float highPass = combined_delay_left * (tremDepth * tremLfo) + combined_delay_right * (1.0f - tremDepth * tremLfo);
@@ -544,54 +780,1146 @@ void DelaytutorialAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer
                     mCircularBufferWriteHead = 0;
                     // Implement a short crossfade here if needed
                 }
-            
-                // Update tremolo phase
-                tremPhase += tremPhaseInc;
-                if (tremPhase >= 1.0f) tremPhase -= 1.0f;
-
-                // Update the main LFO phase
-                mLfoPhase += *mLfoRateParameter / getSampleRate();
-                mLfoPhase = std::fmod(mLfoPhase, 1.0f);
+                
+                mControlSamplesRemaining--;
             }
+    
+    // The taps read the whole block back once it is in the buffers. Switched on, they
+    // fade in from silence; their makeup undoes the input gain compensation
+    const bool multiTap = *mMultiTapParameter;
+    updateTapParameters();
+    if (multiTap && ! mMultiTapRunning)
+        mMultiTap.reset();
+    mMultiTapRunning = multiTap;
+    
+    if (multiTap) {
+        DELAY_TRACE_ZONE("multi-tap");
+        mMultiTap.process(mCircularBufferLeft, mCircularBufferRight, blockStartWriteHead, leftChannel, rightChannel,
+                          buffer.getNumSamples(), *mDryWetParameter / inputGainCompensation);
+    }
+    
+    // The same for the grains, which start from an empty pool
+    const bool granular = *mGranularParameter;
+    mGranularCloud.setSettings(getGranularSettings());
+    if (granular && ! mGranularRunning)
+        mGranularCloud.reset();
+    mGranularRunning = granular;
+    
+    if (granular) {
+        DELAY_TRACE_ZONE("granular cloud");
+        const float delaySamples = getDelaySeconds(*mDelayTimeParameter) * mEngineSampleRate;
+        mGranularCloud.process(mCircularBufferLeft, mCircularBufferRight, blockStartWriteHead, leftChannel, rightChannel,
+                               buffer.getNumSamples(), delaySamples, *mDryWetParameter / inputGainCompensation);
+    }
+    
+    mQualityGovernor.addMeasurement(juce::Time::getHighResolutionTicks() - blockStartTicks, buffer.getNumSamples());
+    
+    if (mOnDemandMemory)
+        releaseDecayedMemory(bufferPeak, buffer.getNumSamples());
         }
 
-//==============================================================================
-bool DelaytutorialAudioProcessor::hasEditor() const
+void DelaytutorialAudioProcessor::processSpectralBlock(juce::AudioBuffer<float>& buffer)
 {
-    return true; // (change this to false if you choose to not supply an editor)
+    DELAY_TRACE_ZONE("spectral engine");
+    const juce::int64 blockStartTicks = juce::Time::getHighResolutionTicks();
+    
+    // The frame history holds MAX_DELAY_TIME at any band scale, long-delay mode or not
+    const float delaySeconds = std::min((float) *mDelayTimeParameter, (float) MAX_DELAY_TIME);
+    mSpectralDelay.setParameters(delaySeconds, *mFeedbackParameter, *mLowCutParameter, *mHighCutParameter, *mSpectralFreezeParameter);
+    mSpectralDelay.process(buffer.getWritePointer(0), buffer.getWritePointer(1), buffer.getNumSamples(), *mDryWetParameter);
+    
+    mQualityGovernor.addMeasurement(juce::Time::getHighResolutionTicks() - blockStartTicks, buffer.getNumSamples());
 }
 
-juce::AudioProcessorEditor* DelaytutorialAudioProcessor::createEditor()
+template <typename Precision>
+void DelaytutorialAudioProcessor::updateDelayTimes(float lfoPhaseOffset, float lfoDepth, float stereoOffset,
+                                                   float* targetDelay_left, float* targetDelay_right)
 {
-    return new DelaytutorialAudioProcessorEditor (*this);
+    const Precision baseDelayTimeInSamples = (Precision) (mEngineSampleRate * getDelaySeconds(*mDelayTimeParameter));
+    const float minDelayTimeInSamples = 0.025f * mEngineSampleRate; // 25ms in samples
+    
+    // An oversampled tier's saturation delays the wet signal and every repeat through the feedback,
+    // so its read heads are brought forward by as much to keep echoes where the other tiers put them
+    const float loopDelay = getQualitySettings(mActiveTier).oversampling > 1 ? mOutputOversamplerLeft.getGroupDelay() : 0.0f;
+    
+    // Define prime numbers for irregular delay multipliers
+    const float delayPrimes[NUM_DELAY_LINES] = {2.0f, 3.0f, 5.0f, 7.0f};
+    const float irregularDelayFactor = 0.2f; // Adjust this value to control the irregularity
+    
+    const float blockDecay = mControlSmoothCoeff;
+    const float rampScale = 1.0f / CONTROL_BLOCK_SIZE;
+    
+    for (int i = 0; i < NUM_DELAY_LINES; ++i)
+    {
+        float delayMultiplier = 1.0f + (delayPrimes[i] / 7.0f - 1.0f) * irregularDelayFactor;
+
+        // Unique LFO phase for each delay line
+        float uniqueLfoPhase_left = mLfoPhase + (float)i / NUM_DELAY_LINES;
+        float uniqueLfoPhase_right = uniqueLfoPhase_left + lfoPhaseOffset;
+        
+        // Wrap phases between 0 and 1
+        uniqueLfoPhase_left = std::fmod(uniqueLfoPhase_left, 1.0f);
+        uniqueLfoPhase_right = std::fmod(uniqueLfoPhase_right, 1.0f);
+        
+        float lfoOut_left = DelayKernels::raisedCosineLfo(uniqueLfoPhase_left);
+        float lfoOut_right = DelayKernels::raisedCosineLfo(uniqueLfoPhase_right);
+        
+        float lfoModulation_left = lfoOut_left * (lfoDepth / 3);
+        float lfoModulation_right = lfoOut_right * (lfoDepth / 3);
+        
+        Precision targetDelayTimeInSamples_left = baseDelayTimeInSamples * delayMultiplier * (1.0f + lfoModulation_left);
+        Precision targetDelayTimeInSamples_right = baseDelayTimeInSamples * delayMultiplier * (1.0f + lfoModulation_right);
+
+        // Check if delay time is below 25ms and triple it if so
+        if (targetDelayTimeInSamples_left < minDelayTimeInSamples)
+            targetDelayTimeInSamples_left *= 3.0f;
+        if (targetDelayTimeInSamples_right < minDelayTimeInSamples)
+            targetDelayTimeInSamples_right *= 3.0f;
+        
+        targetDelayTimeInSamples_left -= loopDelay;
+        targetDelayTimeInSamples_right -= loopDelay;
+
+        // Smooth the delay times
+        const Precision delayTime_left = (Precision) mDelayTimeInSamples_left[i];
+        const Precision delayTime_right = (Precision) mDelayTimeInSamples_right[i];
+        Precision delayTimeEnd_left = targetDelayTimeInSamples_left + (delayTime_left - targetDelayTimeInSamples_left) * blockDecay;
+        Precision delayTimeEnd_right = targetDelayTimeInSamples_right + (delayTime_right - targetDelayTimeInSamples_right) * blockDecay;
+        mDelayTimeIncrement_left[i] = (delayTimeEnd_left - delayTime_left) * rampScale;
+        mDelayTimeIncrement_right[i] = (delayTimeEnd_right - delayTime_right) * rampScale;
+        
+        targetDelay_left[i] = (float) targetDelayTimeInSamples_left;
+        targetDelay_right[i] = (float) (targetDelayTimeInSamples_right + stereoOffset);
+    }
 }
 
-//==============================================================================
-void DelaytutorialAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+void DelaytutorialAudioProcessor::advanceDelayTimes(int line)
 {
-    std::unique_ptr<juce::XmlElement> xml(new juce::XmlElement("delay"));
+    if (mLongDelayMode) {
+        mDelayTimeInSamples_left[line] += mDelayTimeIncrement_left[line];
+        mDelayTimeInSamples_right[line] += mDelayTimeIncrement_right[line];
+    } else {
+        mDelayTimeInSamples_left[line] = (float) mDelayTimeInSamples_left[line] + (float) mDelayTimeIncrement_left[line];
+        mDelayTimeInSamples_right[line] = (float) mDelayTimeInSamples_right[line] + (float) mDelayTimeIncrement_right[line];
+    }
+}
+
+template <typename Precision>
+void DelaytutorialAudioProcessor::getReadHeads(int i, double& readHeadLeft, double& readHeadRight) const
+{
+    const Precision delayTime_left = (Precision) mDelayTimeInSamples_left[i];
+    const Precision delayTime_right = (Precision) mDelayTimeInSamples_right[i];
     
-    xml->setAttribute("Dry/Wet", *mDryWetParameter);
-    xml->setAttribute("Feedback", *mFeedbackParameter);
-    xml->setAttribute("Delay time", *mDelayTimeParameter);
-    xml->setAttribute("LFO rate", *mLfoRateParameter);
-    xml->setAttribute("LFO depth", *mLfoDepthParameter);
-    xml->setAttribute("LFO phase", *mLfoPhaseParameter);
+    Precision mDelayReadHead_left = mCircularBufferWriteHead - delayTime_left;
+    Precision mDelayReadHead_right = mCircularBufferWriteHead - delayTime_right - mStereoOffsetSmooth;
+
+    // Pitch shifting logic
+    if (i % 2 == 1) {  // Odd numbered delay lines (second, fourth, etc.)
+        if (i % 4 == 1) {  // Second, sixth, tenth, etc. delay lines
+            mDelayReadHead_left *= 2.0f;  // Octave up
+            mDelayReadHead_right *= 2.0f;
+        } else {  // Fourth, eighth, twelfth, etc. delay lines
+            mDelayReadHead_left *= 0.5f;  // Octave down
+            mDelayReadHead_right *= 0.5f;
+        }
+    }
+
+    // Ensure we never go below -1 octave
+    float minReadSpeed = 0.25f;  // -1 octave
+    Precision maxDelayTime_left = mCircularBufferWriteHead - mDelayReadHead_left;
+    Precision maxDelayTime_right = mCircularBufferWriteHead - mDelayReadHead_right;
+
+    if (maxDelayTime_left > delayTime_left / minReadSpeed) {
+        mDelayReadHead_left = mCircularBufferWriteHead - (delayTime_left / minReadSpeed);
+    }
+    if (maxDelayTime_right > delayTime_right / minReadSpeed) {
+        mDelayReadHead_right = mCircularBufferWriteHead - (delayTime_right / minReadSpeed);
+    }
+
+    // Ensure read heads are within buffer bounds
+    mDelayReadHead_left = std::fmod(mDelayReadHead_left, static_cast<Precision>(mCircularBufferLength));
+    mDelayReadHead_right = std::fmod(mDelayReadHead_right, static_cast<Precision>(mCircularBufferLength));
+    if (mDelayReadHead_left < 0) mDelayReadHead_left += mCircularBufferLength;
+    if (mDelayReadHead_right < 0) mDelayReadHead_right += mCircularBufferLength;
     
-    copyXmlToBinary(*xml, destData);
+    readHeadLeft = mDelayReadHead_left;
+    readHeadRight = mDelayReadHead_right;
 }
 
-void DelaytutorialAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+void DelaytutorialAudioProcessor::updateControlValues()
 {
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    float lfoPhaseOffset = *mLfoPhaseParameter;
+    float stereoOffsetInMs = lfoPhaseOffset * 50.0f;
+    float stereoOffset = stereoOffsetInMs * 0.001f * mEngineSampleRate;
+    float lfoDepth = *mLfoDepthParameter;
+
+    // Where each read head is heading, stereo offset included
+    float targetDelay_left[NUM_DELAY_LINES];
+    float targetDelay_right[NUM_DELAY_LINES];
+    bool modulated = lfoDepth > 0.0f || std::abs(mStereoOffsetSmooth - stereoOffset) > 0.5f;
     
-    if (xml.get() != nullptr && xml->hasTagName("delay")) {
-        *mDryWetParameter = xml->getDoubleAttribute("Dry/wet");
-        *mFeedbackParameter = xml->getDoubleAttribute("Feedback");
-        *mDelayTimeParameter = xml->getDoubleAttribute("Delay time");
-        *mLfoRateParameter = xml->getDoubleAttribute("LFO rate");
-        *mLfoDepthParameter = xml->getDoubleAttribute("LFO depth");
-        *mLfoPhaseParameter = xml->getDoubleAttribute("LFO phase");
+    // Each smoothed value moves towards its target for one control block and the
+    // audio loop ramps linearly to where the per-sample smoother would have ended up
+    const float blockDecay = mControlSmoothCoeff;
+    const float rampScale = 1.0f / CONTROL_BLOCK_SIZE;
+    
+    // Smooth the stereo offset
+    float stereoOffsetEnd = stereoOffset + (mStereoOffsetSmooth - stereoOffset) * blockDecay;
+    mStereoOffsetIncrement = (stereoOffsetEnd - mStereoOffsetSmooth) * rampScale;
+    
+    if (mLongDelayMode)
+        updateDelayTimes<double>(lfoPhaseOffset, lfoDepth, stereoOffset, targetDelay_left, targetDelay_right);
+    else
+        updateDelayTimes<float>(lfoPhaseOffset, lfoDepth, stereoOffset, targetDelay_left, targetDelay_right);
+    
+    updateStaticDelays(targetDelay_left, targetDelay_right, modulated);
+    
+    // Tremolo, ramped from this block's phase to the next one's
+    const float tremRate = 2.0f; // 2 Hz
+    mTremLfo = 0.5f + 0.5f * sinf(2.0f * M_PI * mTremPhase);
+    mTremPhase += tremRate * CONTROL_BLOCK_SIZE / mEngineSampleRate;
+    if (mTremPhase >= 1.0f) mTremPhase -= 1.0f;
+    float tremLfoEnd = 0.5f + 0.5f * sinf(2.0f * M_PI * mTremPhase);
+    mTremLfoIncrement = (tremLfoEnd - mTremLfo) * rampScale;
+
+    // Update the main LFO phase
+    mLfoPhase += *mLfoRateParameter * CONTROL_BLOCK_SIZE / mEngineSampleRate;
+    mLfoPhase = std::fmod(mLfoPhase, 1.0f);
+}
+
+void DelaytutorialAudioProcessor::updateStaticDelays(const float* targetDelay_left, const float* targetDelay_right, bool modulated)
+{
+    // The smoothers only ever approach their targets, so settling is judged
+    // loosely and the remainder crossfaded away
+    const float settledTolerance = 0.5f;  // in samples
+    
+    // A block read must not reach samples this control block hasn't written yet, cubic reads included
+    for (int i = 0; i < NUM_DELAY_LINES; ++i) {
+        if (isStaticLine(i) && std::min(targetDelay_left[i], targetDelay_right[i]) < CONTROL_BLOCK_SIZE + 3)
+            modulated = true;
+    }
+    
+    // Tier crossfades run sample by sample, so the block reads sit them out
+    if (mTierFadeSamplesRemaining > 0)
+        modulated = true;
+    
+    if (mStaticDelayActive && mStaticFadeSamplesRemaining == 0) {
+        if (modulated) {
+            // The smoothed delays kept tracking the targets, but may be offset from where this path reads,
+            // so the modulated path fades in over the same length as a static delay change
+            mStaticDelayActive = false;
+            mStaticExitSamplesRemaining = STATIC_CROSSFADE_LENGTH;
+        } else {
+            bool moved = false;
+            for (int i = 0; i < NUM_DELAY_LINES; ++i) {
+                if (isStaticLine(i) && (targetDelay_left[i] != mStaticDelay_left[i] || targetDelay_right[i] != mStaticDelay_right[i]))
+                    moved = true;
+            }
+            
+            if (moved) {
+                for (int i = 0; i < NUM_DELAY_LINES; ++i) {
+                    mStaticFadeFrom_left[i] = mStaticDelay_left[i];
+                    mStaticFadeFrom_right[i] = mStaticDelay_right[i];
+                    mStaticDelay_left[i] = targetDelay_left[i];
+                    mStaticDelay_right[i] = targetDelay_right[i];
+                }
+                mStaticFadeSamplesRemaining = STATIC_CROSSFADE_LENGTH;
+            }
+        }
+    } else if (! mStaticDelayActive && mStaticExitSamplesRemaining == 0 && ! modulated) {
+        bool settled = true;
+        for (int i = 0; i < NUM_DELAY_LINES; ++i) {
+            float currentDelay_right = (float) mDelayTimeInSamples_right[i] + mStereoOffsetSmooth;
+            if (isStaticLine(i) && (std::abs((float) mDelayTimeInSamples_left[i] - targetDelay_left[i]) > settledTolerance
+                                    || std::abs(currentDelay_right - targetDelay_right[i]) > settledTolerance))
+                settled = false;
+        }
+        
+        if (settled) {
+            for (int i = 0; i < NUM_DELAY_LINES; ++i) {
+                mStaticFadeFrom_left[i] = (float) mDelayTimeInSamples_left[i];
+                mStaticFadeFrom_right[i] = (float) mDelayTimeInSamples_right[i] + mStereoOffsetSmooth;
+                mStaticDelay_left[i] = targetDelay_left[i];
+                mStaticDelay_right[i] = targetDelay_right[i];
+            }
+            mStaticFadeSamplesRemaining = STATIC_CROSSFADE_LENGTH;
+            mStaticDelayActive = true;
+        }
+    }
+    
+    mStaticExitFading = mStaticExitSamplesRemaining > 0;
+    
+    if (mStaticDelayActive || mStaticExitFading)
+        renderStaticBlock();
+}
+
+void DelaytutorialAudioProcessor::renderStaticBlock()
+{
+    // Gain of the new read head for each sample of this block while a crossfade runs
+    const bool fading = mStaticFadeSamplesRemaining > 0;
+    float fadeIn[CONTROL_BLOCK_SIZE];
+    
+    if (fading) {
+        const int fadePosition = STATIC_CROSSFADE_LENGTH - mStaticFadeSamplesRemaining;
+        for (int k = 0; k < CONTROL_BLOCK_SIZE; ++k)
+            fadeIn[k] = std::min(1.0f, (float) (fadePosition + k + 1) / STATIC_CROSSFADE_LENGTH);
+        mStaticFadeSamplesRemaining = std::max(0, mStaticFadeSamplesRemaining - CONTROL_BLOCK_SIZE);
+    }
+    
+    // Leaving, the gain of the old block read, the reverse of the ramp above
+    if (mStaticExitFading) {
+        const int fadePosition = STATIC_CROSSFADE_LENGTH - mStaticExitSamplesRemaining;
+        for (int k = 0; k < CONTROL_BLOCK_SIZE; ++k)
+            mStaticExitGain[k] = std::max(0.0f, 1.0f - (float) (fadePosition + k + 1) / STATIC_CROSSFADE_LENGTH);
+        mStaticExitSamplesRemaining = std::max(0, mStaticExitSamplesRemaining - CONTROL_BLOCK_SIZE);
+    }
+    
+    // A tier change that ends the path keeps reading in the tier it left, and every line
+    // that either tier plays, until the exit has faded out
+    const QualitySettings& tier = getQualitySettings(mStaticExitFading && mTierFadeSamplesRemaining > 0 ? mFadeFromTier : mActiveTier.load());
+    const int numLines = mStaticExitFading ? NUM_DELAY_LINES : tier.numDelayLines;
+    
+    for (int i = 0; i < numLines; ++i)
+    {
+        if (! isStaticLine(i))
+            continue;
+        
+        readStaticHead(mCircularBufferLeft, mStaticDelay_left[i], mStaticLineOutputLeft[i], tier.interpolationOrder);
+        readStaticHead(mCircularBufferRight, mStaticDelay_right[i], mStaticLineOutputRight[i], tier.interpolationOrder);
+        
+        if (fading) {
+            float oldLeft[CONTROL_BLOCK_SIZE], oldRight[CONTROL_BLOCK_SIZE];
+            readStaticHead(mCircularBufferLeft, mStaticFadeFrom_left[i], oldLeft, tier.interpolationOrder);
+            readStaticHead(mCircularBufferRight, mStaticFadeFrom_right[i], oldRight, tier.interpolationOrder);
+            
+            mKernels->crossfade(oldLeft, mStaticLineOutputLeft[i], fadeIn, mStaticLineOutputLeft[i], CONTROL_BLOCK_SIZE);
+            mKernels->crossfade(oldRight, mStaticLineOutputRight[i], fadeIn, mStaticLineOutputRight[i], CONTROL_BLOCK_SIZE);
+        }
+    }
+}
+
+void DelaytutorialAudioProcessor::readStaticHead(const DelayLineStorage& buffer, float delayInSamples, float* out, int interpolationOrder) const
+{
+    // Sample k of the block sits between positions writeHead + k - intDelay - 1 and the one after it
+    const int intDelay = static_cast<int>(delayInSamples);
+    const float fraction = delayInSamples - intDelay;
+    
+    if (interpolationOrder == 3) {
+        // One more sample on either side
+        float segment[CONTROL_BLOCK_SIZE + 3];
+        buffer.readContiguous(mCircularBufferWriteHead - intDelay - 2, segment, CONTROL_BLOCK_SIZE + 3);
+        DelayKernels::hermiteFixedPhase(segment, 1.0f - fraction, out, CONTROL_BLOCK_SIZE);
+        return;
+    }
+    
+    float segment[CONTROL_BLOCK_SIZE + 1];
+    buffer.readContiguous(mCircularBufferWriteHead - intDelay - 1, segment, CONTROL_BLOCK_SIZE + 1);
+    mKernels->interpolateFixedPhase(segment, 1.0f - fraction, out, CONTROL_BLOCK_SIZE);
+}
+
+void DelaytutorialAudioProcessor::setQualityTier(QualityTier tier)
+{
+    *mQualityTierParameter = (int) tier;
+}
+
+void DelaytutorialAudioProcessor::updateQualityTier()
+{
+    // A running crossfade finishes before anything else changes
+    if (mTierFadeSamplesRemaining > 0)
+        return;
+    
+    mFadeFromTier = mActiveTier;
+    
+    const QualityTier current = mActiveTier;
+    
+    // Offline there's no budget to keep to, and what changes here adds no latency
+    const bool maximumQuality = isMaximumQualityRender();
+    const QualityTier ceiling = maximumQuality ? QualityTier::high : getQualityTier();
+    const QualityTier next = mQualityGovernor.chooseTier(current, ceiling, isAutomaticQuality() && ! maximumQuality);
+    
+    if (next == current)
+        return;
+    
+    // An oversampler coming back in starts from silence rather than a stale state.
+    // Lines coming back in need nothing: their lanes have been diffusing zeros
+    if (getQualitySettings(next).oversampling > 1 && getQualitySettings(current).oversampling == 1) {
+        mOutputOversamplerLeft.reset();
+        mOutputOversamplerRight.reset();
+    }
+    
+    mActiveTier = next;
+    mTierFadeSamplesRemaining = TIER_CROSSFADE_LENGTH;
+}
+
+float DelaytutorialAudioProcessor::getLineGain(int line, const QualitySettings& tier, const QualitySettings& fadeFromTier, float tierFade)
+{
+    const bool inTier = line < tier.numDelayLines;
+    const bool inFadeFromTier = line < fadeFromTier.numDelayLines;
+    
+    if (inTier == inFadeFromTier)
+        return inTier ? 1.0f : 0.0f;
+    
+    return inTier ? tierFade : 1.0f - tierFade;
+}
+
+float DelaytutorialAudioProcessor::readModulatedLine(const DelayLineStorage& buffer, double readHead, const QualitySettings& tier,
+                                                     const QualitySettings& fadeFromTier, float tierFade)
+{
+    auto read = [&buffer, readHead] (int order) {
+        return order == 3 ? buffer.readCubic(readHead) : buffer.readInterpolated(readHead);
+    };
+    
+    const float sample = read(tier.interpolationOrder);
+    
+    if (tierFade == 1.0f || fadeFromTier.interpolationOrder == tier.interpolationOrder)
+        return sample;
+    
+    const float fadeFromSample = read(fadeFromTier.interpolationOrder);
+    return fadeFromSample + tierFade * (sample - fadeFromSample);
+}
+
+float DelaytutorialAudioProcessor::saturateOutput(float sample, HalfbandOversampler& oversampler, const QualitySettings& tier,
+                                                  const QualitySettings& fadeFromTier, float tierFade)
+{
+    const bool oversampled = tier.oversampling > 1;
+    const bool fadeFromOversampled = tierFade < 1.0f && fadeFromTier.oversampling > 1;
+    
+    if (! oversampled && ! fadeFromOversampled)
+        return std::tanh(sample);
+    
+    // Runs whenever either tier wants it, so its state is current when it fades in
+    const float oversampledSample = oversampler.process(sample, [] (float x) { return std::tanh(x); });
+    
+    if (tierFade == 1.0f || oversampled == fadeFromOversampled)
+        return oversampledSample;
+    
+    const float plainSample = std::tanh(sample);
+    return oversampled ? plainSample + tierFade * (oversampledSample - plainSample)
+                       : oversampledSample + tierFade * (plainSample - oversampledSample);
+}
+
+
+//==============================================================================
+bool DelaytutorialAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* DelaytutorialAudioProcessor::createEditor()
+{
+    return new DelaytutorialAudioProcessorEditor (*this);
+}
+
+void DelaytutorialAudioProcessor::setDelayStorageFormat(DelayLineStorage::Format format)
+{
+    if (format == mDelayStorageFormat)
+        return;
+    
+    ScopedStructuralChange change(*this);
+    mDelayStorageFormat = format;
+    reallocateDelayMemory();
+}
+
+void DelaytutorialAudioProcessor::setInterleavedDelayBuffers(bool enabled)
+{
+    if (enabled == mInterleavedBuffers)
+        return;
+    
+    ScopedStructuralChange change(*this);
+    mInterleavedBuffers = enabled;
+    reallocateDelayMemory();
+}
+
+void DelaytutorialAudioProcessor::setLongDelayMode(bool enabled, double maxDelaySeconds)
+{
+    maxDelaySeconds = std::max(maxDelaySeconds, (double) MAX_DELAY_TIME);
+    
+    if (enabled == mLongDelayMode && maxDelaySeconds == mLongDelayMaxSeconds)
+        return;
+    
+    ScopedStructuralChange change(*this);
+    mLongDelayMode = enabled;
+    mLongDelayMaxSeconds = maxDelaySeconds;
+    reallocateDelayMemory();
+}
+
+double DelaytutorialAudioProcessor::getMaxDelaySeconds() const
+{
+    return MAX_DELAY_TIME * mDelayTimeScale;
+}
+
+double DelaytutorialAudioProcessor::getDelaySeconds(float parameterValue) const
+{
+    // parameter * scale ^ (parameter / MAX_DELAY_TIME): the top of the range reaches the
+    // longest delay and the bottom stays where it is, where a linear stretch by the scale
+    // would leave nothing shorter than 1.5 s of a 300 s range. Without long-delay mode
+    // the scale is 1 and this is the parameter
+    if (mDelayTimeScale == 1.0f)
+        return parameterValue;
+    
+    return parameterValue * std::pow((double) mDelayTimeScale, (double) parameterValue / MAX_DELAY_TIME);
+}
+
+void DelaytutorialAudioProcessor::setOnDemandMemory(bool enabled)
+{
+    if (enabled == mOnDemandMemory)
+        return;
+    
+    ScopedStructuralChange change(*this);
+    mOnDemandMemory = enabled;
+    reallocateDelayMemory();
+}
+
+void DelaytutorialAudioProcessor::setDelayEngine(DelayEngine engine)
+{
+    *mDelayEngineParameter = (int) engine;
+    updateStructuralParameters();
+}
+
+void DelaytutorialAudioProcessor::setSpectralFftOrder(int order)
+{
+    order = juce::jlimit(SpectralDelay::MIN_FFT_ORDER, SpectralDelay::MAX_FFT_ORDER, order);
+    *mSpectralFftSizeParameter = order - SpectralDelay::MIN_FFT_ORDER;
+    updateStructuralParameters();
+}
+
+void DelaytutorialAudioProcessor::updateStructuralParameters()
+{
+    const DelayEngine engine = (DelayEngine) mDelayEngineParameter->getIndex();
+    const int order = SpectralDelay::MIN_FFT_ORDER + mSpectralFftSizeParameter->getIndex();
+    const bool limiter = *mOutputLimiterParameter;
+    
+    if (engine == mDelayEngine && order == mSpectralFftOrder && limiter == mOutputLimiterEnabled)
+        return;
+    
+    // The FFT size only matters to a running spectral engine. The limiter changes the
+    // latency, which only prepareToPlay reports
+    const bool prepare = engine != mDelayEngine || engine == DelayEngine::spectral || limiter != mOutputLimiterEnabled;
+    
+    // The audio thread reads these without a lock, so once it runs they only change in
+    // prepareToPlay, which takes them from the parameters with processing suspended
+    if (prepare && mCircularBufferLength > 0) {
+        reallocateDelayMemory();
+        return;
+    }
+    
+    mDelayEngine = engine;
+    mSpectralFftOrder = order;
+    mOutputLimiterEnabled = limiter;
+}
+
+void DelaytutorialAudioProcessor::timerCallback()
+{
+    updateStructuralParameters();
+}
+
+void DelaytutorialAudioProcessor::setOutputLimiter(bool enabled)
+{
+    *mOutputLimiterParameter = enabled;
+    updateStructuralParameters();
+}
+
+void DelaytutorialAudioProcessor::setTap(int index, const MultiTapDelay::Tap& tap)
+{
+    if (index >= NUM_TAP_PARAMETERS) {
+        mMultiTap.setTap(index, tap);
+        return;
+    }
+    
+    *mTapTimeParameters[index] = tap.delaySeconds;
+    *mTapGainParameters[index] = tap.gain;
+    *mTapPanParameters[index] = tap.pan;
+    *mTapHighCutParameters[index] = tap.highCut;
+    
+    // What the parameters kept, so the next block finds nothing to update
+    mMultiTap.setTap(index, getTapParameters(index));
+}
+
+MultiTapDelay::Tap DelaytutorialAudioProcessor::getTap(int index) const
+{
+    return index < NUM_TAP_PARAMETERS ? getTapParameters(index) : mMultiTap.getTap(index);
+}
+
+MultiTapDelay::Tap DelaytutorialAudioProcessor::getTapParameters(int index) const
+{
+    MultiTapDelay::Tap tap;
+    tap.delaySeconds = *mTapTimeParameters[index];
+    tap.gain = *mTapGainParameters[index];
+    tap.pan = *mTapPanParameters[index];
+    tap.highCut = *mTapHighCutParameters[index];
+    return tap;
+}
+
+void DelaytutorialAudioProcessor::updateTapParameters()
+{
+    // Every setTap has the taps recompute all their targets, so only taps that moved are set
+    for (int index = 0; index < NUM_TAP_PARAMETERS; ++index) {
+        const MultiTapDelay::Tap tap = getTapParameters(index);
+        const MultiTapDelay::Tap current = mMultiTap.getTap(index);
+        
+        if (tap.delaySeconds != current.delaySeconds || tap.gain != current.gain
+            || tap.pan != current.pan || tap.highCut != current.highCut)
+            mMultiTap.setTap(index, tap);
+    }
+}
+
+void DelaytutorialAudioProcessor::setGranularSettings(const GranularCloud::Settings& settings)
+{
+    *mGrainDensityParameter = settings.density;
+    *mGrainSizeParameter = settings.grainSeconds;
+    *mGrainSpreadParameter = settings.positionSpread;
+    *mGrainPitchSpreadParameter = settings.pitchSpread;
+    *mGrainWindowParameter = (int) settings.window;
+    
+    mGranularCloud.setSettings(getGranularSettings());
+}
+
+GranularCloud::Settings DelaytutorialAudioProcessor::getGranularSettings() const
+{
+    GranularCloud::Settings settings;
+    settings.density = *mGrainDensityParameter;
+    settings.grainSeconds = *mGrainSizeParameter;
+    settings.positionSpread = *mGrainSpreadParameter;
+    settings.pitchSpread = *mGrainPitchSpreadParameter;
+    settings.window = (GranularCloud::Window) mGrainWindowParameter->getIndex();
+    return settings;
+}
+
+void DelaytutorialAudioProcessor::setFixedInternalRate(bool enabled)
+{
+    if (enabled == mFixedInternalRate)
+        return;
+    
+    ScopedStructuralChange change(*this);
+    mFixedInternalRate = enabled;
+    reallocateDelayMemory();
+}
+
+size_t DelaytutorialAudioProcessor::getDelayMemoryBytes() const
+{
+    if (! hasDelayMemory())
+        return 0;
+    
+    return mCircularBufferLeft.getSizeInBytes() + (mInterleavedBuffers ? 0 : mCircularBufferRight.getSizeInBytes());
+}
+
+bool DelaytutorialAudioProcessor::updateOnDemandMemory(const juce::AudioBuffer<float>& buffer)
+{
+    DELAY_TRACE_ZONE("on-demand memory");
+    
+    if (mPoolSlot != nullptr)
+        return true;
+    
+    // Stay idle until there's something to delay
+    if (buffer.getMagnitude(0, buffer.getNumSamples()) < SILENCE_THRESHOLD)
+        return false;
+    
+    // If the pool is busy or empty, try again next block
+    mPoolSlot = mMemoryPool->tryAcquire(mPoolSlotBytes, mPoolSlotPinned, mWaitingForMemory);
+    if (mPoolSlot == nullptr)
+        return false;
+    
+    attachDelayBuffers(mPoolSlot);
+    
+    // Pool slots come zeroed, so only the engine state starts over
+    resetEngineState();
+    return true;
+}
+
+void DelaytutorialAudioProcessor::attachDelayBuffers(void* memory)
+{
+    // The slot holds both channels either way, as two halves or as stereo frames
+    if (mInterleavedBuffers) {
+        mCircularBufferLeft.attach(memory, mCircularBufferLength, mDelayStorageFormat, 2, 0);
+        mCircularBufferRight.attach(memory, mCircularBufferLength, mDelayStorageFormat, 2, 1);
+    } else {
+        char* slot = static_cast<char*>(memory);
+        mCircularBufferLeft.attach(slot, mCircularBufferLength, mDelayStorageFormat);
+        mCircularBufferRight.attach(slot + mPoolSlotBytes / 2, mCircularBufferLength, mDelayStorageFormat);
+    }
+}
+
+void DelaytutorialAudioProcessor::releaseDecayedMemory(float blockPeak, int numSamples)
+{
+    // After a whole buffer length of near-silent writes every read is near-silent too
+    mSilentSamples = blockPeak < SILENCE_THRESHOLD ? mSilentSamples + numSamples : 0;
+    
+    if (mSilentSamples >= mCircularBufferLength && mMemoryPool->tryRelease(mPoolSlot, mPoolSlotBytes, mPoolSlotPinned)) {
+        mCircularBufferLeft.detach();
+        mCircularBufferRight.detach();
+        mPoolSlot = nullptr;
+        mSilentSamples = 0;
+        ++mEngineResets;
+    }
+}
+
+void DelaytutorialAudioProcessor::returnPoolSlot()
+{
+    if (mPoolSlot != nullptr) {
+        mCircularBufferLeft.detach();
+        mCircularBufferRight.detach();
+        mMemoryPool->release(mPoolSlot, mPoolSlotBytes, mPoolSlotPinned);
+        mPoolSlot = nullptr;
+    }
+    
+    mMemoryPool->stopWaiting(mPoolSlotBytes, mPoolSlotPinned, mWaitingForMemory);
+}
+
+template <typename Visitor>
+void DelaytutorialAudioProcessor::visitEngineState(Visitor& visit)
+{
+    auto visitValue = [&visit] (auto& value) { visit(&value, sizeof(value)); };
+    
+    mCircularBufferLeft.visitState(visit);
+    mCircularBufferRight.visitState(visit);
+    mDampingFilters.visitState(visit);
+    mDiffusion.visitState(visit);
+    mOutputOversamplerLeft.visitState(visit);
+    mOutputOversamplerRight.visitState(visit);
+    mSpectralDelay.visitState(visit);
+    mMultiTap.visitState(visit);
+    mGranularCloud.visitState(visit);
+    
+    visitValue(mCircularBufferWriteHead);
+    visitValue(mDelayReadHead_left);
+    visitValue(mDelayReadHead_right);
+    visitValue(mDelayTimeInSamples_left);
+    visitValue(mDelayTimeInSamples_right);
+    visitValue(mDelayTimeIncrement_left);
+    visitValue(mDelayTimeIncrement_right);
+    visitValue(mFeedbackLeft);
+    visitValue(mFeedbackRight);
+    visitValue(mFilterStatesLeft);
+    visitValue(mFilterStatesRight);
+    
+    visitValue(mLfoPhase);
+    visitValue(mDelayTimeSmooth);
+    visitValue(mLfoDepthSmooth);
+    visitValue(mStereoOffsetSmooth);
+    visitValue(mStereoOffsetIncrement);
+    visitValue(mDelayFraction);
+    visitValue(mControlSamplesRemaining);
+    visitValue(mTremLfo);
+    visitValue(mTremLfoIncrement);
+    visitValue(mTremPhase);
+    
+    visitValue(mStaticDelayActive);
+    visitValue(mStaticFadeSamplesRemaining);
+    visitValue(mStaticExitSamplesRemaining);
+    visitValue(mStaticExitFading);
+    visitValue(mStaticExitGain);
+    visitValue(mStaticDelay_left);
+    visitValue(mStaticDelay_right);
+    visitValue(mStaticFadeFrom_left);
+    visitValue(mStaticFadeFrom_right);
+    visitValue(mStaticLineOutputLeft);
+    visitValue(mStaticLineOutputRight);
+    
+    visitValue(mLastInputLeft);
+    visitValue(mLastInputRight);
+    visitValue(mLastOutputLeft);
+    visitValue(mLastOutputRight);
+    visitValue(mDcBlockerStateLeft);
+    visitValue(mDcBlockerStateRight);
+    visitValue(mDensityFactor);
+    visitValue(mSilentSamples);
+    visitValue(mMultiTapRunning);
+    visitValue(mGranularRunning);
+}
+
+EngineSnapshot::Layout DelaytutorialAudioProcessor::getSnapshotLayout() const
+{
+    EngineSnapshot::Layout layout;
+    layout.sampleRate = mEngineSampleRate;
+    layout.engine = (int) mDelayEngine;
+    layout.bufferLength = mCircularBufferLength;
+    layout.storageFormat = (int) mDelayStorageFormat;
+    layout.interleaved = mInterleavedBuffers;
+    layout.fftOrder = mDelayEngine == DelayEngine::spectral ? mSpectralFftOrder : 0;
+    return layout;
+}
+
+void DelaytutorialAudioProcessor::appendEngineSnapshot(juce::MemoryBlock& destData)
+{
+    DELAY_TRACE_ZONE("save snapshot");
+    auto visitState = [this] (auto& visit) { visitEngineState(visit); };
+    
+    EngineSnapshot snapshot;
+    snapshot.prepare(getSnapshotLayout(), EngineSnapshot::measure(visitState));
+    
+    // The whole copy runs alongside the audio callback, and holding it off only the state
+    // and the stretch of delay memory it wrote meanwhile are copied again. Compression runs
+    // after that. A reset or an on-demand slot coming or going in between makes the
+    // positions or the sizes disagree, and then there's simply no snapshot this time
+    WritePositions from;
+    {
+        const juce::ScopedLock lock(getCallbackLock());
+        from = getWritePositions();
+    }
+    
+    bool captured = snapshot.capture(visitState);
+    
+    if (captured) {
+        const juce::ScopedLock lock(getCallbackLock());
+        captured = canCopyWrittenSince(from) && snapshot.capture(visitState, [this, &from] (const void* data, void* destination, size_t numBytes) {
+            copyWrittenSection(from, data, data, destination, numBytes);
+        });
+    }
+    
+    if (captured)
+        snapshot.encode(destData);
+}
+
+bool DelaytutorialAudioProcessor::applySnapshot(const EngineSnapshot& snapshot)
+{
+    if (! snapshot.restore(getSnapshotLayout(), [this] (auto& visit) { visitEngineState(visit); }))
+        return false;
+    
+    // Damaged or hand-made data: back to the cleared state rather than index with it
+    if (! isEngineStateValid()) {
+        reset();
+        return false;
+    }
+    
+    rebuildOverview();
+    return true;
+}
+
+bool DelaytutorialAudioProcessor::isEngineStateValid() const
+{
+    // The sections are raw bytes, so a bool may hold anything
+    auto isBool = [] (const bool& value) {
+        unsigned char byte;
+        std::memcpy(&byte, &value, 1);
+        return byte <= 1;
+    };
+    
+    if (! isBool(mStaticDelayActive) || ! isBool(mStaticExitFading) || ! isBool(mMultiTapRunning) || ! isBool(mGranularRunning))
+        return false;
+    
+    const bool headsInRange = mCircularBufferWriteHead >= 0 && mCircularBufferWriteHead < std::max(mCircularBufferLength, 1)
+        && mControlSamplesRemaining >= 0 && mControlSamplesRemaining <= CONTROL_BLOCK_SIZE
+        && mStaticFadeSamplesRemaining >= 0 && mStaticFadeSamplesRemaining <= STATIC_CROSSFADE_LENGTH
+        && mStaticExitSamplesRemaining >= 0 && mStaticExitSamplesRemaining <= STATIC_CROSSFADE_LENGTH
+        && mSilentSamples >= 0;
+    
+    return headsInRange && mDiffusion.isStateValid() && mSpectralDelay.isStateValid()
+        && mMultiTap.isStateValid() && mGranularCloud.isStateValid(mCircularBufferLength);
+}
+
+bool DelaytutorialAudioProcessor::applySnapshotWhilePlaying(const EngineSnapshot& snapshot)
+{
+    DELAY_TRACE_ZONE("load snapshot");
+    auto visitState = [this] (auto& visit) { visitEngineState(visit); };
+    
+    // The other way round: the rings are copied back while the audio callback keeps
+    // reading and writing them, then with it held off the rest of the state and the
+    // stretch it overwrote meanwhile. Should the engine have been reset in between,
+    // the whole copy is made again under the lock
+    WritePositions from;
+    EngineSnapshot::Layout layout;
+    {
+        const juce::ScopedLock lock(getCallbackLock());
+        from = getWritePositions();
+        layout = getSnapshotLayout();
+    }
+    
+    bool restored = snapshot.restore(layout, visitState, [this] (void* data, const void* source, size_t numBytes) {
+        if (isRingSection(data))
+            std::memcpy(data, source, numBytes);
+    });
+    
+    if (restored) {
+        const juce::ScopedLock lock(getCallbackLock());
+        
+        if (canCopyWrittenSince(from))
+            restored = snapshot.restore(getSnapshotLayout(), visitState, [this, &from] (void* data, const void* source, size_t numBytes) {
+                copyWrittenSection(from, data, source, data, numBytes);
+            });
+        else
+            restored = snapshot.restore(getSnapshotLayout(), visitState);
+        
+        // The rings may already hold part of it, so a refused one still clears them
+        if (! restored || ! isEngineStateValid()) {
+            reset();
+            restored = false;
+        }
+    }
+    
+    if (restored)
+        rebuildOverview();
+    
+    return restored;
+}
+
+void DelaytutorialAudioProcessor::rebuildOverview()
+{
+    // The overview is only ever written along with the buffers, so rebuild it from them
+    if (mCircularBufferLeft.hasMemory()) {
+        for (int i = 0; i < mCircularBufferLength; ++i) {
+            mOverviewLeft.write(i, mCircularBufferLeft.read(i));
+            mOverviewRight.write(i, mCircularBufferRight.read(i));
+        }
+    }
+}
+
+DelaytutorialAudioProcessor::WritePositions DelaytutorialAudioProcessor::getWritePositions() const
+{
+    return { mSamplesWritten, mEngineResets, mCircularBufferWriteHead, mSpectralDelay.getWriteFrame() };
+}
+
+bool DelaytutorialAudioProcessor::canCopyWrittenSince(const WritePositions& from) const
+{
+    // Within half a lap of either ring the write positions can't have come round past where they were
+    int lapSamples = mCircularBufferLength;
+    if (mSpectralDelay.getHistoryData() != nullptr)
+        lapSamples = std::min(lapSamples, mSpectralDelay.getNumFrames() * mSpectralDelay.getHopSize());
+    
+    return mEngineResets == from.engineResets && mSamplesWritten - from.samplesWritten < lapSamples / 2;
+}
+
+bool DelaytutorialAudioProcessor::isRingSection(const void* section) const
+{
+    return section == mCircularBufferLeft.getData() || section == mCircularBufferRight.getData()
+        || section == mSpectralDelay.getHistoryData();
+}
+
+void DelaytutorialAudioProcessor::copyWrittenSection(const WritePositions& from, const void* section,
+                                                     const void* source, void* destination, size_t numBytes) const
+{
+    // Everything but the rings changes every block, so it is copied whole
+    if (! isRingSection(section)) {
+        std::memcpy(destination, source, numBytes);
+        return;
+    }
+    
+    // The delay memory has a frame per sample and the history a row per hop, written in turn
+    const bool history = section == mSpectralDelay.getHistoryData();
+    const int numFrames = history ? mSpectralDelay.getNumFrames() : mCircularBufferLength;
+    const int first = history ? from.spectralFrame : from.writeHead;
+    const int next = history ? mSpectralDelay.getWriteFrame() : mCircularBufferWriteHead;
+    const int numWritten = (next - first + numFrames) % numFrames;
+    const int beforeWrap = std::min(numWritten, numFrames - first);
+    const size_t frameBytes = numBytes / (size_t) numFrames;
+    
+    std::memcpy(static_cast<char*>(destination) + (size_t) first * frameBytes,
+                static_cast<const char*>(source) + (size_t) first * frameBytes, (size_t) beforeWrap * frameBytes);
+    std::memcpy(destination, source, (size_t) (numWritten - beforeWrap) * frameBytes);
+}
+
+bool DelaytutorialAudioProcessor::allocateDelayLines()
+{
+    if (mInterleavedBuffers) {
+        // The left channel owns the frames, the right one runs on them
+        mCircularBufferRight.releaseMemory();
+        
+        if (! mCircularBufferLeft.allocate(mCircularBufferLength, mDelayStorageFormat, mLongDelayMode, 2))
+            return false;
+        
+        mCircularBufferRight.attach(mCircularBufferLeft.getMemory().getData(), mCircularBufferLength, mDelayStorageFormat, 2, 1);
+        return true;
+    }
+    
+    if (mCircularBufferLeft.allocate(mCircularBufferLength, mDelayStorageFormat, mLongDelayMode)
+        && mCircularBufferRight.allocate(mCircularBufferLength, mDelayStorageFormat, mLongDelayMode))
+        return true;
+    
+    // Both channels or neither
+    mCircularBufferLeft.releaseMemory();
+    mCircularBufferRight.releaseMemory();
+    return false;
+}
+
+void DelaytutorialAudioProcessor::reallocateDelayMemory()
+{
+    // Already playing: prepare again with the audio callback held off
+    if (mCircularBufferLength > 0) {
+        ScopedStructuralChange change(*this);
+        mStructuralChangePrepares = true;
+    }
+}
+
+DelaytutorialAudioProcessor::ScopedStructuralChange::ScopedStructuralChange(DelaytutorialAudioProcessor& processor)
+    : mProcessor(processor)
+{
+    if (mProcessor.mStructuralChangeDepth++ == 0 && mProcessor.mCircularBufferLength > 0) {
+        mProcessor.suspendProcessing(true);
+        mProcessor.mStructuralChangeSuspended = true;
+    }
+}
+
+DelaytutorialAudioProcessor::ScopedStructuralChange::~ScopedStructuralChange()
+{
+    if (mProcessor.mStructuralChangeDepth > 1) {
+        --mProcessor.mStructuralChangeDepth;
+        return;
+    }
+    
+    // Still inside the scope, so whatever prepareToPlay sets on the way adds no prepare of its own
+    if (mProcessor.mStructuralChangePrepares)
+        mProcessor.prepareToPlay(mProcessor.getSampleRate(), mProcessor.getBlockSize());
+    
+    if (mProcessor.mStructuralChangeSuspended)
+        mProcessor.suspendProcessing(false);
+    
+    mProcessor.mStructuralChangeDepth = 0;
+    mProcessor.mStructuralChangePrepares = false;
+    mProcessor.mStructuralChangeSuspended = false;
+}
+
+//==============================================================================
+void DelaytutorialAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    std::unique_ptr<juce::XmlElement> xml(new juce::XmlElement("delay"));
+    
+    xml->setAttribute("Dry/Wet", *mDryWetParameter);
+    xml->setAttribute("Feedback", *mFeedbackParameter);
+    xml->setAttribute("Delay time", *mDelayTimeParameter);
+    xml->setAttribute("LFO rate", *mLfoRateParameter);
+    xml->setAttribute("LFO depth", *mLfoDepthParameter);
+    xml->setAttribute("LFO phase", *mLfoPhaseParameter);
+    xml->setAttribute("Low cut", *mLowCutParameter);
+    xml->setAttribute("High cut", *mHighCutParameter);
+    xml->setAttribute("Storage", (int) mDelayStorageFormat);
+    xml->setAttribute("Interleaved buffers", mInterleavedBuffers);
+    xml->setAttribute("Long delay", mLongDelayMode);
+    xml->setAttribute("Long delay max", mLongDelayMaxSeconds);
+    xml->setAttribute("On-demand memory", mOnDemandMemory);
+    xml->setAttribute("Quality", (int) getQualityTier());
+    xml->setAttribute("Automatic quality", isAutomaticQuality());
+    xml->setAttribute("Offline maximum quality", isOfflineMaximumQuality());
+    xml->setAttribute("Engine", mDelayEngineParameter->getIndex());
+    xml->setAttribute("Fixed internal rate", mFixedInternalRate);
+    xml->setAttribute("Output limiter", (bool) *mOutputLimiterParameter);
+    xml->setAttribute("Multi-tap", isMultiTap());
+    
+    const GranularCloud::Settings grains = getGranularSettings();
+    xml->setAttribute("Granular", isGranular());
+    xml->setAttribute("Grain density", grains.density);
+    xml->setAttribute("Grain size", grains.grainSeconds);
+    xml->setAttribute("Grain spread", grains.positionSpread);
+    xml->setAttribute("Grain pitch spread", grains.pitchSpread);
+    xml->setAttribute("Grain window", (int) grains.window);
+    xml->setAttribute("State snapshot", isStateSnapshot());
+    xml->setAttribute("Spectral FFT order", SpectralDelay::MIN_FFT_ORDER + mSpectralFftSizeParameter->getIndex());
+    xml->setAttribute("Spectral freeze", isSpectralFreeze());
+    
+    // Only shapes that differ from flat are worth storing
+    for (int band = 0; band < SpectralDelay::NUM_BANDS; ++band) {
+        float delayScale = mSpectralDelay.getBandDelayScale(band);
+        float feedbackScale = mSpectralDelay.getBandFeedbackScale(band);
+        
+        if (delayScale != 1.0f || feedbackScale != 1.0f) {
+            auto* bandXml = xml->createNewChildElement("Band");
+            bandXml->setAttribute("Index", band);
+            bandXml->setAttribute("Delay scale", delayScale);
+            bandXml->setAttribute("Feedback scale", feedbackScale);
+        }
+    }
+    
+    // Silent taps are left out the same way
+    for (int index = 0; index < MultiTapDelay::MAX_TAPS; ++index) {
+        const MultiTapDelay::Tap tap = getTap(index);
+        
+        if (tap.gain != 0.0f) {
+            auto* tapXml = xml->createNewChildElement("Tap");
+            tapXml->setAttribute("Index", index);
+            tapXml->setAttribute("Time", tap.delaySeconds);
+            tapXml->setAttribute("Gain", tap.gain);
+            tapXml->setAttribute("Pan", tap.pan);
+            tapXml->setAttribute("High cut", tap.highCut);
+        }
+    }
+    
+    copyXmlToBinary(*xml, destData);
+    
+    // After the XML, which getXmlFromBinary stops short of
+    if (mStateSnapshot && mCircularBufferLength > 0)
+        appendEngineSnapshot(destData);
+}
+
+void DelaytutorialAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    
+    if (xml.get() != nullptr && xml->hasTagName("delay")) {
+        // The setters only note what needs preparing, and the engine is prepared once for all of them
+        {
+            ScopedStructuralChange change(*this);
+            
+            *mDryWetParameter = xml->getDoubleAttribute("Dry/Wet", *mDryWetParameter);
+            *mFeedbackParameter = xml->getDoubleAttribute("Feedback", *mFeedbackParameter);
+            *mDelayTimeParameter = xml->getDoubleAttribute("Delay time", *mDelayTimeParameter);
+            *mLfoRateParameter = xml->getDoubleAttribute("LFO rate", *mLfoRateParameter);
+            *mLfoDepthParameter = xml->getDoubleAttribute("LFO depth", *mLfoDepthParameter);
+            *mLfoPhaseParameter = xml->getDoubleAttribute("LFO phase", *mLfoPhaseParameter);
+            *mLowCutParameter = xml->getDoubleAttribute("Low cut", DampingFilterBank::MIN_LOW_CUT);
+            *mHighCutParameter = xml->getDoubleAttribute("High cut", DampingFilterBank::MAX_HIGH_CUT);
+            
+            int storage = juce::jlimit(0, (int) DelayLineStorage::Format::int16, xml->getIntAttribute("Storage", 0));
+            setDelayStorageFormat((DelayLineStorage::Format) storage);
+            setInterleavedDelayBuffers(xml->getBoolAttribute("Interleaved buffers", false));
+            setLongDelayMode(xml->getBoolAttribute("Long delay", false), xml->getDoubleAttribute("Long delay max", DEFAULT_LONG_DELAY_TIME));
+            setOnDemandMemory(xml->getBoolAttribute("On-demand memory", false));
+            
+            int quality = juce::jlimit(0, (int) QualityTier::high, xml->getIntAttribute("Quality", (int) QualityTier::normal));
+            setQualityTier((QualityTier) quality);
+            setAutomaticQuality(xml->getBoolAttribute("Automatic quality", false));
+            setOfflineMaximumQuality(xml->getBoolAttribute("Offline maximum quality", true));
+            
+            for (int band = 0; band < SpectralDelay::NUM_BANDS; ++band)
+                mSpectralDelay.setBandShape(band, 1.0f, 1.0f);
+            
+            for (auto* bandXml : xml->getChildWithTagNameIterator("Band")) {
+                int band = bandXml->getIntAttribute("Index", -1);
+            
+                if (band >= 0 && band < SpectralDelay::NUM_BANDS)
+                    mSpectralDelay.setBandShape(band, bandXml->getDoubleAttribute("Delay scale", 1.0), bandXml->getDoubleAttribute("Feedback scale", 1.0));
+            }
+            
+            for (int index = 0; index < MultiTapDelay::MAX_TAPS; ++index)
+                setTap(index, {});
+            
+            for (auto* tapXml : xml->getChildWithTagNameIterator("Tap")) {
+                int index = tapXml->getIntAttribute("Index", -1);
+            
+                if (index >= 0 && index < MultiTapDelay::MAX_TAPS) {
+                    MultiTapDelay::Tap tap;
+                    tap.delaySeconds = tapXml->getDoubleAttribute("Time", tap.delaySeconds);
+                    tap.gain = tapXml->getDoubleAttribute("Gain", tap.gain);
+                    tap.pan = tapXml->getDoubleAttribute("Pan", tap.pan);
+                    tap.highCut = tapXml->getDoubleAttribute("High cut", tap.highCut);
+                    setTap(index, tap);
+                }
+            }
+            
+            setSpectralFreeze(xml->getBoolAttribute("Spectral freeze", false));
+            setSpectralFftOrder(xml->getIntAttribute("Spectral FFT order", 11));
+            setDelayEngine(xml->getIntAttribute("Engine", 0) == (int) DelayEngine::spectral ? DelayEngine::spectral : DelayEngine::lines);
+            setFixedInternalRate(xml->getBoolAttribute("Fixed internal rate", false));
+            setOutputLimiter(xml->getBoolAttribute("Output limiter", false));
+            setMultiTap(xml->getBoolAttribute("Multi-tap", false));
+            
+            GranularCloud::Settings grains;
+            grains.density = xml->getDoubleAttribute("Grain density", grains.density);
+            grains.grainSeconds = xml->getDoubleAttribute("Grain size", grains.grainSeconds);
+            grains.positionSpread = xml->getDoubleAttribute("Grain spread", grains.positionSpread);
+            grains.pitchSpread = xml->getDoubleAttribute("Grain pitch spread", grains.pitchSpread);
+            grains.window = (GranularCloud::Window) juce::jlimit(0, GranularCloud::NUM_WINDOWS - 1, xml->getIntAttribute("Grain window", 0));
+            setGranularSettings(grains);
+            setGranular(xml->getBoolAttribute("Granular", false));
+            setStateSnapshot(xml->getBoolAttribute("State snapshot", false));
+        }
+            
+        // Anything past the XML and its terminator is a snapshot of the running engine
+        const size_t xmlBytes = 9 + (size_t) juce::ByteOrder::littleEndianInt(juce::addBytesToPointer(data, 4));
+        
+        if ((size_t) sizeInBytes > xmlBytes && mPendingSnapshot.decode(juce::addBytesToPointer(data, xmlBytes), (size_t) sizeInBytes - xmlBytes)) {
+            // Already playing: restore it alongside the audio callback, otherwise prepareToPlay will
+            if (mCircularBufferLength > 0) {
+                applySnapshotWhilePlaying(mPendingSnapshot);
+                mPendingSnapshot.clear();
+            }
+        }
     }
 }
 
@@ -9,13 +9,31 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DelayBufferOverview.h"
+#include "DelayLineStorage.h"
+#include "DelayMemoryPool.h"
+#include "DampingFilterBank.h"
+#include "KernelDispatch.h"
+#include "QualityTiers.h"
+#include "HalfbandOversampler.h"
+#include "SpectralDelay.h"
+#include "CoefficientDesigner.h"
+#include "DiffusionNetwork.h"
+#include "PolyphaseResampler.h"
+#include "OutputLimiter.h"
+#include "TraceZones.h"
+#include "RealtimeSafety.h"
+#include "EngineSnapshot.h"
+#include "MultiTapDelay.h"
+#include "GranularCloud.h"
 
 #define MAX_DELAY_TIME 2
 
 //==============================================================================
 /**
 */
-class DelaytutorialAudioProcessor  : public juce::AudioProcessor
+class DelaytutorialAudioProcessor  : public juce::AudioProcessor,
+                                     private juce::Timer
 {
 public:
     //==============================================================================
@@ -25,6 +43,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -56,6 +75,162 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     float lin_interp(float sample_x, float sample_x1, float inPhase);
+    
+    const DelayBufferOverview& getOverviewLeft() const { return mOverviewLeft; }
+    const DelayBufferOverview& getOverviewRight() const { return mOverviewRight; }
+    
+    /** Sample format of the delay memory. 16-bit formats halve its footprint for dense sessions. */
+    void setDelayStorageFormat(DelayLineStorage::Format format);
+    DelayLineStorage::Format getDelayStorageFormat() const { return mDelayStorageFormat; }
+    
+    /** Interleaved buffers keep both channels in one buffer of stereo frames, so reads of
+        the two channels at nearby positions touch one cache line and page instead of two.
+    */
+    void setInterleavedDelayBuffers(bool enabled);
+    bool isInterleavedDelayBuffers() const { return mInterleavedBuffers; }
+    
+    /** Long-delay mode stretches the delay time range to maxDelaySeconds, with the
+        delay memory pinned in RAM. The top of the delay time range reaches the longest
+        delay and the bottom stays put, see getDelaySeconds. The buffers are capped at
+        MAX_LONG_DELAY_SAMPLES, and halved in prepareToPlay until the memory is there.
+    */
+    void setLongDelayMode(bool enabled, double maxDelaySeconds = DEFAULT_LONG_DELAY_TIME);
+    bool isLongDelayMode() const { return mLongDelayMode; }
+    double getMaxDelaySeconds() const;
+    
+    /** The delay time in seconds for a delay time parameter value, stretched in long-delay mode. */
+    double getDelaySeconds(float parameterValue) const;
+    
+    static constexpr double DEFAULT_LONG_DELAY_TIME = 300.0;
+    static const int MAX_LONG_DELAY_SAMPLES = 1 << 24;
+    
+    /** On-demand memory takes the delay buffers from the shared DelayMemoryPool when
+        non-silent input arrives and gives them back once the tail has decayed.
+        Taking a slot starts the engine state over, LFO phase and smoothing included,
+        so after a release the output no longer matches a render with the mode off.
+    */
+    void setOnDemandMemory(bool enabled);
+    bool isOnDemandMemory() const { return mOnDemandMemory; }
+    bool hasDelayMemory() const { return mCircularBufferLeft.hasMemory(); }
+    
+    /** Bytes of delay memory the two channels hold, an interleaved pair being one block. */
+    size_t getDelayMemoryBytes() const;
+    
+    static constexpr float SILENCE_THRESHOLD = 1.0e-6f;  // About -120 dBFS
+    
+    /** The kernel build chosen at the last prepareToPlay, see KernelDispatch. */
+    const KernelDispatch::Kernels& getKernels() const { return *mKernels; }
+    
+    /** Quality tier to run, or with automatic quality the highest tier the engine may
+        step back up to. Changes crossfade over TIER_CROSSFADE_LENGTH. Any thread.
+    */
+    void setQualityTier(QualityTier tier);
+    QualityTier getQualityTier() const { return (QualityTier) mQualityTierParameter->getIndex(); }
+    
+    /** Automatic quality steps down a tier when processBlock nears the block budget
+        and back up when there is headroom again, see QualityGovernor.
+    */
+    void setAutomaticQuality(bool enabled) { *mAutomaticQualityParameter = enabled; }
+    bool isAutomaticQuality() const { return *mAutomaticQualityParameter; }
+    
+    /** While the host renders offline, run the high tier with automatic quality off,
+        whatever is set for realtime. Tiers carry no latency, so the reported latency
+        stays the same. On by default.
+    */
+    void setOfflineMaximumQuality(bool enabled) { mOfflineMaximumQuality = enabled; }
+    bool isOfflineMaximumQuality() const { return mOfflineMaximumQuality; }
+    
+    QualityTier getActiveQualityTier() const { return mActiveTier; }
+    float getProcessingLoad() const { return mQualityGovernor.getLoad(); }
+    
+    enum class DelayEngine
+    {
+        lines = 0,
+        spectral
+    };
+    
+    /** The spectral engine delays each frequency band on its own, see SpectralDelay.
+        It reports its FFT size as latency; the delay lines report none. The engine and
+        FFT size are host parameters too; moved by the host, they take effect at the
+        next prepareToPlay or within a tick of the message thread timer.
+    */
+    void setDelayEngine(DelayEngine engine);
+    DelayEngine getDelayEngine() const { return mDelayEngine; }
+    
+    /** FFT size of the spectral engine as a power of two, 10 to 12. */
+    void setSpectralFftOrder(int order);
+    int getSpectralFftOrder() const { return mSpectralFftOrder; }
+    
+    void setSpectralFreeze(bool enabled) { *mSpectralFreezeParameter = enabled; }
+    bool isSpectralFreeze() const { return *mSpectralFreezeParameter; }
+    
+    /** Per-band delay time and feedback scaling of the spectral engine. Any thread. */
+    void setSpectralBand(int band, float delayScale, float feedbackScale) { mSpectralDelay.setBandShape(band, delayScale, feedbackScale); }
+    const SpectralDelay& getSpectralDelay() const { return mSpectralDelay; }
+    
+    /** Rhythmic taps on the delay lines' buffers, added to the wet signal, see
+        MultiTapDelay. Any thread. The spectral engine has no buffers to tap.
+    */
+    void setMultiTap(bool enabled) { *mMultiTapParameter = enabled; }
+    bool isMultiTap() const { return *mMultiTapParameter; }
+    
+    /** Time, gain, pan and high cut of one of MultiTapDelay::MAX_TAPS taps. Any thread.
+        The first NUM_TAP_PARAMETERS taps are host parameters too, with times up to
+        MAX_DELAY_TIME seconds; the rest are only set from here and the saved state.
+    */
+    void setTap(int index, const MultiTapDelay::Tap& tap);
+    MultiTapDelay::Tap getTap(int index) const;
+    
+    static const int NUM_TAP_PARAMETERS = 8;
+    
+    /** A cloud of grains from the delay lines' buffers, spawned around the delay time
+        and added to the wet signal, see GranularCloud. Any thread.
+    */
+    void setGranular(bool enabled) { *mGranularParameter = enabled; }
+    bool isGranular() const { return *mGranularParameter; }
+    
+    /** Host parameters, handed to the cloud at the start of every block. Position spread
+        reaches MAX_DELAY_TIME seconds.
+    */
+    void setGranularSettings(const GranularCloud::Settings& settings);
+    GranularCloud::Settings getGranularSettings() const;
+    const GranularCloud& getGranularCloud() const { return mGranularCloud; }
+    
+    /** Runs the engine at INTERNAL_SAMPLE_RATE whatever the host rate, between two
+        PolyphaseResamplers, so its CPU and memory don't grow with the session rate.
+        Adds the resamplers' round trip to the reported latency.
+    */
+    void setFixedInternalRate(bool enabled);
+    bool isFixedInternalRate() const { return mFixedInternalRate; }
+    
+    /** The rate the engine and its buffers run at. */
+    double getEngineSampleRate() const { return mEngineSampleRate; }
+    
+    static const int INTERNAL_SAMPLE_RATE = 48000;
+    
+    /** Runs the output through a true-peak lookahead limiter at the host rate,
+        so high-feedback settings can't go over its ceiling. Adds its lookahead
+        to the reported latency. A host parameter too, applied like the engine.
+    */
+    void setOutputLimiter(bool enabled);
+    bool isOutputLimiter() const { return mOutputLimiterEnabled; }
+    
+    /** Lowest limiter gain in the last block, 1 when it isn't limiting. */
+    float getLimiterGainReduction() const { return mOutputLimiter.getGainReduction(); }
+    
+    /** Saves the running engine, delay memory included, with the plugin state, so a
+        reloaded project carries on with its tail instead of starting silent. Only
+        restored onto the same sample rate, engine and buffer layout. Off by default.
+    */
+    void setStateSnapshot(bool enabled) { mStateSnapshot = enabled; }
+    bool isStateSnapshot() const { return mStateSnapshot; }
+    
+   #if DELAY_TRACING
+    /** Whether releaseResources writes the trace to the temp folder. Turn it off when other
+        instances may still be recording, and write the trace once they have all stopped.
+    */
+    void setWritesTraceOnRelease(bool enabled) { mWritesTraceOnRelease = enabled; }
+   #endif
 
 private:
     
@@ -65,6 +240,30 @@ private:
     juce::AudioParameterFloat* mLfoRateParameter;
     juce::AudioParameterFloat* mLfoDepthParameter;
     juce::AudioParameterFloat* mLfoPhaseParameter;
+    juce::AudioParameterFloat* mLowCutParameter;
+    juce::AudioParameterFloat* mHighCutParameter;
+    juce::AudioParameterBool* mMultiTapParameter;
+    juce::AudioParameterFloat* mTapTimeParameters[NUM_TAP_PARAMETERS];
+    juce::AudioParameterFloat* mTapGainParameters[NUM_TAP_PARAMETERS];
+    juce::AudioParameterFloat* mTapPanParameters[NUM_TAP_PARAMETERS];
+    juce::AudioParameterFloat* mTapHighCutParameters[NUM_TAP_PARAMETERS];
+    juce::AudioParameterChoice* mQualityTierParameter;
+    juce::AudioParameterBool* mAutomaticQualityParameter;
+    juce::AudioParameterChoice* mDelayEngineParameter;
+    juce::AudioParameterChoice* mSpectralFftSizeParameter;
+    juce::AudioParameterBool* mSpectralFreezeParameter;
+    juce::AudioParameterBool* mGranularParameter;
+    juce::AudioParameterFloat* mGrainDensityParameter;
+    juce::AudioParameterFloat* mGrainSizeParameter;
+    juce::AudioParameterFloat* mGrainSpreadParameter;
+    juce::AudioParameterFloat* mGrainPitchSpreadParameter;
+    juce::AudioParameterChoice* mGrainWindowParameter;
+    juce::AudioParameterBool* mOutputLimiterParameter;
+    
+    // Parameters that change the memory or latency of the engine, so applying them
+    // prepares it again. The timer applies what the host moved, on the message thread
+    void updateStructuralParameters();
+    void timerCallback() override;
     
     float mLfoPhase;
     
@@ -72,28 +271,223 @@ private:
     float mLfoDepthSmooth;
     float mStereoOffsetSmooth;
     
-    float* mCircularBufferLeft;
-    float* mCircularBufferRight;
+    DelayLineStorage mCircularBufferLeft;
+    DelayLineStorage mCircularBufferRight;
+    DelayLineStorage::Format mDelayStorageFormat;
+    bool mInterleavedBuffers;
+    
+    const KernelDispatch::Kernels* mKernels;
+    
+    void reallocateDelayMemory();
+    bool allocateDelayLines();
+    
+    // Holds the audio callback off while settings the engine reads without a lock change.
+    // Changes in nested scopes prepare the engine once, when the outermost scope ends
+    struct ScopedStructuralChange
+    {
+        explicit ScopedStructuralChange(DelaytutorialAudioProcessor& processor);
+        ~ScopedStructuralChange();
+        
+        DelaytutorialAudioProcessor& mProcessor;
+    };
+    
+    int mStructuralChangeDepth;
+    bool mStructuralChangeSuspended;
+    bool mStructuralChangePrepares;
+    void resetEngineState();
+    
+    // On-demand memory: both channels share one pool slot
+    bool updateOnDemandMemory(const juce::AudioBuffer<float>& buffer);
+    void releaseDecayedMemory(float blockPeak, int numSamples);
+    void attachDelayBuffers(void* memory);
+    void returnPoolSlot();
+    
+    juce::SharedResourcePointer<DelayMemoryPool> mMemoryPool;
+    bool mOnDemandMemory;
+    void* mPoolSlot;
+    size_t mPoolSlotBytes;
+    bool mPoolSlotPinned;
+    bool mWaitingForMemory;
+    int mSilentSamples;
+    
+    bool mLongDelayMode;
+    double mLongDelayMaxSeconds;
+    float mDelayTimeScale;      // Delay time parameter to seconds
     
     int mCircularBufferWriteHead;
     int mCircularBufferLength;
     
+    DelayBufferOverview mOverviewLeft;
+    DelayBufferOverview mOverviewRight;
+    
     float mDelayReadHead_left;
     float mDelayReadHead_right;
 
     
     static const int NUM_DELAY_LINES = 4;  // Number of delay lines
+    static const int CONTROL_BLOCK_SIZE = 16;  // Samples between modulation updates
     float mDelayFraction = 0.66f;  // Each delay line will be this fraction of the previous
     
-    float mDelayTimeInSamples_left[NUM_DELAY_LINES];
-    float mDelayTimeInSamples_right[NUM_DELAY_LINES];
+    // Kept as doubles, but only long-delay mode computes them in double precision:
+    // a float has no fraction left past 2^23 samples for the read heads to interpolate
+    // with. Otherwise they hold floats and run the float arithmetic they always have.
+    // The per-sample state from here on starts a cache line of its own
+    alignas(64) double mDelayTimeInSamples_left[NUM_DELAY_LINES];
+    double mDelayTimeInSamples_right[NUM_DELAY_LINES];
+    
+    template <typename Precision>
+    void updateDelayTimes(float lfoPhaseOffset, float lfoDepth, float stereoOffset, float* targetDelay_left, float* targetDelay_right);
+    void advanceDelayTimes(int line);
+    template <typename Precision>
+    void getReadHeads(int line, double& readHeadLeft, double& readHeadRight) const;
+    
+    // Control-rate state: values are recomputed every CONTROL_BLOCK_SIZE samples
+    // and ramped linearly in between, independent of the host block size
+    void updateControlValues();
+    
+    int mControlSamplesRemaining;
+    float mControlSmoothCoeff;
+    double mDelayTimeIncrement_left[NUM_DELAY_LINES];
+    double mDelayTimeIncrement_right[NUM_DELAY_LINES];
+    float mStereoOffsetIncrement;
+    float mTremLfo;
+    float mTremLfoIncrement;
+    
+    // Static-delay fast path: with no modulation and settled delay times the
+    // unshifted lines read whole control blocks at a fixed offset, and delay
+    // changes crossfade between the old and new read position. Entering and
+    // leaving the path crossfade with the modulated read the same way
+    static const int STATIC_CROSSFADE_LENGTH = 16 * CONTROL_BLOCK_SIZE;
+    static bool isStaticLine (int line) { return line % 2 == 0; }
+    
+    void updateStaticDelays(const float* targetDelay_left, const float* targetDelay_right, bool modulated);
+    void renderStaticBlock();
+    void readStaticHead(const DelayLineStorage& buffer, float delayInSamples, float* out, int interpolationOrder) const;
+    
+    bool mStaticDelayActive;
+    int mStaticFadeSamplesRemaining;
+    int mStaticExitSamplesRemaining;    // While leaving, the block reads fade out under the modulated ones
+    bool mStaticExitFading;
+    float mStaticExitGain[CONTROL_BLOCK_SIZE];
+    float mStaticDelay_left[NUM_DELAY_LINES];
+    float mStaticDelay_right[NUM_DELAY_LINES];
+    float mStaticFadeFrom_left[NUM_DELAY_LINES];
+    float mStaticFadeFrom_right[NUM_DELAY_LINES];
+    float mStaticLineOutputLeft[NUM_DELAY_LINES][CONTROL_BLOCK_SIZE];
+    float mStaticLineOutputRight[NUM_DELAY_LINES][CONTROL_BLOCK_SIZE];
+    
+    // Quality tiers: the audio thread picks up the requested tier at the start of a
+    // block and crossfades every setting that differs from the tier it leaves
+    static const int TIER_CROSSFADE_LENGTH = 64 * CONTROL_BLOCK_SIZE;
+    
+    void updateQualityTier();
+    bool isMaximumQualityRender() const { return mOfflineMaximumQuality && isNonRealtime(); }
+    static float getLineGain(int line, const QualitySettings& tier, const QualitySettings& fadeFromTier, float tierFade);
+    static float readModulatedLine(const DelayLineStorage& buffer, double readHead, const QualitySettings& tier,
+                                   const QualitySettings& fadeFromTier, float tierFade);
+    static float saturateOutput(float sample, HalfbandOversampler& oversampler, const QualitySettings& tier,
+                                const QualitySettings& fadeFromTier, float tierFade);
+    
+    std::atomic<bool> mOfflineMaximumQuality;
+    std::atomic<QualityTier> mActiveTier;
+    QualityTier mFadeFromTier;
+    int mTierFadeSamplesRemaining;
+    QualityGovernor mQualityGovernor;
+    HalfbandOversampler mOutputOversamplerLeft;
+    HalfbandOversampler mOutputOversamplerRight;
+    
+    void processEngineBlock(juce::AudioBuffer<float>& buffer);
     
-    float mFeedbackLeft[NUM_DELAY_LINES];
-     float mFeedbackRight[NUM_DELAY_LINES];
+    // Fixed internal rate: host rate in and out, the engine in between
+    void prepareResampling(double hostSampleRate, int samplesPerBlock);
+    void processResampledBlock(juce::AudioBuffer<float>& buffer);
+    
+    bool mFixedInternalRate;
+    bool mResampling;
+    double mEngineSampleRate;
+    int mResamplerLatency;
+    int mResamplerBlockSize;
+    PolyphaseResampler mInputResamplerLeft, mInputResamplerRight;
+    PolyphaseResampler mOutputResamplerLeft, mOutputResamplerRight;
+    juce::AudioBuffer<float> mInternalBuffer;
+    
+    bool mOutputLimiterEnabled;     // As prepared
+    OutputLimiter mOutputLimiter;
+    
+    // State snapshot: every piece of engine state that makes up the tail, in a fixed order
+    template <typename Visitor>
+    void visitEngineState(Visitor& visit);
+    EngineSnapshot::Layout getSnapshotLayout() const;
+    void appendEngineSnapshot(juce::MemoryBlock& destData);
+    bool applySnapshot(const EngineSnapshot& snapshot);
+    bool applySnapshotWhilePlaying(const EngineSnapshot& snapshot);
+    bool isEngineStateValid() const;
+    void rebuildOverview();
+    
+    // The big ring sections are copied with the audio callback running, and then under the
+    // callback lock only what it wrote since these positions along with the rest of the state
+    struct WritePositions
+    {
+        juce::int64 samplesWritten;
+        juce::uint32 engineResets;
+        int writeHead;
+        int spectralFrame;
+    };
+    
+    WritePositions getWritePositions() const;
+    bool canCopyWrittenSince(const WritePositions& from) const;
+    bool isRingSection(const void* section) const;
+    void copyWrittenSection(const WritePositions& from, const void* section, const void* source, void* destination, size_t numBytes) const;
+    
+    std::atomic<bool> mStateSnapshot;
+    juce::int64 mSamplesWritten;        // Engine samples processed
+    juce::uint32 mEngineResets;         // resetEngineState calls and delay memory released
+    
+   #if DELAY_TRACING
+    bool mWritesTraceOnRelease;
+   #endif
+    EngineSnapshot mPendingSnapshot;    // Restored by the next prepareToPlay
+    
+    // Hands the tap parameters the host moved to the taps, at the start of a block
+    void updateTapParameters();
+    MultiTapDelay::Tap getTapParameters(int index) const;
+    
+    bool mMultiTapRunning;      // Audio thread's view, so taps switched on fade in
+    MultiTapDelay mMultiTap;
+    
+    bool mGranularRunning;
+    GranularCloud mGranularCloud;
+    
+    // Spectral engine, run instead of the lines
+    void processSpectralBlock(juce::AudioBuffer<float>& buffer);
+    
+    SpectralDelay mSpectralDelay;
+    DelayEngine mDelayEngine;       // As prepared, which the parameters may have moved on from
+    int mSpectralFftOrder;
+    
+    // The feedback, filter and DC blocker state below is written every sample. Aligning it
+    // makes the processor itself 64-byte aligned and a whole number of cache lines long,
+    // so none of it shares a line with whatever the host allocates next to it, which may
+    // be another instance running on another core
+    alignas(64) float mFeedbackLeft[NUM_DELAY_LINES];
+    float mFeedbackRight[NUM_DELAY_LINES];
+    
+    // Left lines in lanes 0..NUM_DELAY_LINES-1, right lines after them
+    DampingFilterBank mDampingFilters;
+    DiffusionNetwork mDiffusion;
+    
+    CoefficientDesigner mCoefficientDesigner;
     
     float mFilterStatesLeft[8] = {0};
     float mFilterStatesRight[8] = {0};
     
+    // DC blocker, density and tremolo state
+    float mLastInputLeft, mLastInputRight;
+    float mLastOutputLeft, mLastOutputRight;
+    float mDensityFactor;
+    float mDcBlockerStateLeft, mDcBlockerStateRight;
+    float mTremPhase;
+    
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelaytutorialAudioProcessor)
 };
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.cpp
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+#include <numeric>
+
+namespace
+{
+    const double CUTOFF = 0.46;         // Of the lower rate, about 22 kHz at 48 kHz
+    const double KAISER_BETA = 9.0;     // Around 90 dB of stop band rejection
+}
+
+//==============================================================================
+PolyphaseResampler::PolyphaseResampler()
+{
+    mKernels = &KernelDispatch::get (KernelDispatch::Variant::portable);
+    mNumTaps = 0;
+    mRingMask = 0;
+    mMaxInputBlock = 0;
+    mNumPushed = 0;
+    mIndex = 0;
+    mRemainder = 0;
+    mStepWhole = 1;
+    mStepRemainder = 0;
+    mDenominator = 1;
+}
+
+void PolyphaseResampler::prepare (int inputRate, int outputRate, int maxInputBlock)
+{
+    jassert (inputRate > 0 && outputRate > 0);
+
+    const int divisor = std::gcd (inputRate, outputRate);
+    const juce::int64 numerator = inputRate / divisor;
+    mDenominator = outputRate / divisor;
+    mStepWhole = numerator / mDenominator;
+    mStepRemainder = numerator % mDenominator;
+
+    // The filter spans the same time whichever way it converts
+    const double ratio = std::max (1.0, (double) inputRate / outputRate);
+    const int width = KernelDispatch::DOT_PRODUCT_WIDTH;
+    mNumTaps = (int) std::ceil (TAPS_AT_LOWER_RATE * ratio / width) * width;
+
+    const double cutoff = CUTOFF * std::min (inputRate, outputRate) / inputRate;    // Cycles per input sample
+    const double halfLength = mNumTaps / 2;
+    const double windowNorm = besselI0 (KAISER_BETA);
+
+    mCoefficients.assign ((size_t) ((NUM_PHASES + 1) * mNumTaps), 0.0f);
+
+    for (int row = 0; row <= NUM_PHASES; ++row)
+    {
+        float* coefficients = mCoefficients.data() + row * mNumTaps;
+        const double fraction = (double) row / NUM_PHASES;
+        double sum = 0.0;
+
+        for (int i = 0; i < mNumTaps; ++i)
+        {
+            // Distance from the output position to tap i, in input samples
+            const double x = i - (halfLength - 1.0) - fraction;
+            const double u = x / halfLength;
+
+            if (std::abs (u) >= 1.0)
+                continue;
+
+            const double arg = 2.0 * cutoff * x;
+            const double sinc = arg == 0.0 ? 1.0 : std::sin (M_PI * arg) / (M_PI * arg);
+            const double window = besselI0 (KAISER_BETA * std::sqrt (1.0 - u * u)) / windowNorm;
+            const double h = 2.0 * cutoff * sinc * window;
+
+            coefficients[i] = (float) h;
+            sum += h;
+        }
+
+        for (int i = 0; i < mNumTaps; ++i)
+            coefficients[i] = (float) (coefficients[i] / sum);
+    }
+
+    mMaxInputBlock = maxInputBlock;
+    const int ringSize = juce::nextPowerOfTwo (2 * (mNumTaps + maxInputBlock));
+    mRingMask = ringSize - 1;
+    mHistory.assign ((size_t) (2 * ringSize), 0.0f);
+
+    reset();
+}
+
+void PolyphaseResampler::reset (int delayInOutputSamples)
+{
+    std::fill (mHistory.begin(), mHistory.end(), 0.0f);
+    mNumPushed = 0;
+
+    // Start at -delay * step input samples, as a whole part and a remainder
+    const juce::int64 numerator = mStepWhole * mDenominator + mStepRemainder;
+    const juce::int64 start = -(juce::int64) delayInOutputSamples * numerator;
+    mIndex = start >= 0 ? start / mDenominator : -((-start + mDenominator - 1) / mDenominator);
+    mRemainder = start - mIndex * mDenominator;
+
+    // An output is read at most one input block after its taps are complete, so from its
+    // oldest tap to the newest input pushed by then has to fit in the ring
+    jassert (-mIndex + mNumTaps / 2 + mMaxInputBlock <= mRingMask + 1);
+}
+
+void PolyphaseResampler::push (const float* input, int numSamples) noexcept
+{
+    const int ringSize = mRingMask + 1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int position = (int) (mNumPushed & mRingMask);
+        mHistory[(size_t) position] = input[i];
+        mHistory[(size_t) (position + ringSize)] = input[i];
+        ++mNumPushed;
+    }
+}
+
+int PolyphaseResampler::read (float* output, int maxSamples) noexcept
+{
+    const int halfTaps = mNumTaps / 2;
+    int numRead = 0;
+
+    while (numRead < maxSamples && mIndex + halfTaps < mNumPushed)
+    {
+        const int start = (int) ((mIndex - halfTaps + 1) & mRingMask);
+        const double phase = (double) mRemainder * NUM_PHASES / (double) mDenominator;
+        const int row = (int) phase;
+
+        const float* coefficients = mCoefficients.data() + row * mNumTaps;
+        output[numRead++] = mKernels->interpolatedDotProduct (mHistory.data() + start, coefficients, coefficients + mNumTaps,
+                                                              (float) (phase - row), mNumTaps);
+
+        mIndex += mStepWhole;
+        mRemainder += mStepRemainder;
+
+        if (mRemainder >= mDenominator)
+        {
+            mRemainder -= mDenominator;
+            ++mIndex;
+        }
+    }
+
+    return numRead;
+}
+
+//==============================================================================
+double PolyphaseResampler::besselI0 (double x)
+{
+    // Power series, converges quickly for the arguments a Kaiser window uses
+    double sum = 1.0, term = 1.0;
+
+    for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+
+    return sum;
+}
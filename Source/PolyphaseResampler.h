@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.h
+
+    Streaming sample rate conversion between any two integer rates, with a
+    windowed-sinc polyphase filter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "KernelDispatch.h"
+
+//==============================================================================
+/**
+    The filter is a Kaiser-windowed sinc cut off just below the Nyquist
+    frequency of the lower rate, TAPS_AT_LOWER_RATE taps long at that rate,
+    tabulated at NUM_PHASES fractional positions. Each output blends the two
+    phases either side of its position. Every row is normalised to unity
+    gain, so DC passes exactly.
+
+    Positions are kept as an input index plus a remainder in units of
+    1 / outputRate, so the stream never drifts however long it runs. Input
+    goes into a mirrored ring, which gives every output its taps as one
+    contiguous run for the dot product kernel.
+
+    Call prepare on the message thread; push and read never allocate.
+*/
+class PolyphaseResampler
+{
+public:
+    static const int NUM_PHASES = 256;
+    static const int TAPS_AT_LOWER_RATE = 64;
+
+    PolyphaseResampler();
+
+    /** maxInputBlock is the most input pushed between two reads. */
+    void prepare (int inputRate, int outputRate, int maxInputBlock);
+
+    /** Clears the history. With a delay the first outputs land that many output
+        samples before the first input, so the stream comes out exactly that late.
+    */
+    void reset (int delayInOutputSamples = 0);
+
+    void setKernels (const KernelDispatch::Kernels& kernels) noexcept  { mKernels = &kernels; }
+
+    void push (const float* input, int numSamples) noexcept;
+
+    /** Produces up to maxSamples outputs, as many as the input pushed so far
+        allows, and returns how many.
+    */
+    int read (float* output, int maxSamples) noexcept;
+
+    /** Input samples past its own position that an output needs. */
+    int getLookahead() const noexcept   { return mNumTaps / 2; }
+
+private:
+    static double besselI0 (double x);
+
+    const KernelDispatch::Kernels* mKernels;
+
+    int mNumTaps;
+    std::vector<float> mCoefficients;   // NUM_PHASES + 1 rows of mNumTaps
+
+    std::vector<float> mHistory;        // Every sample stored at i and i + ring size
+    int mRingMask;
+    int mMaxInputBlock;
+
+    juce::int64 mNumPushed;
+    juce::int64 mIndex;                 // Position of the next output, whole input samples
+    juce::int64 mRemainder;             // and the fraction in units of 1 / mDenominator
+    juce::int64 mStepWhole;
+    juce::int64 mStepRemainder;
+    juce::int64 mDenominator;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
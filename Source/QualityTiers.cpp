@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    QualityTiers.cpp
+
+  ==============================================================================
+*/
+
+#include "QualityTiers.h"
+
+//==============================================================================
+const QualitySettings& getQualitySettings (QualityTier tier) noexcept
+{
+    static const QualitySettings eco     { 2, 4, 1, 1 };
+    static const QualitySettings normal  { 4, 8, 1, 1 };
+    static const QualitySettings high    { 4, 8, 3, 2 };
+
+    switch (tier)
+    {
+        case QualityTier::eco:      return eco;
+        case QualityTier::high:     return high;
+        case QualityTier::normal:
+        default:                    return normal;
+    }
+}
+
+//==============================================================================
+QualityGovernor::QualityGovernor()
+{
+    mSampleRate = 44100.0;
+    mSecondsPerTick = 1.0 / (double) juce::Time::getHighResolutionTicksPerSecond();
+    mPublishedLoad = 0.0f;
+
+    reset();
+}
+
+void QualityGovernor::prepare (double sampleRate)
+{
+    mSampleRate = sampleRate;
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    mLoad = 0.0;
+    mHeadroomSeconds = 0.0;
+    mSettleSeconds = SETTLE_SECONDS;
+    mPublishedLoad.store (0.0f, std::memory_order_relaxed);
+}
+
+void QualityGovernor::addMeasurement (juce::int64 elapsedTicks, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const double budgetSeconds = numSamples / mSampleRate;
+    const double load = elapsedTicks * mSecondsPerTick / budgetSeconds;
+
+    // Peak hold with a release of about half a second, whatever the block size
+    const double release = std::exp (-budgetSeconds / 0.5);
+    mLoad = std::max (load, mLoad * release);
+
+    mHeadroomSeconds = mLoad < STEP_UP_LOAD ? mHeadroomSeconds + budgetSeconds : 0.0;
+    mSettleSeconds = std::max (0.0, mSettleSeconds - budgetSeconds);
+
+    mPublishedLoad.store ((float) mLoad, std::memory_order_relaxed);
+}
+
+QualityTier QualityGovernor::chooseTier (QualityTier current, QualityTier ceiling, bool automatic) noexcept
+{
+    if (! automatic || current > ceiling)
+        return ceiling;
+
+    if (mSettleSeconds > 0.0)
+        return current;
+
+    QualityTier next = current;
+
+    if (mLoad > STEP_DOWN_LOAD && current > QualityTier::eco)
+        next = (QualityTier) ((int) current - 1);
+    else if (mHeadroomSeconds >= STEP_UP_HOLD_SECONDS && current < ceiling)
+        next = (QualityTier) ((int) current + 1);
+
+    if (next != current)
+    {
+        // Judge the new tier on its own blocks only
+        mLoad = 0.0;
+        mHeadroomSeconds = 0.0;
+        mSettleSeconds = SETTLE_SECONDS;
+    }
+
+    return next;
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    QualityTiers.h
+
+    Eco, normal and high settings of the engine, and the governor that
+    steps between them when processing gets close to the block budget.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum class QualityTier
+{
+    eco = 0,
+    normal,
+    high
+};
+
+/** What a tier runs. normal is the engine as it always was. */
+struct QualitySettings
+{
+    int numDelayLines;          // Lines read, counted from the first
+    int numReflectionTaps;
+    int interpolationOrder;     // 1 for linear, 3 for cubic reads
+    int oversampling;           // Factor for the output saturation, 1 or 2
+};
+
+const QualitySettings& getQualitySettings (QualityTier tier) noexcept;
+
+//==============================================================================
+/**
+    Measures how much of each block's real-time budget processBlock takes and
+    picks the tier to run. The load is a peak that decays over about half a
+    second, so a single slow block is enough to step down, and stepping up
+    again needs STEP_UP_HOLD_SECONDS of sustained headroom. After a step it
+    waits for the crossfade and for the load to reflect the new tier before
+    deciding again.
+
+    Never goes above the ceiling, which is the tier the user picked.
+*/
+class QualityGovernor
+{
+public:
+    static constexpr double STEP_DOWN_LOAD = 0.7;       // Fractions of the block budget
+    static constexpr double STEP_UP_LOAD = 0.3;
+    static constexpr double STEP_UP_HOLD_SECONDS = 2.0;
+    static constexpr double SETTLE_SECONDS = 0.5;
+
+    QualityGovernor();
+
+    void prepare (double sampleRate);
+    void reset();
+
+    /** Records one processBlock call of numSamples that took elapsedTicks
+        (juce::Time high resolution ticks). Audio thread.
+    */
+    void addMeasurement (juce::int64 elapsedTicks, int numSamples) noexcept;
+
+    /** The tier to run from now on: the ceiling without automatic mode, else
+        current moved by at most one step. Audio thread.
+    */
+    QualityTier chooseTier (QualityTier current, QualityTier ceiling, bool automatic) noexcept;
+
+    /** Smoothed peak of processBlock time over the block budget. Any thread. */
+    float getLoad() const noexcept  { return mPublishedLoad.load (std::memory_order_relaxed); }
+
+private:
+    double mSampleRate;
+    double mSecondsPerTick;
+
+    double mLoad;
+    double mHeadroomSeconds;
+    double mSettleSeconds;
+
+    std::atomic<float> mPublishedLoad;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QualityGovernor)
+};
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if DELAY_REALTIME_CHECKS
+
+#include <cerrno>
+#include <new>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <execinfo.h>
+ #include <unistd.h>
+#endif
+
+#if JUCE_LINUX
+ #include <dlfcn.h>
+ #include <poll.h>
+ #include <pthread.h>
+ #include <semaphore.h>
+ #include <sys/mman.h>
+#endif
+
+namespace
+{
+    // Depth of enabled checks on this thread; zero lets everything through
+    thread_local int checkDepth = 0;
+
+    inline void check (const char* what) noexcept
+    {
+        if (checkDepth > 0)
+            RealtimeSafety::reportViolation (what);
+    }
+
+    void* checkedAllocate (std::size_t size, const char* what) noexcept
+    {
+        check (what);
+        return std::malloc (size == 0 ? 1 : size);
+    }
+
+    void checkedFree (void* pointer, const char* what) noexcept
+    {
+        // Deleting null is a no-op, and common in code that is otherwise safe
+        if (pointer != nullptr)
+            check (what);
+
+        std::free (pointer);
+    }
+}
+
+//==============================================================================
+RealtimeSafety::ScopedCheck::ScopedCheck (bool enabled) noexcept
+    : mEnabled (enabled)
+{
+    if (mEnabled)
+        ++checkDepth;
+}
+
+RealtimeSafety::ScopedCheck::~ScopedCheck() noexcept
+{
+    if (mEnabled)
+        --checkDepth;
+}
+
+RealtimeSafety::ScopedSuspend::ScopedSuspend() noexcept
+    : mSavedDepth (checkDepth)
+{
+    checkDepth = 0;
+}
+
+RealtimeSafety::ScopedSuspend::~ScopedSuspend() noexcept
+{
+    checkDepth = mSavedDepth;
+}
+
+bool RealtimeSafety::isChecking() noexcept
+{
+    return checkDepth > 0;
+}
+
+void RealtimeSafety::reportViolation (const char* what) noexcept
+{
+    // Stays off for good: backtrace may allocate the first time it runs
+    checkDepth = 0;
+
+   #if JUCE_LINUX || JUCE_MAC
+    const char prefix[] = "Realtime safety violation: ";
+    ::write (STDERR_FILENO, prefix, sizeof (prefix) - 1);
+    ::write (STDERR_FILENO, what, std::strlen (what));
+    ::write (STDERR_FILENO, "\n", 1);
+
+    void* frames[64];
+    const int numFrames = backtrace (frames, 64);
+    backtrace_symbols_fd (frames, numFrames, STDERR_FILENO);
+   #else
+    DBG ("Realtime safety violation: " << what);
+   #endif
+
+    std::abort();
+}
+
+//==============================================================================
+void* operator new (std::size_t size)                                       { if (auto* p = checkedAllocate (size, "operator new")) return p; throw std::bad_alloc(); }
+void* operator new[] (std::size_t size)                                     { if (auto* p = checkedAllocate (size, "operator new[]")) return p; throw std::bad_alloc(); }
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept       { return checkedAllocate (size, "operator new"); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept     { return checkedAllocate (size, "operator new[]"); }
+
+void operator delete (void* pointer) noexcept                               { checkedFree (pointer, "operator delete"); }
+void operator delete[] (void* pointer) noexcept                             { checkedFree (pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::size_t) noexcept                  { checkedFree (pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::size_t) noexcept                { checkedFree (pointer, "operator delete[]"); }
+void operator delete (void* pointer, const std::nothrow_t&) noexcept        { checkedFree (pointer, "operator delete"); }
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept      { checkedFree (pointer, "operator delete[]"); }
+
+//==============================================================================
+#if JUCE_LINUX
+
+extern "C"
+{
+    // glibc's own entry points, which the replacements below forward to
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+
+namespace
+{
+    template <typename Function>
+    Function findNext (const char* name) noexcept
+    {
+        // dlsym allocates the first time round, which the checker lets through
+        const RealtimeSafety::ScopedSuspend suspend;
+        return reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+    }
+}
+
+extern "C"
+{
+    void* malloc (size_t size)                          { check ("malloc"); return __libc_malloc (size); }
+    void* calloc (size_t count, size_t size)            { check ("calloc"); return __libc_calloc (count, size); }
+    void* realloc (void* pointer, size_t size)          { check ("realloc"); return __libc_realloc (pointer, size); }
+    void* memalign (size_t alignment, size_t size)      { check ("memalign"); return __libc_memalign (alignment, size); }
+    void* aligned_alloc (size_t alignment, size_t size) { check ("aligned_alloc"); return __libc_memalign (alignment, size); }
+
+    int posix_memalign (void** result, size_t alignment, size_t size)
+    {
+        check ("posix_memalign");
+        *result = __libc_memalign (alignment, size);
+        return *result != nullptr ? 0 : ENOMEM;
+    }
+
+    void free (void* pointer)
+    {
+        if (pointer != nullptr)
+            check ("free");
+
+        __libc_free (pointer);
+    }
+}
+
+// Checks, then forwards to the next definition of the symbol, libc's or libpthread's
+#define DELAY_REALTIME_HOOK(ReturnType, name, parameters, arguments) \
+    extern "C" ReturnType name parameters \
+    { \
+        check (#name); \
+        static const auto next = findNext<ReturnType (*) parameters> (#name); \
+        return next arguments; \
+    }
+
+DELAY_REALTIME_HOOK (int, pthread_mutex_lock, (pthread_mutex_t* mutex), (mutex))
+DELAY_REALTIME_HOOK (int, pthread_rwlock_rdlock, (pthread_rwlock_t* lock), (lock))
+DELAY_REALTIME_HOOK (int, pthread_rwlock_wrlock, (pthread_rwlock_t* lock), (lock))
+DELAY_REALTIME_HOOK (int, pthread_cond_wait, (pthread_cond_t* condition, pthread_mutex_t* mutex), (condition, mutex))
+DELAY_REALTIME_HOOK (int, pthread_cond_timedwait, (pthread_cond_t* condition, pthread_mutex_t* mutex, const timespec* time), (condition, mutex, time))
+DELAY_REALTIME_HOOK (int, pthread_join, (pthread_t thread, void** result), (thread, result))
+DELAY_REALTIME_HOOK (int, sem_wait, (sem_t* semaphore), (semaphore))
+DELAY_REALTIME_HOOK (int, nanosleep, (const timespec* duration, timespec* remaining), (duration, remaining))
+DELAY_REALTIME_HOOK (int, usleep, (useconds_t microseconds), (microseconds))
+DELAY_REALTIME_HOOK (unsigned int, sleep, (unsigned int seconds), (seconds))
+DELAY_REALTIME_HOOK (int, poll, (pollfd* descriptors, nfds_t count, int timeout), (descriptors, count, timeout))
+DELAY_REALTIME_HOOK (ssize_t, read, (int descriptor, void* buffer, size_t count), (descriptor, buffer, count))
+DELAY_REALTIME_HOOK (ssize_t, write, (int descriptor, const void* buffer, size_t count), (descriptor, buffer, count))
+DELAY_REALTIME_HOOK (FILE*, fopen, (const char* path, const char* mode), (path, mode))
+DELAY_REALTIME_HOOK (void*, mmap, (void* address, size_t length, int protection, int flags, int descriptor, off_t offset), (address, length, protection, flags, descriptor, offset))
+DELAY_REALTIME_HOOK (int, munmap, (void* address, size_t length), (address, length))
+DELAY_REALTIME_HOOK (int, mlock, (const void* address, size_t length), (address, length))
+
+#undef DELAY_REALTIME_HOOK
+
+#endif
+#endif
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+
+    A checking mode that aborts with a stack trace when the audio thread
+    allocates, takes a lock or makes a blocking call.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Off unless the build defines it, and then the scope compiles to nothing
+#ifndef DELAY_REALTIME_CHECKS
+ #define DELAY_REALTIME_CHECKS 0
+#endif
+
+// Offline renders go unchecked unless the build defines this as well
+#ifndef DELAY_REALTIME_CHECKS_OFFLINE
+ #define DELAY_REALTIME_CHECKS_OFFLINE 0
+#endif
+
+#if DELAY_REALTIME_CHECKS
+
+//==============================================================================
+/**
+    While a ScopedCheck is alive on a thread, these count as violations on
+    that thread:
+    - every global operator new and delete
+    - on Linux, also malloc and its relatives, pthread mutex locks and
+      condition waits, semaphore waits, sleeps, file reads and writes, and
+      mmap
+
+    The Linux hooks replace the libc symbols of the executable they are
+    linked into, which has to link with -ldl on older glibc. That makes this
+    a mode for an offline harness that builds the sources itself. Inside a
+    plugin binary loaded by a host only the operator new and delete checks
+    take effect.
+
+    A violation writes what happened and a backtrace to stderr and aborts,
+    so a harness run fails at the first one with the offending call on the
+    stack.
+*/
+namespace RealtimeSafety
+{
+    class ScopedCheck
+    {
+    public:
+        /** Checks the calling thread until destroyed, unless enabled is false. */
+        explicit ScopedCheck (bool enabled) noexcept;
+        ~ScopedCheck() noexcept;
+
+    private:
+        bool mEnabled;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedCheck)
+    };
+
+    /** Lets everything through on the calling thread until destroyed, for work that
+        is allowed to allocate inside a check, such as offline coefficient design.
+    */
+    class ScopedSuspend
+    {
+    public:
+        ScopedSuspend() noexcept;
+        ~ScopedSuspend() noexcept;
+
+    private:
+        int mSavedDepth;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedSuspend)
+    };
+
+    /** True while the calling thread is inside an enabled ScopedCheck. */
+    bool isChecking() noexcept;
+
+    /** Writes what to stderr with a backtrace and aborts. */
+    void reportViolation (const char* what) noexcept;
+}
+
+ #define DELAY_REALTIME_CHECK_SCOPE(enabled) const RealtimeSafety::ScopedCheck realtimeSafetyCheck (enabled)
+ #define DELAY_REALTIME_SUSPEND_SCOPE() const RealtimeSafety::ScopedSuspend realtimeSafetySuspend
+
+#else
+
+ #define DELAY_REALTIME_CHECK_SCOPE(enabled)
+ #define DELAY_REALTIME_SUSPEND_SCOPE()
+
+#endif
@@ -0,0 +1,297 @@
+/*
+  ==============================================================================
+
+    SpectralDelay.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralDelay.h"
+
+namespace
+{
+    // out[b] = input[b] * inputGain[b] + delayed[b] * feedback[b], one component of a row
+    forcedinline void multiplyAdd (float* __restrict out, const float* __restrict input, const float* __restrict inputGain,
+                                   const float* __restrict delayed, const float* __restrict feedback, int numBins) noexcept
+    {
+        for (int b = 0; b < numBins; ++b)
+            out[b] = input[b] * inputGain[b] + delayed[b] * feedback[b];
+    }
+
+    const float LOWEST_BAND_FREQUENCY = 20.0f;
+}
+
+//==============================================================================
+SpectralDelay::SpectralDelay()
+{
+    mSampleRate = 44100.0;
+    mFftSize = 0;
+    mHopSize = 0;
+    mNumBins = 0;
+    mBinStride = 0;
+    mNumFrames = 0;
+    mFifoPosition = 0;
+    mHopCounter = 0;
+    mWriteFrame = 0;
+
+    mDelaySeconds = 0.5f;
+    mFeedback = 0.5f;
+    mLowCut = 0.0f;
+    mHighCut = 20000.0f;
+    mFreeze = false;
+    mBinsDirty = true;
+
+    for (int band = 0; band < NUM_BANDS; ++band)
+    {
+        mBandDelayScale[band] = 1.0f;
+        mBandFeedbackScale[band] = 1.0f;
+    }
+
+    mBandShapeVersion = 0;
+    mAppliedBandShapeVersion = -1;
+}
+
+void SpectralDelay::prepare (double sampleRate, int fftOrder, double maxDelaySeconds)
+{
+    fftOrder = juce::jlimit (MIN_FFT_ORDER, MAX_FFT_ORDER, fftOrder);
+
+    mFft.prepare (fftOrder);
+    mSampleRate = sampleRate;
+    mFftSize = mFft.getSize();
+    mHopSize = mFftSize / OVERLAP;
+    mNumBins = mFftSize / 2 + 1;
+    mBinStride = (mNumBins + 15) & ~15;
+    mNumFrames = (int) std::ceil (maxDelaySeconds * MAX_BAND_DELAY_SCALE * sampleRate / mHopSize) + 1;
+
+    const size_t historyBytes = (size_t) mNumFrames * 4 * (size_t) mBinStride * sizeof (float);
+
+    if (mHistory.getData() == nullptr || mHistory.getSize() != historyBytes)
+        mHistory.allocate (historyBytes, false);
+
+    // Periodic Hann on both sides; at 4x overlap the squared windows sum to 1.5
+    mWindow.resize ((size_t) mFftSize);
+
+    for (int i = 0; i < mFftSize; ++i)
+        mWindow[(size_t) i] = 0.5f - 0.5f * (float) std::cos (2.0 * M_PI * i / mFftSize);
+
+    mInputLeft.assign ((size_t) mFftSize, 0.0f);
+    mInputRight.assign ((size_t) mFftSize, 0.0f);
+    mOutputLeft.assign ((size_t) mFftSize, 0.0f);
+    mOutputRight.assign ((size_t) mFftSize, 0.0f);
+    mFftReal.assign ((size_t) mFftSize, 0.0f);
+    mFftImag.assign ((size_t) mFftSize, 0.0f);
+    mSpectrum.assign ((size_t) (4 * mBinStride), 0.0f);
+    mDelayed.assign ((size_t) (4 * mBinStride), 0.0f);
+
+    mBinDelay.assign ((size_t) mNumBins, 1);
+    mBinInputGain.assign ((size_t) mBinStride, 0.0f);
+    mBinFeedback.assign ((size_t) mBinStride, 0.0f);
+    mBinBand.assign ((size_t) mNumBins, 0);
+    mBinBandFraction.assign ((size_t) mNumBins, 0.0f);
+
+    // Position of each bin among the log-spaced bands
+    const float nyquist = (float) sampleRate * 0.5f;
+    const float octaves = std::log2 (nyquist / LOWEST_BAND_FREQUENCY);
+
+    for (int b = 0; b < mNumBins; ++b)
+    {
+        const float frequency = std::max (LOWEST_BAND_FREQUENCY, b * (float) sampleRate / mFftSize);
+        const float position = juce::jlimit (0.0f, (float) (NUM_BANDS - 1),
+                                             std::log2 (frequency / LOWEST_BAND_FREQUENCY) / octaves * (NUM_BANDS - 1));
+
+        mBinBand[(size_t) b] = std::min ((int) position, NUM_BANDS - 2);
+        mBinBandFraction[(size_t) b] = position - mBinBand[(size_t) b];
+    }
+
+    mBinsDirty = true;
+    reset();
+}
+
+void SpectralDelay::releaseMemory()
+{
+    mHistory.free();
+    mFftSize = 0;
+}
+
+void SpectralDelay::reset()
+{
+    std::fill (mInputLeft.begin(), mInputLeft.end(), 0.0f);
+    std::fill (mInputRight.begin(), mInputRight.end(), 0.0f);
+    std::fill (mOutputLeft.begin(), mOutputLeft.end(), 0.0f);
+    std::fill (mOutputRight.begin(), mOutputRight.end(), 0.0f);
+
+    if (mHistory.getData() != nullptr)
+        std::memset (mHistory.getData(), 0, mHistory.getSize());
+
+    mFifoPosition = 0;
+    mHopCounter = 0;
+    mWriteFrame = 0;
+}
+
+bool SpectralDelay::isStateValid() const noexcept
+{
+    // Released, nothing reads them until prepare resets them
+    if (mFftSize == 0)
+        return true;
+
+    return mFifoPosition >= 0 && mFifoPosition < mFftSize
+        && mHopCounter >= 0 && mHopCounter < mHopSize
+        && mWriteFrame >= 0 && mWriteFrame < mNumFrames;
+}
+
+//==============================================================================
+void SpectralDelay::setParameters (float delaySeconds, float feedback, float lowCut, float highCut, bool freeze) noexcept
+{
+    if (delaySeconds != mDelaySeconds || feedback != mFeedback || lowCut != mLowCut
+         || highCut != mHighCut || freeze != mFreeze)
+    {
+        mDelaySeconds = delaySeconds;
+        mFeedback = feedback;
+        mLowCut = lowCut;
+        mHighCut = highCut;
+        mFreeze = freeze;
+        mBinsDirty = true;
+    }
+}
+
+void SpectralDelay::setBandShape (int band, float delayScale, float feedbackScale) noexcept
+{
+    jassert (band >= 0 && band < NUM_BANDS);
+
+    mBandDelayScale[band] = juce::jlimit (0.0f, MAX_BAND_DELAY_SCALE, delayScale);
+    mBandFeedbackScale[band] = juce::jlimit (0.0f, 1.0f, feedbackScale);
+    ++mBandShapeVersion;
+}
+
+void SpectralDelay::updateBins() noexcept
+{
+    const float hopsPerSecond = (float) mSampleRate / mHopSize;
+
+    for (int b = 0; b < mNumBins; ++b)
+    {
+        const int band = mBinBand[(size_t) b];
+        const float fraction = mBinBandFraction[(size_t) b];
+        const float delayScale = mBandDelayScale[band] + fraction * (mBandDelayScale[band + 1] - mBandDelayScale[band]);
+        const float feedbackScale = mBandFeedbackScale[band] + fraction * (mBandFeedbackScale[band + 1] - mBandFeedbackScale[band]);
+
+        const int hops = (int) std::round (mDelaySeconds * delayScale * hopsPerSecond);
+        mBinDelay[(size_t) b] = juce::jlimit (1, mNumFrames - 1, hops);
+
+        if (mFreeze)
+        {
+            mBinInputGain[(size_t) b] = 0.0f;
+            mBinFeedback[(size_t) b] = 1.0f;
+            continue;
+        }
+
+        // Second-order roll-off outside the cut frequencies, applied to everything that recirculates
+        const float frequency = std::max (1.0f, b * (float) mSampleRate / mFftSize);
+        const float lowRatio = std::min (1.0f, frequency / std::max (1.0f, mLowCut));
+        const float highRatio = std::min (1.0f, mHighCut / frequency);
+        const float gain = lowRatio * lowRatio * highRatio * highRatio;
+
+        mBinInputGain[(size_t) b] = gain;
+        mBinFeedback[(size_t) b] = gain * mFeedback * feedbackScale;
+    }
+}
+
+//==============================================================================
+void SpectralDelay::process (float* left, float* right, int numSamples, float dryWet) noexcept
+{
+    const int mask = mFftSize - 1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int position = mFifoPosition;
+
+        // What leaves the input FIFO is the dry signal, one FFT size late like the wet one
+        const float dryLeft = mInputLeft[(size_t) position];
+        const float dryRight = mInputRight[(size_t) position];
+        mInputLeft[(size_t) position] = left[i];
+        mInputRight[(size_t) position] = right[i];
+
+        const float wetLeft = mOutputLeft[(size_t) position];
+        const float wetRight = mOutputRight[(size_t) position];
+        mOutputLeft[(size_t) position] = 0.0f;
+        mOutputRight[(size_t) position] = 0.0f;
+
+        left[i] = dryLeft * (1.0f - dryWet) + wetLeft * dryWet;
+        right[i] = dryRight * (1.0f - dryWet) + wetRight * dryWet;
+
+        mFifoPosition = (position + 1) & mask;
+
+        if (++mHopCounter == mHopSize)
+        {
+            mHopCounter = 0;
+            processFrame();
+        }
+    }
+}
+
+void SpectralDelay::processFrame() noexcept
+{
+    const int shapeVersion = mBandShapeVersion.load (std::memory_order_relaxed);
+
+    if (mBinsDirty || shapeVersion != mAppliedBandShapeVersion)
+    {
+        updateBins();
+        mBinsDirty = false;
+        mAppliedBandShapeVersion = shapeVersion;
+    }
+
+    const int mask = mFftSize - 1;
+    const int stride = mBinStride;
+
+    // Oldest sample first: the FIFO position is where the next sample goes
+    for (int k = 0; k < mFftSize; ++k)
+    {
+        const int index = (mFifoPosition + k) & mask;
+        mFftReal[(size_t) k] = mInputLeft[(size_t) index] * mWindow[(size_t) k];
+        mFftImag[(size_t) k] = mInputRight[(size_t) index] * mWindow[(size_t) k];
+    }
+
+    mFft.forward (mFftReal.data(), mFftImag.data());
+
+    float* spectrum = mSpectrum.data();
+    SplitComplexFFT::unpackStereo (mFftReal.data(), mFftImag.data(), mFftSize,
+                                   spectrum, spectrum + stride, spectrum + 2 * stride, spectrum + 3 * stride);
+
+    // Each bin reads its own distance back through the history
+    float* delayed = mDelayed.data();
+
+    for (int b = 0; b < mNumBins; ++b)
+    {
+        int frame = mWriteFrame - mBinDelay[(size_t) b];
+        if (frame < 0)
+            frame += mNumFrames;
+
+        const float* row = getHistoryRow (frame);
+
+        for (int component = 0; component < 4; ++component)
+            delayed[component * stride + b] = row[component * stride + b];
+    }
+
+    float* writeRow = getHistoryRow (mWriteFrame);
+
+    for (int component = 0; component < 4; ++component)
+        multiplyAdd (writeRow + component * stride, spectrum + component * stride, mBinInputGain.data(),
+                     delayed + component * stride, mBinFeedback.data(), mNumBins);
+
+    mWriteFrame = mWriteFrame + 1 < mNumFrames ? mWriteFrame + 1 : 0;
+
+    // The delayed frame is the wet output
+    SplitComplexFFT::packStereo (delayed, delayed + stride, delayed + 2 * stride, delayed + 3 * stride,
+                                 mFftSize, mFftReal.data(), mFftImag.data());
+
+    mFft.inverse (mFftReal.data(), mFftImag.data());
+
+    const float scale = 1.0f / (1.5f * mFftSize);
+
+    for (int k = 0; k < mFftSize; ++k)
+    {
+        const int index = (mFifoPosition + k) & mask;
+        const float window = mWindow[(size_t) k] * scale;
+        mOutputLeft[(size_t) index] += mFftReal[(size_t) k] * window;
+        mOutputRight[(size_t) index] += mFftImag[(size_t) k] * window;
+    }
+}
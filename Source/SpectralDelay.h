@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    SpectralDelay.h
+
+    The spectral engine: an overlap-add STFT whose bins each run through
+    their own delay and feedback, with a freeze that loops what is held.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SplitComplexFFT.h"
+#include "DelayMemoryBlock.h"
+
+//==============================================================================
+/**
+    Both channels go through one complex transform per hop, with 4x overlap
+    and Hann windows on analysis and synthesis. Every bin is delayed by a
+    whole number of hops; the history keeps one row per hop, each row the
+    real and imaginary parts of both channels in separate arrays, so writing
+    a frame is a run of contiguous multiply-adds over the bins.
+
+    The dry signal goes through the same FFT-size delay as the wet one, so the
+    engine's latency is exactly the FFT size whatever the settings. The work
+    per hop is fixed as well: two transforms and a pass over the bins.
+
+    The per-band shape scales the delay time and feedback of NUM_BANDS bands
+    spaced logarithmically from 20 Hz to Nyquist, interpolated across the bins.
+*/
+class SpectralDelay
+{
+public:
+    static const int MIN_FFT_ORDER = 10;     // 1024 samples
+    static const int MAX_FFT_ORDER = 12;     // 4096 samples
+    static const int OVERLAP = 4;
+    static const int NUM_BANDS = 32;
+    static constexpr float MAX_BAND_DELAY_SCALE = 2.0f;
+
+    SpectralDelay();
+
+    /** Allocates the frame history for delays up to maxDelaySeconds at the largest
+        band delay scale. Not audio-thread safe.
+    */
+    void prepare (double sampleRate, int fftOrder, double maxDelaySeconds);
+    void releaseMemory();
+    void reset();
+
+    int getFftSize() const noexcept             { return mFftSize; }
+    int getLatencySamples() const noexcept      { return mFftSize; }
+
+    /** The frame history section visitState reports, a ring of getNumFrames() rows
+        that process() writes one at a time at getWriteFrame().
+    */
+    const void* getHistoryData() const noexcept { return mHistory.getData(); }
+    int getNumFrames() const noexcept           { return mNumFrames; }
+    int getHopSize() const noexcept             { return mHopSize; }
+    int getWriteFrame() const noexcept          { return mWriteFrame; }
+
+    /** Delay and feedback of the whole spectrum, with the cut frequencies rolling the
+        bins outside them off at 12 dB per octave. Freeze stops taking input and
+        loops the held frames unchanged. Audio thread, before process.
+    */
+    void setParameters (float delaySeconds, float feedback, float lowCut, float highCut, bool freeze) noexcept;
+
+    /** Scales one band's delay time (0 to MAX_BAND_DELAY_SCALE) and feedback (0 to 1). Any thread. */
+    void setBandShape (int band, float delayScale, float feedbackScale) noexcept;
+    float getBandDelayScale (int band) const noexcept       { return mBandDelayScale[band]; }
+    float getBandFeedbackScale (int band) const noexcept    { return mBandFeedbackScale[band]; }
+
+    /** Replaces the samples with dry and wet mixed, both delayed by the latency. */
+    void process (float* left, float* right, int numSamples, float dryWet) noexcept;
+
+    /** Calls visit (data, numBytes) for the input and overlap-add buffers, the frame
+        history and the positions in them, see EngineSnapshot. The per-bin settings
+        are rebuilt from the parameters instead.
+    */
+    template <typename Visitor>
+    void visitState (Visitor& visit)
+    {
+        for (auto* buffer : { &mInputLeft, &mInputRight, &mOutputLeft, &mOutputRight })
+            visit (buffer->data(), buffer->size() * sizeof (float));
+
+        visit (mHistory.getData(), mHistory.getData() != nullptr ? mHistory.getSize() : 0);
+        visit (&mFifoPosition, sizeof (mFifoPosition));
+        visit (&mHopCounter, sizeof (mHopCounter));
+        visit (&mWriteFrame, sizeof (mWriteFrame));
+    }
+
+    /** After a restore, whether the positions visitState copied in are inside their buffers. */
+    bool isStateValid() const noexcept;
+
+private:
+    void processFrame() noexcept;
+    void updateBins() noexcept;
+
+    float* getHistoryRow (int frame) const noexcept
+    {
+        return static_cast<float*> (mHistory.getData()) + (size_t) frame * 4 * (size_t) mBinStride;
+    }
+
+    SplitComplexFFT mFft;
+    double mSampleRate;
+    int mFftSize;
+    int mHopSize;
+    int mNumBins;
+    int mBinStride;         // Bins rounded up to a cache line of floats
+    int mNumFrames;
+
+    std::vector<float> mWindow;
+    std::vector<float> mInputLeft, mInputRight;     // Last FFT size of input, also the dry delay
+    std::vector<float> mOutputLeft, mOutputRight;   // Overlap-add accumulators
+    std::vector<float> mFftReal, mFftImag;
+    std::vector<float> mSpectrum;                   // Left real, left imaginary, right real, right imaginary
+    std::vector<float> mDelayed;                    // Same layout, gathered from the history
+    int mFifoPosition;
+    int mHopCounter;
+
+    // Row per hop, laid out as mSpectrum
+    DelayMemoryBlock mHistory;
+    int mWriteFrame;
+
+    // Per-bin settings, rebuilt when the parameters or band shape change
+    std::vector<int> mBinDelay;                     // In hops, 1 to mNumFrames - 1
+    std::vector<float> mBinInputGain;
+    std::vector<float> mBinFeedback;
+    std::vector<int> mBinBand;
+    std::vector<float> mBinBandFraction;
+
+    float mDelaySeconds, mFeedback, mLowCut, mHighCut;
+    bool mFreeze;
+    bool mBinsDirty;
+
+    std::atomic<float> mBandDelayScale[NUM_BANDS];
+    std::atomic<float> mBandFeedbackScale[NUM_BANDS];
+    std::atomic<int> mBandShapeVersion;
+    int mAppliedBandShapeVersion;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralDelay)
+};
@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    SplitComplexFFT.cpp
+
+  ==============================================================================
+*/
+
+#include "SplitComplexFFT.h"
+
+namespace
+{
+    // One span of butterflies: a[k] and b[k] become a[k] + w[k] b[k] and a[k] - w[k] b[k]
+    forcedinline void butterflies (float* __restrict aReal, float* __restrict aImag,
+                                   float* __restrict bReal, float* __restrict bImag,
+                                   const float* __restrict wReal, const float* __restrict wImag, int half) noexcept
+    {
+        for (int k = 0; k < half; ++k)
+        {
+            const float tReal = bReal[k] * wReal[k] - bImag[k] * wImag[k];
+            const float tImag = bReal[k] * wImag[k] + bImag[k] * wReal[k];
+            bReal[k] = aReal[k] - tReal;
+            bImag[k] = aImag[k] - tImag;
+            aReal[k] += tReal;
+            aImag[k] += tImag;
+        }
+    }
+}
+
+//==============================================================================
+SplitComplexFFT::SplitComplexFFT()
+{
+    mSize = 0;
+}
+
+void SplitComplexFFT::prepare (int order)
+{
+    const int size = 1 << order;
+
+    if (size == mSize)
+        return;
+
+    mSize = size;
+    mTwiddleReal.assign ((size_t) size, 0.0f);
+    mTwiddleImag.assign ((size_t) size, 0.0f);
+
+    for (int span = 2; span <= size; span *= 2)
+    {
+        const int half = span / 2;
+
+        for (int k = 0; k < half; ++k)
+        {
+            const double angle = -2.0 * M_PI * k / span;
+            mTwiddleReal[(size_t) (half - 1 + k)] = (float) std::cos (angle);
+            mTwiddleImag[(size_t) (half - 1 + k)] = (float) std::sin (angle);
+        }
+    }
+
+    mSwaps.clear();
+
+    for (int i = 0, j = 0; i < size; ++i)
+    {
+        if (i < j)
+            mSwaps.push_back ({ i, j });
+
+        int bit = size >> 1;
+
+        for (; (j & bit) != 0; bit >>= 1)
+            j ^= bit;
+
+        j |= bit;
+    }
+}
+
+void SplitComplexFFT::reorder (float* real, float* imag) const noexcept
+{
+    for (const auto& swap : mSwaps)
+    {
+        std::swap (real[swap.first], real[swap.second]);
+        std::swap (imag[swap.first], imag[swap.second]);
+    }
+}
+
+void SplitComplexFFT::forward (float* real, float* imag) const noexcept
+{
+    reorder (real, imag);
+
+    for (int span = 2; span <= mSize; span *= 2)
+    {
+        const int half = span / 2;
+        const float* wReal = mTwiddleReal.data() + half - 1;
+        const float* wImag = mTwiddleImag.data() + half - 1;
+
+        for (int start = 0; start < mSize; start += span)
+            butterflies (real + start, imag + start, real + start + half, imag + start + half, wReal, wImag, half);
+    }
+}
+
+void SplitComplexFFT::inverse (float* real, float* imag) const noexcept
+{
+    // Swapping the real and imaginary parts on the way in and out conjugates the transform
+    forward (imag, real);
+}
+
+//==============================================================================
+void SplitComplexFFT::unpackStereo (const float* real, const float* imag, int size,
+                                    float* leftReal, float* leftImag, float* rightReal, float* rightImag) noexcept
+{
+    // With Z the transform of l + i r: L[k] = (Z[k] + conj Z[N - k]) / 2 and R[k] = (Z[k] - conj Z[N - k]) / 2i
+    for (int k = 0; k <= size / 2; ++k)
+    {
+        const int mirror = (size - k) & (size - 1);
+
+        leftReal[k] = 0.5f * (real[k] + real[mirror]);
+        leftImag[k] = 0.5f * (imag[k] - imag[mirror]);
+        rightReal[k] = 0.5f * (imag[k] + imag[mirror]);
+        rightImag[k] = 0.5f * (real[mirror] - real[k]);
+    }
+}
+
+void SplitComplexFFT::packStereo (const float* leftReal, const float* leftImag, const float* rightReal, const float* rightImag,
+                                  int size, float* real, float* imag) noexcept
+{
+    // Y[k] = L[k] + i R[k], and the mirrored bins from the conjugate-symmetric halves
+    for (int k = 0; k <= size / 2; ++k)
+    {
+        real[k] = leftReal[k] - rightImag[k];
+        imag[k] = leftImag[k] + rightReal[k];
+    }
+
+    for (int k = 1; k < size / 2; ++k)
+    {
+        real[size - k] = leftReal[k] + rightImag[k];
+        imag[size - k] = rightReal[k] - leftImag[k];
+    }
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    SplitComplexFFT.h
+
+    In-place radix-2 FFT on split real and imaginary arrays, plus the
+    packing that runs two real channels through one complex transform.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Each stage keeps its twiddle factors in their own contiguous run, so the
+    butterflies of a stage are plain stride-1 loops over non-aliasing arrays
+    that the compiler turns into vector code for whatever the target has.
+
+    Call prepare on the message thread; the transforms never allocate.
+*/
+class SplitComplexFFT
+{
+public:
+    SplitComplexFFT();
+
+    void prepare (int order);
+    int getSize() const noexcept    { return mSize; }
+
+    /** X[k] = sum x[n] e^(-2 pi i k n / N), in place. */
+    void forward (float* real, float* imag) const noexcept;
+
+    /** Unscaled inverse: x[n] = sum X[k] e^(2 pi i k n / N), in place. */
+    void inverse (float* real, float* imag) const noexcept;
+
+    //==============================================================================
+    /** Splits the transform of left + i right into the first N / 2 + 1 bins of each
+        channel's spectrum. The inputs are left untouched.
+    */
+    static void unpackStereo (const float* real, const float* imag, int size,
+                              float* leftReal, float* leftImag, float* rightReal, float* rightImag) noexcept;
+
+    /** The reverse of unpackStereo: builds the full spectrum whose inverse transform
+        has the left channel in its real part and the right one in its imaginary part.
+    */
+    static void packStereo (const float* leftReal, const float* leftImag, const float* rightReal, const float* rightImag,
+                            int size, float* real, float* imag) noexcept;
+
+private:
+    void reorder (float* real, float* imag) const noexcept;
+
+    int mSize;
+    std::vector<float> mTwiddleReal;    // Stage with span s starts at index s / 2 - 1
+    std::vector<float> mTwiddleImag;
+    std::vector<std::pair<int, int>> mSwaps;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SplitComplexFFT)
+};
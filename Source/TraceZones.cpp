@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    TraceZones.cpp
+
+  ==============================================================================
+*/
+
+#include "TraceZones.h"
+
+#if DELAY_TRACING
+
+//==============================================================================
+TraceRecorder& TraceRecorder::getInstance()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+TraceRecorder::TraceRecorder()
+    : mNumRings (juce::jmax ((int) MIN_RINGS, juce::SystemStats::getNumCpus())),
+      mRings (new Ring[(size_t) mNumRings])
+{
+    // Touch every page now, so the first zones on a thread don't fault them in
+    for (int i = 0; i < mNumRings; ++i)
+        mRings[i].events.assign ((size_t) EVENTS_PER_THREAD, Event { "", 0, 0 });
+}
+
+TraceRecorder::Ring* TraceRecorder::getRingForThisThread() noexcept
+{
+    // Hands the ring back when its thread exits
+    struct Claim
+    {
+        Ring* ring = nullptr;
+        bool tried = false;
+
+        ~Claim()
+        {
+            if (ring != nullptr)
+                ring->held.store (false, std::memory_order_release);
+        }
+    };
+
+    thread_local Claim claim;
+
+    if (! claim.tried)
+    {
+        claim.tried = true;
+
+        for (int index = 0; index < mNumRings && claim.ring == nullptr; ++index)
+        {
+            bool held = false;
+
+            if (mRings[index].held.compare_exchange_strong (held, true, std::memory_order_acquire))
+            {
+                claim.ring = &mRings[index];
+
+                int used = mNumUsed.load();
+                while (used <= index && ! mNumUsed.compare_exchange_weak (used, index + 1)) {}
+            }
+        }
+    }
+
+    return claim.ring;
+}
+
+void TraceRecorder::record (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    if (auto* ring = getRingForThisThread())
+    {
+        const auto count = ring->numWritten.load (std::memory_order_relaxed);
+        ring->events[(size_t) (count & (EVENTS_PER_THREAD - 1))] = { name, startTicks, endTicks };
+        ring->numWritten.store (count + 1, std::memory_order_release);
+    }
+}
+
+void TraceRecorder::clear() noexcept
+{
+    for (int i = 0; i < mNumRings; ++i)
+        mRings[i].numWritten = 0;
+}
+
+juce::File TraceRecorder::getDefaultFile()
+{
+    return juce::File::getSpecialLocation (juce::File::tempDirectory).getChildFile ("delay-3-trace.json");
+}
+
+bool TraceRecorder::writeChromeTrace (const juce::File& file) const
+{
+    const int numThreads = mNumUsed.load();
+    const double microsecondsPerTick = 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+
+    // Every ring's oldest surviving event, and the earliest start across them
+    std::vector<juce::int64> firstEvent ((size_t) numThreads);
+    juce::int64 origin = std::numeric_limits<juce::int64>::max();
+
+    for (int thread = 0; thread < numThreads; ++thread)
+    {
+        const auto& ring = mRings[thread];
+        const auto count = ring.numWritten.load (std::memory_order_acquire);
+        firstEvent[(size_t) thread] = std::max ((juce::int64) 0, count - EVENTS_PER_THREAD);
+
+        for (auto i = firstEvent[(size_t) thread]; i < count; ++i)
+            origin = std::min (origin, ring.events[(size_t) (i & (EVENTS_PER_THREAD - 1))].startTicks);
+    }
+
+    juce::String json;
+    json << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    for (int thread = 0; thread < numThreads; ++thread)
+    {
+        const auto& ring = mRings[thread];
+        const auto count = ring.numWritten.load (std::memory_order_acquire);
+
+        json << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << juce::String (thread)
+             << ",\"args\":{\"name\":\"Thread " << juce::String (thread) << "\"}}";
+        first = false;
+
+        for (auto i = firstEvent[(size_t) thread]; i < count; ++i)
+        {
+            const auto& event = ring.events[(size_t) (i & (EVENTS_PER_THREAD - 1))];
+
+            json << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << juce::String (thread)
+                 << ",\"ts\":" << juce::String ((double) (event.startTicks - origin) * microsecondsPerTick, 3)
+                 << ",\"dur\":" << juce::String ((double) (event.endTicks - event.startTicks) * microsecondsPerTick, 3) << "}";
+        }
+    }
+
+    json << "\n]}\n";
+    return file.replaceWithText (json);
+}
+
+#endif
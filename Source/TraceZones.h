@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    TraceZones.h
+
+    Scoped timing zones recorded into a preallocated ring per thread and
+    written out as Chrome trace JSON, for Perfetto or chrome://tracing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Off unless the build defines it, and then every zone compiles to nothing
+#ifndef DELAY_TRACING
+ #define DELAY_TRACING 0
+#endif
+
+#if DELAY_TRACING
+
+//==============================================================================
+/**
+    Each thread that opens a zone claims a free ring on its first zone and
+    gives it back when it exits, so a pool of threads that come and go
+    keeps using the same rings. There is a ring per hardware thread, and at
+    least MIN_RINGS; all of them are allocated together when the recorder
+    is first used, so recording never allocates. A ring keeps the newest
+    EVENTS_PER_THREAD zones and is only ever written by the thread holding
+    it. Threads that held the same ring one after another share its track.
+    Zone names must be string literals, since only the pointer is stored.
+
+    Write the trace once the traced threads are idle, at the end of an
+    offline render for instance: events still being written are not
+    synchronised with the reader.
+*/
+class TraceRecorder
+{
+public:
+    static const int MIN_RINGS = 8;
+    static const int EVENTS_PER_THREAD = 1 << 16;
+
+    static TraceRecorder& getInstance();
+
+    /** Records a finished zone for the calling thread. Dropped if every ring is held by a running thread. */
+    void record (const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    /** Writes every recorded zone, oldest first, with times relative to the earliest. */
+    bool writeChromeTrace (const juce::File& file) const;
+
+    /** delay-3-trace.json in the temp folder, where the processor leaves its trace. */
+    static juce::File getDefaultFile();
+
+    /** Forgets all recorded zones; threads keep their rings. */
+    void clear() noexcept;
+
+    /** Rings threads can hold at once. */
+    int getNumRings() const noexcept    { return mNumRings; }
+
+private:
+    TraceRecorder();
+
+    struct Event
+    {
+        const char* name;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    struct Ring
+    {
+        std::vector<Event> events;
+        std::atomic<juce::int64> numWritten { 0 };
+        std::atomic<bool> held { false };
+    };
+
+    Ring* getRingForThisThread() noexcept;
+
+    const int mNumRings;
+    std::unique_ptr<Ring[]> mRings;
+    std::atomic<int> mNumUsed { 0 };    // Rings below this have been held
+
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
+
+/** Times the enclosing scope. Use through DELAY_TRACE_ZONE. */
+class ScopedTraceZone
+{
+public:
+    explicit ScopedTraceZone (const char* name) noexcept
+        : mName (name), mStartTicks (juce::Time::getHighResolutionTicks()) {}
+
+    ~ScopedTraceZone() noexcept
+    {
+        TraceRecorder::getInstance().record (mName, mStartTicks, juce::Time::getHighResolutionTicks());
+    }
+
+private:
+    const char* mName;
+    juce::int64 mStartTicks;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedTraceZone)
+};
+
+ #define DELAY_TRACE_ZONE_NAME2(line) traceZone##line
+ #define DELAY_TRACE_ZONE_NAME(line) DELAY_TRACE_ZONE_NAME2 (line)
+ #define DELAY_TRACE_ZONE(name) const ScopedTraceZone DELAY_TRACE_ZONE_NAME (__LINE__) (name)
+
+#else
+
+ #define DELAY_TRACE_ZONE(name)
+
+#endif
@@ -0,0 +1,359 @@
+/*
+  ==============================================================================
+
+    GoldenRenders.cpp
+
+  ==============================================================================
+*/
+
+#include "GoldenRenders.h"
+
+//==============================================================================
+juce::Array<GoldenRenders::Case> GoldenRenders::getCases()
+{
+    using TestSignals::setParameter;
+    juce::Array<Case> cases;
+
+    // Each golden file is the render from when its case was added, rendered again only
+    // where the sound was meant to change: the control-rate modulation and the Schroeder
+    // diffusion for every case of the lines, taking the oversampler's delay off the
+    // feedback loop for high-tier, true peaks at 8x for limiter and damping once per
+    // channel for damped
+
+    cases.add ({ "default-48k", 48000.0, [] (DelaytutorialAudioProcessor&) {} });
+    cases.add ({ "default-96k", 96000.0, [] (DelaytutorialAudioProcessor&) {} });
+
+    // Under 25 ms the delay time is tripled
+    cases.add ({ "short-delay-44k", 44100.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.015f);
+    } });
+
+    cases.add ({ "high-feedback", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "feedback", 0.95f);
+        setParameter (p, "delaytime", 0.12f);
+    } });
+
+    cases.add ({ "modulated", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        setParameter (p, "lforate", 5.0f);
+        setParameter (p, "lfodepth", 0.1f);
+        setParameter (p, "lfophase", 0.5f);
+    } });
+
+    cases.add ({ "damped", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        setParameter (p, "lowcut", 400.0f);
+        setParameter (p, "highcut", 2500.0f);
+    } });
+
+    cases.add ({ "eco-tier", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        p.setQualityTier (QualityTier::eco);
+    } });
+
+    cases.add ({ "high-tier", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        p.setQualityTier (QualityTier::high);
+    } });
+
+    cases.add ({ "spectral", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        p.setDelayEngine (DelaytutorialAudioProcessor::DelayEngine::spectral);
+    } });
+
+    cases.add ({ "multi-tap", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            MultiTapDelay::Tap tap;
+            tap.delaySeconds = 0.07f * (float) (i + 1);
+            tap.gain = 0.5f / (float) (i + 1);
+            tap.pan = i % 2 == 0 ? -0.6f : 0.6f;
+            tap.highCut = 3000.0f + 4000.0f * (float) i;
+            p.setTap (i, tap);
+        }
+
+        p.setMultiTap (true);
+    } });
+
+    // Grains start on chunk boundaries counted across blocks, so every block size matches
+    cases.add ({ "granular", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+
+        GranularCloud::Settings grains;
+        grains.pitchSpread = 3.0f;
+        p.setGranularSettings (grains);
+        p.setGranular (true);
+    } });
+
+    cases.add ({ "limiter", 48000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "feedback", 0.95f);
+        setParameter (p, "delaytime", 0.12f);
+        p.setOutputLimiter (true);
+    } });
+
+    // The engine at 48 kHz between the resamplers
+    cases.add ({ "fixed-rate-96k", 96000.0, [] (DelaytutorialAudioProcessor& p) {
+        setParameter (p, "delaytime", 0.2f);
+        p.setFixedInternalRate (true);
+    } });
+
+    return cases;
+}
+
+juce::Array<GoldenRenders::Variant> GoldenRenders::getVariants()
+{
+    juce::Array<Variant> variants;
+    const auto always = [] (DelaytutorialAudioProcessor&, const Case&) { return true; };
+
+    variants.add ({ "portable, 512 samples", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE, always });
+    variants.add ({ "portable, 64 samples", KernelDispatch::Variant::portable, 64, always });
+    variants.add ({ "portable, 333 samples", KernelDispatch::Variant::portable, 333, always });
+
+    for (auto kernels : { KernelDispatch::Variant::avx2, KernelDispatch::Variant::avx512 })
+        if (KernelDispatch::isSupported (kernels))
+            variants.add ({ juce::String (KernelDispatch::get (kernels).name) + ", 512 samples", kernels, REFERENCE_BLOCK_SIZE, always });
+
+    variants.add ({ "interleaved", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case&) {
+        p.setInterleavedDelayBuffers (true);
+        return true;
+    } });
+
+    // The fixed rate is the host rate here, so nothing is resampled. The fixed-rate case
+    // covers the resampling
+    variants.add ({ "fixed internal rate", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case& testCase) {
+        if (testCase.sampleRate != DelaytutorialAudioProcessor::INTERNAL_SAMPLE_RATE)
+            return false;
+
+        p.setFixedInternalRate (true);
+        return true;
+    } });
+
+    variants.add ({ "float16 storage", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case&) {
+        p.setDelayStorageFormat (DelayLineStorage::Format::float16);
+        return true;
+    }, 0.01f });
+
+    variants.add ({ "int16 storage", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case&) {
+        p.setDelayStorageFormat (DelayLineStorage::Format::int16);
+        return true;
+    }, 0.01f });
+
+    // Long-delay mode over the normal range times and reads the lines in double precision.
+    // The octave lines read at twice and half the write position, which float rounds to a
+    // 64th of a sample, so they move the most
+    variants.add ({ "double precision", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case&) {
+        p.setLongDelayMode (true, MAX_DELAY_TIME);
+        return true;
+    }, 0.08f });
+
+    // Over a longer range the same delay time is further down the parameter, found once
+    // prepare has settled the range. The spectral engine keeps the normal range
+    variants.add ({ "long-delay", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case& testCase) {
+        const float delaySeconds = TestSignals::getParameter (p, "delaytime");
+        p.setLongDelayMode (true, LONG_DELAY_SECONDS);
+        p.setPlayConfigDetails (2, 2, testCase.sampleRate, REFERENCE_BLOCK_SIZE);
+        p.prepareToPlay (testCase.sampleRate, REFERENCE_BLOCK_SIZE);
+
+        if (p.getDelayEngine() == DelaytutorialAudioProcessor::DelayEngine::spectral)
+            return false;
+
+        float low = 0.0f, high = delaySeconds;
+
+        for (int i = 0; i < 40; ++i)
+        {
+            const float middle = 0.5f * (low + high);
+            (p.getDelaySeconds (middle) < delaySeconds ? low : high) = middle;
+        }
+
+        TestSignals::setParameter (p, "delaytime", 0.5f * (low + high));
+        return true;
+    }, 0.08f });
+
+    // The high tier's saturation and cubic reads on a normal tier case. The half-band
+    // filters delay the wet signal by a couple of samples, so this only catches an
+    // oversampler that has gone silent or unstable; the high-tier case checks it closely
+    variants.add ({ "oversampled", KernelDispatch::Variant::portable, REFERENCE_BLOCK_SIZE,
+                    [] (DelaytutorialAudioProcessor& p, const Case&) {
+        if (p.getQualityTier() != QualityTier::normal)
+            return false;
+
+        p.setQualityTier (QualityTier::high);
+        return true;
+    }, 0.15f });
+
+    return variants;
+}
+
+//==============================================================================
+GoldenRenders::GoldenRenders (const juce::File& folder)
+    : mFolder (folder)
+{
+    mFormats.registerBasicFormats();
+}
+
+bool GoldenRenders::update()
+{
+    if (! mFolder.createDirectory())
+    {
+        std::cerr << "Can't create " << mFolder.getFullPathName() << std::endl;
+        return false;
+    }
+
+    const auto variant = getVariants().getFirst();
+
+    for (const auto& testCase : getCases())
+    {
+        const auto reference = render (testCase, variant);
+        const int length = reference.output.getNumSamples() - reference.latency;
+        const juce::File file = getGoldenFile (testCase);
+        file.deleteFile();
+
+        std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        if (stream != nullptr && stream->openedOk())
+            writer.reset (juce::WavAudioFormat().createWriterFor (stream.get(), testCase.sampleRate, 2, 32, {}, 0));
+
+        if (writer == nullptr)
+        {
+            std::cerr << "Can't write " << file.getFullPathName() << std::endl;
+            return false;
+        }
+
+        stream.release();   // The writer owns it now
+
+        if (! writer->writeFromAudioSampleBuffer (reference.output, 0, length))
+        {
+            std::cerr << "Can't write " << file.getFullPathName() << std::endl;
+            return false;
+        }
+
+        std::cout << file.getFullPathName() << std::endl;
+    }
+
+    return true;
+}
+
+bool GoldenRenders::check()
+{
+    const auto variants = getVariants();
+    int numFailed = 0;
+
+   #if defined (__FAST_MATH__) || defined (_M_FP_FAST)
+    const float buildRmsTolerance = FAST_MATH_RMS_TOLERANCE;
+    std::cout << "Fast-math build, checking the RMS difference of every variant" << std::endl;
+   #else
+    const float buildRmsTolerance = 0.0f;
+   #endif
+
+    for (const auto& testCase : getCases())
+    {
+        const juce::File file = getGoldenFile (testCase);
+        std::unique_ptr<juce::AudioFormatReader> reader (mFormats.createReaderFor (file));
+
+        if (reader == nullptr || reader->numChannels != 2 || reader->sampleRate != testCase.sampleRate)
+        {
+            std::cout << "FAIL " << testCase.name << ": no usable " << file.getFullPathName()
+                      << ", run --golden --update to write it" << std::endl;
+            ++numFailed;
+            continue;
+        }
+
+        juce::AudioBuffer<float> golden (2, (int) reader->lengthInSamples);
+        reader->read (&golden, 0, golden.getNumSamples(), 0, true, true);
+
+        double referenceSeconds = 0.0;
+        int referenceLatency = 0;
+
+        for (const auto& variant : variants)
+        {
+            const auto result = render (testCase, variant);
+
+            if (result.output.getNumSamples() == 0)
+                continue;
+
+            if (&variant == &variants.getReference (0))
+            {
+                referenceSeconds = result.seconds;
+                referenceLatency = result.latency;
+            }
+
+            // Lined up with the reference, whatever latency the variant adds
+            const int offset = result.latency - referenceLatency;
+            const int length = result.output.getNumSamples() - result.latency;
+            const bool sameLength = offset >= 0 && length == golden.getNumSamples();
+            juce::AudioBuffer<float> aligned (2, golden.getNumSamples());
+
+            if (sameLength)
+                for (int channel = 0; channel < 2; ++channel)
+                    aligned.copyFrom (channel, 0, result.output, channel, offset, length);
+
+            const auto difference = sameLength ? TestSignals::compare (aligned, golden) : TestSignals::Difference();
+            const float rmsTolerance = variant.rmsTolerance + buildRmsTolerance;
+            const bool close = rmsTolerance > 0.0f ? difference.rmsDifference <= rmsTolerance
+                                                   : difference.maxDifference <= testCase.tolerance;
+            const bool passed = sameLength && close;
+
+            std::cout << (passed ? "ok   " : "FAIL ") << testCase.name << " (" << variant.name << "): ";
+
+            if (sameLength)
+                std::cout << "max difference " << juce::String (difference.maxDifference, 8) << " at sample "
+                          << difference.sample << " of channel " << difference.channel
+                          << ", RMS " << juce::String (difference.rmsDifference, 8);
+            else
+                std::cout << "length " << length << " instead of " << golden.getNumSamples();
+
+            std::cout << ", " << juce::String (referenceSeconds / juce::jmax (result.seconds, 1.0e-9), 2)
+                      << "x the portable speed" << std::endl;
+
+            if (! passed)
+                ++numFailed;
+        }
+    }
+
+    KernelDispatch::clearOverride();
+    std::cout << (numFailed == 0 ? "All golden renders match" : juce::String (numFailed) + " golden renders failed") << std::endl;
+    return numFailed == 0;
+}
+
+//==============================================================================
+GoldenRenders::Render GoldenRenders::render (const Case& testCase, const Variant& variant) const
+{
+    KernelDispatch::setOverride (variant.kernels);
+
+    DelaytutorialAudioProcessor processor;
+    testCase.configure (processor);
+
+    Render result;
+
+    if (! variant.configure (processor, testCase))
+        return result;
+
+    // The latency is only known once prepared, and the input runs on for that long
+    processor.setPlayConfigDetails (2, 2, testCase.sampleRate, variant.blockSize);
+    processor.prepareToPlay (testCase.sampleRate, variant.blockSize);
+    result.latency = processor.getLatencySamples();
+
+    const auto input = TestSignals::makeReferenceInput (testCase.sampleRate, RENDER_SECONDS);
+    juce::AudioBuffer<float> padded (2, input.getNumSamples() + result.latency);
+    padded.clear();
+
+    for (int channel = 0; channel < 2; ++channel)
+        padded.copyFrom (channel, 0, input, channel, 0, input.getNumSamples());
+
+    result.output = TestSignals::render (processor, padded, testCase.sampleRate, variant.blockSize, &result.seconds);
+    return result;
+}
+
+juce::File GoldenRenders::getGoldenFile (const Case& testCase) const
+{
+    return mFolder.getChildFile (testCase.name + ".wav");
+}
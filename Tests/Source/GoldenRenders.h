@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    GoldenRenders.h
+
+    Renders of fixed inputs and parameter sets, checked against the golden
+    files committed under Tests/Golden.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Each case renders TestSignals::makeReferenceInput at one sample rate and
+    one parameter set. The golden file is the portable kernel build at
+    REFERENCE_BLOCK_SIZE, stored as 32-bit float WAV. The check renders that
+    again, then every variant: the other kernel builds this CPU runs, other
+    block sizes, interleaved delay buffers, half-float and 16-bit storage,
+    double precision delay times, long-delay mode, the fixed internal rate
+    and the oversampled saturation. Each must come within its tolerance of
+    the golden file, after taking off any latency the variant adds. It
+    reports the speed of each variant against the portable build.
+
+    Fast-math is a build setting, so a build with it (the Xcode FastMath
+    configuration, or CXXFLAGS=-ffast-math with the Makefile) checks every
+    variant on its RMS difference, with FAST_MATH_RMS_TOLERANCE on top.
+*/
+class GoldenRenders
+{
+public:
+    static const int REFERENCE_BLOCK_SIZE = 512;
+    static constexpr double RENDER_SECONDS = 0.6;
+    static constexpr double LONG_DELAY_SECONDS = 120.0;
+    static constexpr float FAST_MATH_RMS_TOLERANCE = 0.04f;
+
+    struct Case
+    {
+        juce::String name;
+        double sampleRate;
+        std::function<void (DelaytutorialAudioProcessor&)> configure;
+        float tolerance = 1.0e-4f;          // About -80 dBFS
+    };
+
+    static juce::Array<Case> getCases();
+
+    /** A way of running a case that should sound the same as the reference. */
+    struct Variant
+    {
+        juce::String name;
+        KernelDispatch::Variant kernels = KernelDispatch::Variant::portable;
+        int blockSize = REFERENCE_BLOCK_SIZE;
+
+        /** Runs after the case's configure. False if the variant doesn't apply to the case. */
+        std::function<bool (DelaytutorialAudioProcessor&, const Case&)> configure;
+
+        /** Zero for a variant that must match the golden file within the case's tolerance.
+            Otherwise the RMS difference it may have: the lines saturate in steps, at a
+            third and two thirds of full scale, so the smallest change of level turns a few
+            samples into clicks and only the RMS difference says how close the rest is.
+        */
+        float rmsTolerance = 0.0f;
+    };
+
+    /** The reference first, then the variants this CPU runs. */
+    static juce::Array<Variant> getVariants();
+
+    explicit GoldenRenders (const juce::File& folder);
+
+    /** Renders the reference of every case and writes its golden file. */
+    bool update();
+
+    /** Renders every case and variant and compares it with the golden file,
+        printing a line for each. True if all of them passed.
+    */
+    bool check();
+
+private:
+    struct Render
+    {
+        juce::AudioBuffer<float> output;    // Longer than the input by the latency
+        int latency = 0;
+        double seconds = 0.0;
+    };
+
+    /** Nothing in output if the variant doesn't apply to the case. */
+    Render render (const Case& testCase, const Variant& variant) const;
+    juce::File getGoldenFile (const Case& testCase) const;
+
+    juce::File mFolder;
+    juce::AudioFormatManager mFormats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GoldenRenders)
+};
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    InstanceBenchmarks.cpp
+
+  ==============================================================================
+*/
+
+#include "InstanceBenchmarks.h"
+#include <thread>
+
+namespace
+{
+    /** Spins until every thread has arrived, then lets them all go at once. */
+    class Barrier
+    {
+    public:
+        explicit Barrier (int numThreads) : mNumThreads (numThreads) {}
+
+        void arriveAndWait() noexcept
+        {
+            const int generation = mGeneration.load (std::memory_order_acquire);
+
+            if (mArrived.fetch_add (1, std::memory_order_acq_rel) + 1 == mNumThreads)
+            {
+                mArrived.store (0, std::memory_order_relaxed);
+                mGeneration.fetch_add (1, std::memory_order_release);
+                return;
+            }
+
+            while (mGeneration.load (std::memory_order_acquire) == generation)
+                std::this_thread::yield();
+        }
+
+    private:
+        const int mNumThreads;
+        alignas (64) std::atomic<int> mArrived { 0 };
+        alignas (64) std::atomic<int> mGeneration { 0 };
+    };
+
+    struct Result
+    {
+        double realtimeFactor = 0.0;
+        double instancesPerCore = 0.0;
+        double p50 = 0.0, p99 = 0.0, p999 = 0.0;    // Seconds per instance-block
+    };
+
+    double getPercentile (std::vector<double>& times, double fraction)
+    {
+        const size_t index = std::min (times.size() - 1, (size_t) (fraction * (double) times.size()));
+        std::nth_element (times.begin(), times.begin() + (std::ptrdiff_t) index, times.end());
+        return times[index];
+    }
+
+    Result measure (int numInstances, int numThreads, int blockSize, bool sparse)
+    {
+        numThreads = std::min (numThreads, numInstances);
+
+        juce::OwnedArray<DelaytutorialAudioProcessor> processors;
+        juce::OwnedArray<juce::AudioBuffer<float>> blocks;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            auto* processor = processors.add (new DelaytutorialAudioProcessor());
+            TestSignals::setParameter (*processor, "delaytime", 0.05f + 0.3f * (float) (i % 7) / 7.0f);
+            TestSignals::setParameter (*processor, "lfodepth", 0.1f);
+            processor->setOnDemandMemory (sparse);
+            processor->setPlayConfigDetails (2, 2, InstanceBenchmarks::SAMPLE_RATE, blockSize);
+            processor->prepareToPlay (InstanceBenchmarks::SAMPLE_RATE, blockSize);
+            blocks.add (new juce::AudioBuffer<float> (2, blockSize));
+        }
+
+        const int numCycles = std::max (1, (int) (InstanceBenchmarks::AUDIO_SECONDS * InstanceBenchmarks::SAMPLE_RATE / blockSize));
+        const auto input = TestSignals::makeReferenceInput (InstanceBenchmarks::SAMPLE_RATE, numCycles * blockSize / InstanceBenchmarks::SAMPLE_RATE);
+
+        std::vector<std::vector<double>> times ((size_t) numThreads);
+        Barrier barrier (numThreads);
+
+        auto runThread = [&] (int thread)
+        {
+            juce::MidiBuffer midi;
+            auto& threadTimes = times[(size_t) thread];
+            threadTimes.reserve ((size_t) (numCycles * (numInstances / numThreads + 1)));
+
+            for (int cycle = 0; cycle < numCycles; ++cycle)
+            {
+                for (int i = thread; i < numInstances; i += numThreads)
+                {
+                    auto& block = *blocks[i];
+                    const bool sounding = ! sparse || i % InstanceBenchmarks::SPARSE_INTERVAL == 0;
+
+                    for (int channel = 0; channel < 2; ++channel)
+                    {
+                        if (sounding)
+                            block.copyFrom (channel, 0, input, channel, cycle * blockSize, blockSize);
+                        else
+                            block.clear (channel, 0, blockSize);
+                    }
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    processors[i]->processBlock (block, midi);
+                    threadTimes.push_back (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+                }
+
+                barrier.arriveAndWait();
+            }
+        };
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        std::vector<std::thread> threads;
+        std::atomic<int> numFinished { 0 };
+
+        for (int thread = 0; thread < numThreads; ++thread)
+            threads.emplace_back ([&, thread] { runThread (thread); ++numFinished; });
+
+        // This is the message thread, where the memory pool refills on a timer
+        while (numFinished < numThreads)
+            juce::MessageManager::getInstance()->runDispatchLoopUntil (2);
+
+        for (auto& thread : threads)
+            thread.join();
+
+        const double wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+
+        for (auto* processor : processors)
+            processor->releaseResources();
+
+        std::vector<double> allTimes;
+
+        for (auto& threadTimes : times)
+            allTimes.insert (allTimes.end(), threadTimes.begin(), threadTimes.end());
+
+        const double audioSeconds = numCycles * blockSize / InstanceBenchmarks::SAMPLE_RATE;
+        double busySeconds = 0.0;
+
+        for (double time : allTimes)
+            busySeconds += time;
+
+        Result result;
+        result.realtimeFactor = audioSeconds * numInstances / wallSeconds;
+        result.instancesPerCore = audioSeconds * numInstances / busySeconds;
+        result.p50 = getPercentile (allTimes, 0.5);
+        result.p99 = getPercentile (allTimes, 0.99);
+        result.p999 = getPercentile (allTimes, 0.999);
+        return result;
+    }
+}
+
+//==============================================================================
+juce::Array<int> InstanceBenchmarks::getThreadCounts (int maxThreads)
+{
+    juce::Array<int> counts;
+
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        counts.add (threads);
+
+    counts.add (maxThreads);
+    return counts;
+}
+
+void InstanceBenchmarks::run (int maxThreads)
+{
+    std::cout << juce::String ("session").paddedRight (' ', 10) << juce::String ("instances").paddedLeft (' ', 10)
+              << juce::String ("threads").paddedLeft (' ', 8) << juce::String ("block").paddedLeft (' ', 6)
+              << juce::String ("x realtime").paddedLeft (' ', 12) << juce::String ("per core").paddedLeft (' ', 10)
+              << juce::String ("p50 us").paddedLeft (' ', 10) << juce::String ("p99 us").paddedLeft (' ', 10)
+              << juce::String ("p99.9 us").paddedLeft (' ', 10) << juce::String ("vs alone").paddedLeft (' ', 10) << std::endl;
+
+    for (int blockSize : BLOCK_SIZES)
+    {
+        const double alone = measure (1, 1, blockSize, false).p50;
+
+        for (bool sparse : { false, true })
+        {
+            for (int numInstances : INSTANCE_COUNTS)
+            {
+                for (int threads : getThreadCounts (maxThreads))
+                {
+                    // More threads than instances would leave some idle
+                    if (threads > numInstances)
+                        break;
+
+                    const Result result = measure (numInstances, threads, blockSize, sparse);
+
+                    std::cout << juce::String (sparse ? "sparse" : "dense").paddedRight (' ', 10)
+                              << juce::String (numInstances).paddedLeft (' ', 10) << juce::String (threads).paddedLeft (' ', 8)
+                              << juce::String (blockSize).paddedLeft (' ', 6)
+                              << juce::String (result.realtimeFactor, 1).paddedLeft (' ', 12)
+                              << juce::String (result.instancesPerCore, 1).paddedLeft (' ', 10)
+                              << juce::String (result.p50 * 1.0e6, 1).paddedLeft (' ', 10)
+                              << juce::String (result.p99 * 1.0e6, 1).paddedLeft (' ', 10)
+                              << juce::String (result.p999 * 1.0e6, 1).paddedLeft (' ', 10)
+                              << juce::String (result.p50 / alone, 2).paddedLeft (' ', 10) << std::endl;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    InstanceBenchmarks.h
+
+    Many processor instances run side by side on a few threads, the way a
+    host's graph runs a session full of delays.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    N instances are dealt out over K threads, for K from 1 doubling up to
+    the number of cores, and never more threads than instances. Each cycle every thread runs
+    one block through each of its instances, then waits for the others at a
+    barrier, like a graph scheduler in lock step. Every instance-block is
+    timed on its own. The main thread meanwhile runs the message loop, as a
+    host's would.
+
+    A row shows:
+    - throughput as times faster than real time, over all instances
+    - the instances one core could keep up with in real time
+    - the 50th, 99th and 99.9th percentiles of the instance-block times
+    - interference: the median against one instance running alone on one
+      thread at the same block size
+
+    The "sparse" rows use on-demand memory with one instance in eight fed
+    any input, as in a large session where most delays are idle.
+*/
+class InstanceBenchmarks
+{
+public:
+    static constexpr int BLOCK_SIZES[] = { 64, 256, 1024 };
+    static constexpr int INSTANCE_COUNTS[] = { 1, 8, 64 };
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr double AUDIO_SECONDS = 0.5;
+    static const int SPARSE_INTERVAL = 8;
+
+    /** Prints one row per instance count, thread count, block size and kind of session,
+        with up to maxThreads threads.
+    */
+    static void run (int maxThreads);
+
+    /** 1, 2, 4 and so on below maxThreads, then maxThreads. */
+    static juce::Array<int> getThreadCounts (int maxThreads);
+};
@@ -0,0 +1,464 @@
+/*
+  ==============================================================================
+
+    KernelBenchmarks.cpp
+
+  ==============================================================================
+*/
+
+#include "KernelBenchmarks.h"
+#include "../../Source/CoefficientDesigner.h"
+#include "../../Source/DelayKernels.h"
+#include "../../Source/DiffusionNetwork.h"
+#include "../../Source/DelayLineStorage.h"
+#include "../../Source/GranularCloud.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    const int MAX_BLOCK_SIZE = 1024;
+    const int BUFFER_LENGTH = 1 << 16;
+
+    volatile float sink;    // Keeps the compiler from dropping the work
+
+    juce::int64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return (juce::int64) __rdtsc();
+       #else
+        return 0;
+       #endif
+    }
+
+    /** Linear buffer reads go through this, as DelayLineStorage::read does. */
+    struct PlainBuffer
+    {
+        const float* data;
+        float read (int position) const noexcept   { return data[position]; }
+    };
+
+    /** Times body (numSamples), which processes numSamples samples and returns one of them. */
+    template <typename Body>
+    void measure (const char* name, const char* build, int numSamples, Body&& body)
+    {
+        // Calibrate the number of calls per measurement
+        int numCalls = 1;
+
+        for (;;)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int call = 0; call < numCalls; ++call)
+                sink = body (numSamples);
+
+            if (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) >= KernelBenchmarks::MEASUREMENT_SECONDS
+                 || numCalls >= (1 << 26))
+                break;
+
+            numCalls *= 2;
+        }
+
+        double bestSeconds = std::numeric_limits<double>::max();
+        juce::int64 bestCycles = std::numeric_limits<juce::int64>::max();
+
+        for (int i = 0; i < KernelBenchmarks::NUM_MEASUREMENTS; ++i)
+        {
+            const auto startCycles = readCycleCounter();
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int call = 0; call < numCalls; ++call)
+                sink = body (numSamples);
+
+            bestSeconds = juce::jmin (bestSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+            bestCycles = juce::jmin (bestCycles, readCycleCounter() - startCycles);
+        }
+
+        const double samples = (double) numCalls * numSamples;
+
+        std::cout << juce::String (name).paddedRight (' ', 24) << juce::String (build).paddedRight (' ', 10)
+                  << juce::String (numSamples).paddedLeft (' ', 6)
+                  << juce::String (bestSeconds * 1.0e9 / samples, 3).paddedLeft (' ', 12)
+                  << (JUCE_INTEL ? juce::String ((double) bestCycles / samples, 2) : juce::String ("-")).paddedLeft (' ', 12)
+                  << std::endl;
+    }
+
+    juce::HeapBlock<float> makeNoise (int length, juce::int64 seed)
+    {
+        juce::HeapBlock<float> samples (length);
+        juce::Random random (seed);
+
+        for (int i = 0; i < length; ++i)
+            samples[i] = random.nextFloat() * 2.0f - 1.0f;
+
+        return samples;
+    }
+
+    //==============================================================================
+    void runInlineKernels (int blockSize)
+    {
+        const auto buffer = makeNoise (BUFFER_LENGTH, 1);
+        juce::HeapBlock<float> out (MAX_BLOCK_SIZE + 4);
+        int position = 0;
+
+        // Readers walk the buffer like a read head, a little under one sample per sample
+        measure ("readInterpolated", "inline", blockSize, [&] (int n) {
+            float readHead = (float) position;
+            for (int i = 0; i < n; ++i, readHead += 0.9993f)
+                out[i] = DelayKernels::readInterpolated (buffer, BUFFER_LENGTH, readHead);
+            position = (position + n) & (BUFFER_LENGTH - 1);
+            return out[0];
+        });
+
+        measure ("interpolateFixedPhase", "inline", blockSize, [&] (int n) {
+            DelayKernels::interpolateFixedPhase (buffer + (position & (BUFFER_LENGTH / 2 - 1)), 0.37f, out, n);
+            position += n;
+            return out[0];
+        });
+
+        measure ("hermiteFixedPhase", "inline", blockSize, [&] (int n) {
+            DelayKernels::hermiteFixedPhase (buffer + (position & (BUFFER_LENGTH / 2 - 1)), 0.37f, out, n);
+            position += n;
+            return out[0];
+        });
+
+        measure ("softClip", "inline", blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+                out[i] = DelayKernels::softClip (2.0f * in[i]);
+            position += n;
+            return out[0];
+        });
+
+        measure ("tanh", "inline", blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+                out[i] = std::tanh (2.0f * in[i]);
+            position += n;
+            return out[0];
+        });
+
+        // The engine's own matrix, mixed once per channel and sample as in processBlock, over
+        // fresh line outputs each time, since mixing its own output would decay into denormals
+        EngineCoefficients coefficients;
+        EngineCoefficients::design ({ 48000.0, DampingFilterBank::MIN_LOW_CUT, DampingFilterBank::MAX_HIGH_CUT }, coefficients);
+
+        const int numLines = EngineCoefficients::NUM_LINES;
+        float mixedLeft[numLines], mixedRight[numLines];
+
+        measure ("mixFeedbackMatrix", "inline", blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+            {
+                DelayKernels::mixFeedbackMatrix (&coefficients.feedbackMatrix[0][0], numLines, in + i, mixedLeft);
+                DelayKernels::mixFeedbackMatrix (&coefficients.feedbackMatrix[0][0], numLines, in + i + numLines, mixedRight);
+                out[i] = mixedLeft[0] + mixedRight[numLines - 1];
+            }
+            position += n;
+            return out[0];
+        });
+
+        float lastInput = 0.0f, lastOutput = 0.0f, dcState = 0.0f;
+
+        measure ("inputDcBlock", "inline", blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+                out[i] = DelayKernels::inputDcBlock (in[i], lastInput, lastOutput, 0.995f, 0.9f);
+            position += n;
+            return out[0];
+        });
+
+        measure ("outputDcBlock", "inline", blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+                out[i] = DelayKernels::outputDcBlock (in[i], dcState, 0.995f);
+            position += n;
+            return out[0];
+        });
+
+        float lfoPhase = 0.0f;
+
+        measure ("raisedCosineLfo", "inline", blockSize, [&] (int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                out[i] = DelayKernels::raisedCosineLfo (lfoPhase);
+                lfoPhase += 1.0e-4f;
+                if (lfoPhase >= 1.0f)
+                    lfoPhase -= 1.0f;
+            }
+            return out[0];
+        });
+
+        // Eight taps spread over the buffer, all updated every sample
+        const int numTaps = 8;
+        int tapDelays[numTaps];
+        float tapCoeffs[numTaps], tapStates[numTaps] = {};
+
+        for (int i = 0; i < numTaps; ++i)
+        {
+            tapDelays[i] = 1500 + 2311 * i;
+            tapCoeffs[i] = 0.2f + 0.05f * (float) i;
+        }
+
+        const PlainBuffer plain { buffer };
+
+        measure ("processReflectionTaps", "inline", blockSize, [&] (int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                DelayKernels::processReflectionTaps (plain, BUFFER_LENGTH, position, tapDelays, tapCoeffs, tapStates, numTaps);
+                position = (position + 1) & (BUFFER_LENGTH - 1);
+            }
+            return tapStates[0];
+        });
+    }
+
+    //==============================================================================
+    bool runDispatchedKernels (KernelDispatch::Variant variant, int blockSize)
+    {
+        const auto& kernels = KernelDispatch::get (variant);
+        const auto buffer = makeNoise (BUFFER_LENGTH, 2);
+        juce::HeapBlock<float> out (MAX_BLOCK_SIZE + 4);
+        int position = 0;
+
+        // Saturation and the four-stage all-pass cascade of all eight lanes, per sample
+        DiffusionNetwork diffusion;
+        diffusion.prepare (48000.0);
+        diffusion.setKernels (kernels);
+        float lanes[KernelDispatch::NUM_LANES];
+
+        measure ("processLines (all-pass)", kernels.name, blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+            {
+                for (int lane = 0; lane < KernelDispatch::NUM_LANES; ++lane)
+                    lanes[lane] = in[i] * (0.6f + 0.05f * (float) lane);
+                diffusion.process (lanes, 0.5f);
+            }
+            position += n;
+            return lanes[0];
+        });
+
+        float ic1[KernelDispatch::NUM_LANES] = {}, ic2[KernelDispatch::NUM_LANES] = {};
+
+        measure ("svfHighCut", kernels.name, blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+            {
+                std::fill (lanes, lanes + KernelDispatch::NUM_LANES, in[i]);
+                kernels.svfHighCut (lanes, ic1, ic2, 0.8f, 0.3f, 0.1f);
+            }
+            position += n;
+            return lanes[0];
+        });
+
+        measure ("svfLowCut", kernels.name, blockSize, [&] (int n) {
+            const float* in = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            for (int i = 0; i < n; ++i)
+            {
+                std::fill (lanes, lanes + KernelDispatch::NUM_LANES, in[i]);
+                kernels.svfLowCut (lanes, ic1, ic2, 1.4f, 0.8f, 0.3f, 0.1f);
+            }
+            position += n;
+            return lanes[0];
+        });
+
+        measure ("interpolateFixedPhase", kernels.name, blockSize, [&] (int n) {
+            kernels.interpolateFixedPhase (buffer + (position & (BUFFER_LENGTH / 2 - 1)), 0.37f, out, n);
+            position += n;
+            return out[0];
+        });
+
+        const auto fade = makeNoise (MAX_BLOCK_SIZE, 3);
+
+        measure ("crossfade", kernels.name, blockSize, [&] (int n) {
+            const float* from = buffer + (position & (BUFFER_LENGTH / 2 - 1));
+            kernels.crossfade (from, from + MAX_BLOCK_SIZE, fade, out, n);
+            position += n;
+            return out[0];
+        });
+
+        juce::HeapBlock<uint16_t> halves (BUFFER_LENGTH);
+
+        for (int i = 0; i < BUFFER_LENGTH; ++i)
+            halves[i] = (uint16_t) (0x3800 + (i & 0x3ff));     // Between 0.5 and 1
+
+        measure ("halfToFloat", kernels.name, blockSize, [&] (int n) {
+            kernels.halfToFloat (halves + (position & (BUFFER_LENGTH / 2 - 1)), out, n);
+            position += n;
+            return out[0];
+        });
+
+        // The densest cloud of the longest grains. At 8 kHz that asks for about four grains
+        // a chunk, right at the per-chunk cap, and twice the pool, so both limits are hit
+        DelayLineStorage bufferLeft, bufferRight;
+        bufferLeft.allocate (BUFFER_LENGTH, DelayLineStorage::Format::float32, false);
+        bufferRight.allocate (BUFFER_LENGTH, DelayLineStorage::Format::float32, false);
+
+        for (int i = 0; i < BUFFER_LENGTH; ++i)
+        {
+            bufferLeft.write (i, buffer[i]);
+            bufferRight.write (i, buffer[BUFFER_LENGTH - 1 - i]);
+        }
+
+        GranularCloud cloud;
+        cloud.setKernels (kernels);
+        cloud.prepare (8000.0);
+
+        GranularCloud::Settings settings;
+        settings.density = GranularCloud::MAX_DENSITY;
+        settings.grainSeconds = GranularCloud::MAX_GRAIN_SECONDS;
+        settings.pitchSpread = GranularCloud::MAX_PITCH_SPREAD;
+        cloud.setSettings (settings);
+
+        juce::HeapBlock<float> outRight (MAX_BLOCK_SIZE);
+        uint32_t mostStarted = 0;
+        int mostPlaying = 0;
+
+        measure ("renderGrains (densest)", kernels.name, blockSize, [&] (int n) {
+            const uint32_t spawned = cloud.getNumSpawnedGrains();
+            std::fill (out.get(), out + n, 0.0f);
+            std::fill (outRight.get(), outRight + n, 0.0f);
+
+            cloud.process (bufferLeft, bufferRight, position & (BUFFER_LENGTH - 1), out, outRight, n, 8000.0f, 0.5f);
+
+            mostStarted = juce::jmax (mostStarted, cloud.getNumSpawnedGrains() - spawned);
+            mostPlaying = juce::jmax (mostPlaying, cloud.getNumActiveGrains());
+            position += n;
+            return out[0];
+        });
+
+        const int chunks = (blockSize + GranularCloud::CHUNK_SIZE - 1) / GranularCloud::CHUNK_SIZE;
+        const uint32_t maxStarted = (uint32_t) (GranularCloud::MAX_SPAWNS_PER_CHUNK * chunks);
+        const bool withinBound = mostStarted <= maxStarted && mostPlaying <= GranularCloud::MAX_GRAINS;
+
+        if (! withinBound)
+            std::cout << "FAIL renderGrains at " << blockSize << " samples: " << (int) mostStarted << " grains started in a block, at most "
+                      << (int) maxStarted << " allowed, " << mostPlaying << " playing, at most " << GranularCloud::MAX_GRAINS << std::endl;
+
+        return withinBound;
+    }
+
+    //==============================================================================
+    void runProcessBlock (KernelDispatch::Variant variant, int blockSize)
+    {
+        KernelDispatch::setOverride (variant);
+
+        DelaytutorialAudioProcessor processor;
+        TestSignals::setParameter (processor, "delaytime", 0.2f);
+        TestSignals::setParameter (processor, "lfodepth", 0.1f);
+        processor.setPlayConfigDetails (2, 2, 48000.0, blockSize);
+        processor.prepareToPlay (48000.0, blockSize);
+
+        const auto input = TestSignals::makeReferenceInput (48000.0, 0.6);
+        juce::AudioBuffer<float> block (2, blockSize);
+        juce::MidiBuffer midi;
+        int position = 0;
+
+        measure ("processBlock", KernelDispatch::get (variant).name, blockSize, [&] (int n) {
+            if (position + n > input.getNumSamples())
+                position = 0;
+            for (int channel = 0; channel < 2; ++channel)
+                block.copyFrom (channel, 0, input, channel, position, n);
+            processor.processBlock (block, midi);
+            position += n;
+            return block.getSample (0, 0);
+        });
+
+        processor.releaseResources();
+        KernelDispatch::clearOverride();
+    }
+
+    //==============================================================================
+    void runReadHeads (int length, bool pinned, int blockSize)
+    {
+        DelayLineStorage storage;
+
+        if (! storage.allocate (length, DelayLineStorage::Format::float32, pinned))
+        {
+            std::cout << "no memory for " << length << " samples" << std::endl;
+            return;
+        }
+
+        const auto noise = makeNoise (BUFFER_LENGTH, 4);
+
+        for (int i = 0; i < length; ++i)
+            storage.write (i, noise[i & (BUFFER_LENGTH - 1)]);
+
+        const auto& memory = storage.getMemory();
+        const char* build = ! memory.isPinned() ? "heap" : memory.usesHugePages() ? "huge" : "pinned";
+
+        // Heads at irregular spacings, moving a little slower than the write head like modulated lines
+        const int numHeads = 8;
+        double readHeads[numHeads];
+
+        for (int head = 0; head < numHeads; ++head)
+            readHeads[head] = std::fmod ((double) length * (0.11 + 0.1237 * head), (double) length);
+
+        juce::HeapBlock<float> out (MAX_BLOCK_SIZE);
+        const juce::String name = "readInterpolated, 2^" + juce::String (juce::roundToInt (std::log2 ((double) length)));
+
+        measure (name.toRawUTF8(), build, blockSize, [&] (int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                float sum = 0.0f;
+
+                for (int head = 0; head < numHeads; ++head)
+                {
+                    sum += storage.readInterpolated (readHeads[head]);
+                    readHeads[head] += 0.9993;
+                    if (readHeads[head] >= length)
+                        readHeads[head] -= length;
+                }
+
+                out[i] = sum;
+            }
+            return out[0];
+        });
+    }
+}
+
+//==============================================================================
+void KernelBenchmarks::runLongDelay()
+{
+    std::cout << juce::String ("read heads").paddedRight (' ', 24) << juce::String ("memory").paddedRight (' ', 10)
+              << juce::String ("block").paddedLeft (' ', 6) << juce::String ("ns/sample").paddedLeft (' ', 12)
+              << juce::String ("cycles").paddedLeft (' ', 12) << std::endl;
+
+    for (int length = BUFFER_LENGTH; length <= DelaytutorialAudioProcessor::MAX_LONG_DELAY_SAMPLES; length *= 4)
+        for (bool pinned : { false, true })
+            runReadHeads (length, pinned, 256);
+}
+
+bool KernelBenchmarks::run()
+{
+    std::cout << juce::String ("kernel").paddedRight (' ', 24) << juce::String ("build").paddedRight (' ', 10)
+              << juce::String ("block").paddedLeft (' ', 6) << juce::String ("ns/sample").paddedLeft (' ', 12)
+              << juce::String ("cycles").paddedLeft (' ', 12) << std::endl;
+
+    juce::Array<KernelDispatch::Variant> variants;
+
+    for (auto variant : { KernelDispatch::Variant::portable, KernelDispatch::Variant::avx2, KernelDispatch::Variant::avx512 })
+        if (KernelDispatch::isSupported (variant))
+            variants.add (variant);
+
+    for (int blockSize : BLOCK_SIZES)
+        runInlineKernels (blockSize);
+
+    bool withinBounds = true;
+
+    for (auto variant : variants)
+        for (int blockSize : BLOCK_SIZES)
+            withinBounds = runDispatchedKernels (variant, blockSize) && withinBounds;
+
+    for (auto variant : variants)
+        for (int blockSize : BLOCK_SIZES)
+            runProcessBlock (variant, blockSize);
+
+    return withinBounds;
+}
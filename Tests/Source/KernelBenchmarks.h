@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    KernelBenchmarks.h
+
+    Timings of each building block of processBlock on its own, and of
+    processBlock as a whole for comparison.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Every kernel runs on synthetic buffers at each of BLOCK_SIZES samples per
+    call, and the dispatched ones once per kernel build this CPU runs. A
+    measurement repeats the calls until they take MEASUREMENT_SECONDS and
+    keeps the fastest of NUM_MEASUREMENTS, so the table shows ns/sample and,
+    on Intel, time-stamp counter cycles/sample. The counter ticks at the
+    CPU's base clock, so with turbo on cycles read lower than core cycles.
+*/
+class KernelBenchmarks
+{
+public:
+    static constexpr int BLOCK_SIZES[] = { 16, 64, 256, 1024 };
+    static constexpr double MEASUREMENT_SECONDS = 0.02;
+    static const int NUM_MEASUREMENTS = 5;
+
+    /** Prints one row per kernel, build and block size. Returns false if the densest
+        grain cloud broke GranularCloud's bound on the grains a block may start or play.
+    */
+    static bool run();
+
+    /** Prints the cost of the read heads' interpolated reads against the delay buffer
+        length, up to DelaytutorialAudioProcessor::MAX_LONG_DELAY_SAMPLES, in heap and
+        in pinned memory. Eight heads spread over the buffer read a block each per call.
+    */
+    static void runLongDelay();
+};
@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    LayoutBenchmarks.cpp
+
+  ==============================================================================
+*/
+
+#include "LayoutBenchmarks.h"
+
+namespace
+{
+    struct Case
+    {
+        juce::String name;
+        int numInstances;
+        std::function<void (DelaytutorialAudioProcessor&)> configure;
+    };
+
+    void setAllTaps (DelaytutorialAudioProcessor& processor)
+    {
+        // Spread over the whole buffer, alternating sides
+        const float maxSeconds = (float) processor.getMaxDelaySeconds();
+
+        for (int index = 0; index < MultiTapDelay::MAX_TAPS; ++index)
+            processor.setTap (index, { maxSeconds * (float) (index + 1) / (MultiTapDelay::MAX_TAPS + 1),
+                                       1.0f / MultiTapDelay::MAX_TAPS, index % 2 == 0 ? -0.5f : 0.5f, 20000.0f });
+
+        processor.setMultiTap (true);
+    }
+
+    juce::Array<Case> getCases()
+    {
+        juce::Array<Case> cases;
+
+        cases.add ({ "default", 1, [] (DelaytutorialAudioProcessor&) {} });
+        cases.add ({ "default, session", LayoutBenchmarks::SESSION_INSTANCES, [] (DelaytutorialAudioProcessor&) {} });
+        cases.add ({ "64 taps", 1, setAllTaps });
+        cases.add ({ "64 taps, session", LayoutBenchmarks::SESSION_INSTANCES, setAllTaps });
+        cases.add ({ "64 taps, long buffer", 1, [] (DelaytutorialAudioProcessor& p) {
+            p.setLongDelayMode (true, LayoutBenchmarks::LONG_DELAY_SECONDS);
+            setAllTaps (p);
+        } });
+
+        return cases;
+    }
+
+    struct Format
+    {
+        const char* name;
+        DelayLineStorage::Format format;
+    };
+
+    const Format formats[] = { { "float32", DelayLineStorage::Format::float32 },
+                               { "float16", DelayLineStorage::Format::float16 },
+                               { "int16", DelayLineStorage::Format::int16 } };
+
+    /** Seconds per sample of one instance, the fastest of NUM_MEASUREMENTS. */
+    double measure (juce::OwnedArray<DelaytutorialAudioProcessor>& instances, const juce::AudioBuffer<float>& input)
+    {
+        juce::AudioBuffer<float> block (2, LayoutBenchmarks::BLOCK_SIZE);
+        juce::MidiBuffer midi;
+        int position = 0;
+
+        auto runCycle = [&] {
+            if (position + LayoutBenchmarks::BLOCK_SIZE > input.getNumSamples())
+                position = 0;
+
+            for (auto* instance : instances)
+            {
+                for (int channel = 0; channel < 2; ++channel)
+                    block.copyFrom (channel, 0, input, channel, position, LayoutBenchmarks::BLOCK_SIZE);
+
+                instance->processBlock (block, midi);
+            }
+
+            position += LayoutBenchmarks::BLOCK_SIZE;
+        };
+
+        // Calibrate the number of cycles per measurement
+        int numCycles = 1;
+
+        for (;;)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int cycle = 0; cycle < numCycles; ++cycle)
+                runCycle();
+
+            if (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) >= LayoutBenchmarks::MEASUREMENT_SECONDS)
+                break;
+
+            numCycles *= 2;
+        }
+
+        double bestSeconds = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < LayoutBenchmarks::NUM_MEASUREMENTS; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int cycle = 0; cycle < numCycles; ++cycle)
+                runCycle();
+
+            bestSeconds = juce::jmin (bestSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+        }
+
+        return bestSeconds / ((double) numCycles * LayoutBenchmarks::BLOCK_SIZE * instances.size());
+    }
+}
+
+//==============================================================================
+void LayoutBenchmarks::run()
+{
+    std::cout << juce::String ("case").paddedRight (' ', 24) << juce::String ("storage").paddedRight (' ', 10)
+              << juce::String ("layout").paddedRight (' ', 13) << juce::String ("memory MB").paddedLeft (' ', 10)
+              << juce::String ("ns/sample").paddedLeft (' ', 12) << juce::String ("vs float32").paddedLeft (' ', 12) << std::endl;
+
+    const auto input = TestSignals::makeReferenceInput (SAMPLE_RATE, 1.0);
+
+    for (const auto& testCase : getCases())
+    {
+        double referenceSeconds = 0.0;
+
+        for (const auto& format : formats)
+        {
+            for (bool interleaved : { false, true })
+            {
+                juce::OwnedArray<DelaytutorialAudioProcessor> instances;
+                size_t memoryBytes = 0;
+
+                for (int i = 0; i < testCase.numInstances; ++i)
+                {
+                    auto* processor = instances.add (new DelaytutorialAudioProcessor());
+                    TestSignals::setParameter (*processor, "delaytime", (float) MAX_DELAY_TIME);
+                    TestSignals::setParameter (*processor, "lfodepth", 0.1f);
+                    processor->setDelayStorageFormat (format.format);
+                    processor->setInterleavedDelayBuffers (interleaved);
+                    testCase.configure (*processor);
+                    processor->setPlayConfigDetails (2, 2, SAMPLE_RATE, BLOCK_SIZE);
+                    processor->prepareToPlay (SAMPLE_RATE, BLOCK_SIZE);
+                    memoryBytes += processor->getDelayMemoryBytes();
+                }
+
+                const double seconds = measure (instances, input);
+
+                if (format.format == DelayLineStorage::Format::float32 && ! interleaved)
+                    referenceSeconds = seconds;
+
+                std::cout << juce::String (testCase.name).paddedRight (' ', 24) << juce::String (format.name).paddedRight (' ', 10)
+                          << juce::String (interleaved ? "interleaved" : "split").paddedRight (' ', 13)
+                          << juce::String ((double) memoryBytes / (1024.0 * 1024.0), 1).paddedLeft (' ', 10)
+                          << juce::String (seconds * 1.0e9, 2).paddedLeft (' ', 12)
+                          << juce::String (seconds / referenceSeconds, 2).paddedLeft (' ', 11) << "x" << std::endl;
+
+                for (auto* instance : instances)
+                    instance->releaseResources();
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    LayoutBenchmarks.h
+
+    processBlock against the delay memory's storage format and layout, in
+    sessions small enough for the caches and too big for them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Every case runs once per storage format, with split and with interleaved
+    buffers. Its instances each take a block of BLOCK_SIZE samples in turn,
+    on one thread, at the longest delay time so the read heads spread over
+    the whole buffer. A measurement repeats that until it takes
+    MEASUREMENT_SECONDS and the fastest of NUM_MEASUREMENTS is kept.
+
+    A row shows the delay memory of all the case's instances together, the
+    time per sample of one instance, and that time against float32 storage
+    with split buffers in the same case. The session and long-buffer cases
+    hold more delay memory than a last-level cache, which is where the
+    16-bit formats and the interleaved layout should pay off.
+*/
+class LayoutBenchmarks
+{
+public:
+    static const int BLOCK_SIZE = 256;
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr double MEASUREMENT_SECONDS = 0.1;
+    static const int NUM_MEASUREMENTS = 5;
+    static const int SESSION_INSTANCES = 16;
+    static constexpr double LONG_DELAY_SECONDS = 120.0;
+
+    /** Prints one row per case, storage format and layout. */
+    static void run();
+};
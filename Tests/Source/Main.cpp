@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Command line front end of the tests and benchmarks.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "GoldenRenders.h"
+#include "InstanceBenchmarks.h"
+#include "KernelBenchmarks.h"
+#include "LayoutBenchmarks.h"
+#include "OnDemandMemoryChecks.h"
+#include "RealtimeSweeps.h"
+#include "SnapshotBenchmarks.h"
+#include "TruePeakChecks.h"
+#include "../../Source/TraceZones.h"
+
+namespace
+{
+    const char* const USAGE =
+        "Usage: delay-3-tests <command> [options]\n"
+        "\n"
+        "  --golden            Render every case in every variant and compare it with its golden file\n"
+        "    --update          Write the golden files instead, from the portable kernels\n"
+        "    --folder=<folder> Where the golden files are, Golden in the current folder by default\n"
+        "  --sweep             Sweep parameters, sample rates and presets with realtime safety checks\n"
+        "  --true-peak         Check that the output limiter holds true peaks under its ceiling\n"
+        "  --bench             Time each kernel of processBlock on its own, in ns and cycles per sample\n"
+        "  --instances         Run sessions of many instances on several threads, for throughput and tail latency\n"
+        "    --threads=<n>     Most threads to run them on, from 1 doubling up to one per CPU by default\n"
+        "  --long-delay        Time the read heads against the delay buffer length, in heap and pinned memory\n"
+        "  --layouts           Time processBlock in each storage format, with split and interleaved buffers\n"
+        "  --snapshot          Save and load state snapshots at 48 and 192 kHz, for size, time and continuity\n"
+        "  --on-demand         Check that on-demand delay memory is released after the tail, in every storage format\n"
+        "\n"
+        "  --trace=<file>      With any command, write its trace zones to the file as Chrome trace JSON.\n"
+        "                      Needs a build with DELAY_TRACING=1, such as the Tracing configuration\n"
+        "\n"
+        "Exits with 0 if every check passed.\n";
+
+    juce::File getFolder (const juce::ArgumentList& args, const juce::String& defaultName)
+    {
+        const juce::String folder = args.containsOption ("--folder") ? args.getValueForOption ("--folder") : defaultName;
+        return juce::File::getCurrentWorkingDirectory().getChildFile (folder);
+    }
+
+    int runCommand (const juce::ArgumentList& args)
+    {
+        if (args.containsOption ("--golden"))
+        {
+            GoldenRenders golden (getFolder (args, "Golden"));
+            return (args.containsOption ("--update") ? golden.update() : golden.check()) ? 0 : 1;
+        }
+
+        if (args.containsOption ("--sweep"))
+            return RealtimeSweeps::run() ? 0 : 1;
+
+        if (args.containsOption ("--true-peak"))
+            return TruePeakChecks::run() ? 0 : 1;
+
+        if (args.containsOption ("--bench"))
+            return KernelBenchmarks::run() ? 0 : 1;
+
+        if (args.containsOption ("--instances"))
+        {
+            const int numThreads = args.containsOption ("--threads") ? args.getValueForOption ("--threads").getIntValue()
+                                                                     : juce::SystemStats::getNumCpus();
+            InstanceBenchmarks::run (juce::jmax (1, numThreads));
+            return 0;
+        }
+
+        if (args.containsOption ("--long-delay"))
+        {
+            KernelBenchmarks::runLongDelay();
+            return 0;
+        }
+
+        if (args.containsOption ("--layouts"))
+        {
+            LayoutBenchmarks::run();
+            return 0;
+        }
+
+        if (args.containsOption ("--snapshot"))
+            return SnapshotBenchmarks::run() ? 0 : 1;
+
+        if (args.containsOption ("--on-demand"))
+            return OnDemandMemoryChecks::run() ? 0 : 1;
+
+        std::cout << USAGE;
+        return args.containsOption ("--help|-h") ? 0 : 2;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args (argc, argv);
+
+    const int result = runCommand (args);
+
+    if (args.containsOption ("--trace"))
+    {
+       #if DELAY_TRACING
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--trace"));
+
+        if (! TraceRecorder::getInstance().writeChromeTrace (file))
+        {
+            std::cout << "Couldn't write the trace to " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Wrote the trace to " << file.getFullPathName() << std::endl;
+       #else
+        std::cout << "This build records no trace zones, build it with DELAY_TRACING=1" << std::endl;
+        return 1;
+       #endif
+    }
+
+    return result;
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    OnDemandMemoryChecks.cpp
+
+  ==============================================================================
+*/
+
+#include "OnDemandMemoryChecks.h"
+
+namespace
+{
+    struct Case
+    {
+        const char* name;
+        DelayLineStorage::Format format;
+        float feedback;
+    };
+
+    // Float formats have no noise floor, so at high feedback they ring on for minutes as they should.
+    // The int16 dither would keep a high-feedback tail at one step for ever if nothing stopped it.
+    const Case cases[] = { { "float32", DelayLineStorage::Format::float32, 0.5f },
+                           { "float16", DelayLineStorage::Format::float16, 0.5f },
+                           { "int16", DelayLineStorage::Format::int16, 0.5f },
+                           { "int16", DelayLineStorage::Format::int16, 0.98f } };
+}
+
+//==============================================================================
+bool OnDemandMemoryChecks::run()
+{
+    const int inputSamples = juce::roundToInt (INPUT_SECONDS * SAMPLE_RATE);
+    const int numSamples = inputSamples + juce::roundToInt (TAIL_SECONDS * SAMPLE_RATE);
+    const auto input = TestSignals::makeReferenceInput (SAMPLE_RATE, INPUT_SECONDS);
+
+    int numFailed = 0;
+
+    for (const auto& testCase : cases)
+    {
+        DelaytutorialAudioProcessor processor;
+        TestSignals::setParameter (processor, "delaytime", (float) MAX_DELAY_TIME);
+        TestSignals::setParameter (processor, "feedback", testCase.feedback);
+        processor.setDelayStorageFormat (testCase.format);
+        processor.setOnDemandMemory (true);
+        processor.setPlayConfigDetails (2, 2, SAMPLE_RATE, BLOCK_SIZE);
+        processor.prepareToPlay (SAMPLE_RATE, BLOCK_SIZE);
+
+        juce::AudioBuffer<float> block (2, BLOCK_SIZE);
+        juce::MidiBuffer midi;
+        bool tookMemory = false;
+        int releasedAt = -1;
+
+        for (int position = 0; position < numSamples && releasedAt < 0; position += BLOCK_SIZE)
+        {
+            block.clear();
+
+            if (position < inputSamples)
+                for (int channel = 0; channel < 2; ++channel)
+                    block.copyFrom (channel, 0, input, channel, position, juce::jmin ((int) BLOCK_SIZE, inputSamples - position));
+
+            processor.processBlock (block, midi);
+
+            if (processor.hasDelayMemory())
+                tookMemory = true;
+            else if (tookMemory)
+                releasedAt = position + BLOCK_SIZE;
+        }
+
+        const bool passed = tookMemory && releasedAt >= 0;
+
+        if (! passed)
+            ++numFailed;
+
+        std::cout << (passed ? "ok   " : "FAIL ") << testCase.name << ", feedback " << testCase.feedback << ": "
+                  << (! tookMemory ? juce::String ("never took memory")
+                                   : releasedAt < 0 ? "still holds memory after " + juce::String (TAIL_SECONDS, 0) + " s of silence"
+                                                    : "released " + juce::String ((releasedAt - inputSamples) / SAMPLE_RATE, 2) + " s into the silence")
+                  << std::endl;
+
+        processor.releaseResources();
+    }
+
+    std::cout << (numFailed == 0 ? "Every instance released its delay memory" : juce::String (numFailed) + " instances kept their delay memory") << std::endl;
+    return numFailed == 0;
+}
@@ -0,0 +1,36 @@
+/*
+  ==============================================================================
+
+    OnDemandMemoryChecks.h
+
+    Checks that an instance with on-demand memory gives its delay memory
+    back once the feedback tail has died away, in every storage format.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Each case runs the reference input and then TAIL_SECONDS of silence
+    through an instance with on-demand memory, at the longest delay time and
+    in one storage format and feedback setting. A case passes if the instance
+    took delay memory for the input and released it during the silence. The
+    tail is long enough for int16 storage at the highest feedback to decay to
+    silence and then for a whole buffer length of silent writes.
+*/
+class OnDemandMemoryChecks
+{
+public:
+    static const int BLOCK_SIZE = 512;
+    static constexpr double SAMPLE_RATE = 48000.0;
+    static constexpr double INPUT_SECONDS = 0.6;
+    static constexpr double TAIL_SECONDS = 60.0;
+
+    /** Prints a line per case. True if every instance released its memory. */
+    static bool run();
+};
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    RealtimeSweeps.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSweeps.h"
+
+namespace
+{
+    juce::MemoryBlock makeState (const RealtimeSweeps::Preset& preset)
+    {
+        DelaytutorialAudioProcessor processor;
+        preset.configure (processor);
+
+        juce::MemoryBlock state;
+        processor.getStateInformation (state);
+        return state;
+    }
+
+    /** Runs blocks of noise through the processor with every parameter on a sweep. */
+    void sweep (DelaytutorialAudioProcessor& processor, juce::Random& random, int& blockCount)
+    {
+        const auto& parameters = processor.getParameters();
+        juce::AudioBuffer<float> block (2, RealtimeSweeps::MAX_BLOCK_SIZE);
+        juce::MidiBuffer midi;
+
+        for (int i = 0; i < RealtimeSweeps::BLOCKS_PER_PRESET; ++i)
+        {
+            const double position = (double) i / RealtimeSweeps::BLOCKS_PER_PRESET;
+
+            for (int index = 0; index < parameters.size(); ++index)
+                parameters[index]->setValue ((float) (0.5 + 0.5 * std::sin (2.0 * M_PI * position * (index + 1))));
+
+            const int numSamples = 1 + random.nextInt (RealtimeSweeps::MAX_BLOCK_SIZE);
+            block.setSize (2, numSamples, false, false, true);
+
+            for (int channel = 0; channel < 2; ++channel)
+                for (int sample = 0; sample < numSamples; ++sample)
+                    block.setSample (channel, sample, 0.5f * (random.nextFloat() * 2.0f - 1.0f));
+
+            processor.processBlock (block, midi);
+            ++blockCount;
+        }
+    }
+}
+
+//==============================================================================
+juce::Array<RealtimeSweeps::Preset> RealtimeSweeps::getPresets()
+{
+    juce::Array<Preset> presets;
+
+    presets.add ({ "default", [] (DelaytutorialAudioProcessor&) {} });
+
+    presets.add ({ "eco tier, automatic", [] (DelaytutorialAudioProcessor& p) {
+        p.setQualityTier (QualityTier::eco);
+        p.setAutomaticQuality (true);
+    } });
+
+    presets.add ({ "high tier, float16, interleaved", [] (DelaytutorialAudioProcessor& p) {
+        p.setQualityTier (QualityTier::high);
+        p.setDelayStorageFormat (DelayLineStorage::Format::float16);
+        p.setInterleavedDelayBuffers (true);
+    } });
+
+    presets.add ({ "spectral, frozen", [] (DelaytutorialAudioProcessor& p) {
+        p.setDelayEngine (DelaytutorialAudioProcessor::DelayEngine::spectral);
+        p.setSpectralBand (3, 0.5f, 1.2f);
+        p.setSpectralFreeze (true);
+    } });
+
+    presets.add ({ "on-demand memory", [] (DelaytutorialAudioProcessor& p) {
+        p.setOnDemandMemory (true);
+    } });
+
+    presets.add ({ "fixed rate, limiter", [] (DelaytutorialAudioProcessor& p) {
+        p.setFixedInternalRate (true);
+        p.setOutputLimiter (true);
+    } });
+
+    presets.add ({ "long delay", [] (DelaytutorialAudioProcessor& p) {
+        p.setLongDelayMode (true, 30.0);
+    } });
+
+    presets.add ({ "multi-tap, granular", [] (DelaytutorialAudioProcessor& p) {
+        for (int index = 0; index < 4; ++index)
+            p.setTap (index, { 0.05f + 0.1f * (float) index, 0.5f, index % 2 == 0 ? -0.5f : 0.5f, 8000.0f });
+
+        p.setMultiTap (true);
+        p.setGranular (true);
+    } });
+
+    presets.add ({ "state snapshot", [] (DelaytutorialAudioProcessor& p) {
+        p.setStateSnapshot (true);
+        p.setPlayConfigDetails (2, 2, 48000.0, MAX_BLOCK_SIZE);
+        p.prepareToPlay (48000.0, MAX_BLOCK_SIZE);
+    } });
+
+    return presets;
+}
+
+bool RealtimeSweeps::run()
+{
+   #if ! DELAY_REALTIME_CHECKS
+    std::cout << "This build doesn't define DELAY_REALTIME_CHECKS=1, so nothing would be checked" << std::endl;
+    return false;
+   #else
+    juce::Array<Preset> presets = getPresets();
+    juce::Array<juce::MemoryBlock> states;
+
+    for (auto& preset : presets)
+        states.add (makeState (preset));
+
+    // Offline renders are only checked when the build asks for it
+    const int numModes = DELAY_REALTIME_CHECKS_OFFLINE ? 2 : 1;
+    juce::Random random (44);
+
+    for (double sampleRate : SAMPLE_RATES)
+    {
+        for (int mode = 0; mode < numModes; ++mode)
+        {
+            const bool offline = mode == 1;
+            DelaytutorialAudioProcessor processor;
+            processor.setNonRealtime (offline);
+            processor.setPlayConfigDetails (2, 2, sampleRate, MAX_BLOCK_SIZE);
+            processor.prepareToPlay (sampleRate, MAX_BLOCK_SIZE);
+
+            int blockCount = 0;
+
+            // Back to the first at the end, so every preset is switched both to and from
+            for (int index = 0; index <= presets.size(); ++index)
+            {
+                const auto& state = states.getReference (index % presets.size());
+                processor.setStateInformation (state.getData(), (int) state.getSize());
+                sweep (processor, random, blockCount);
+            }
+
+            processor.releaseResources();
+
+            std::cout << "ok   " << juce::String (sampleRate, 0) << " Hz, " << (offline ? "offline" : "realtime")
+                      << ": " << blockCount << " checked blocks over " << presets.size() << " presets" << std::endl;
+        }
+    }
+
+    std::cout << "No realtime safety violations" << std::endl;
+    return true;
+   #endif
+}
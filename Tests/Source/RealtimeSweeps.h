@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    RealtimeSweeps.h
+
+    Drives the processor through parameter sweeps, sample rate changes and
+    preset switches in a realtime-checking build, see RealtimeSafety.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Every preset is a state from getStateInformation, loaded with
+    setStateInformation between blocks the way a host switches presets.
+    After each switch every parameter is swept along its own sine for
+    BLOCKS_PER_PRESET blocks of random sizes up to MAX_BLOCK_SIZE, so
+    values cross and come back at different rates. The whole run repeats
+    at each of SAMPLE_RATES, prepared afresh, and offline as well when
+    DELAY_REALTIME_CHECKS_OFFLINE is set.
+
+    Nothing is compared: a checking build aborts with a backtrace at the
+    first allocation, lock or blocking call inside processBlock, so
+    reaching the end is the pass. Without DELAY_REALTIME_CHECKS nothing
+    would be checked, and the run fails straight away.
+*/
+class RealtimeSweeps
+{
+public:
+    static constexpr double SAMPLE_RATES[] = { 44100.0, 48000.0, 96000.0 };
+    static const int MAX_BLOCK_SIZE = 512;
+    static const int BLOCKS_PER_PRESET = 120;
+
+    struct Preset
+    {
+        juce::String name;
+        std::function<void (DelaytutorialAudioProcessor&)> configure;
+    };
+
+    static juce::Array<Preset> getPresets();
+
+    /** Prints a line per sample rate and mode. True if the build checks and it got through. */
+    static bool run();
+};
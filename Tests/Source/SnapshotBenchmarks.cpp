@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    SnapshotBenchmarks.cpp
+
+  ==============================================================================
+*/
+
+#include "SnapshotBenchmarks.h"
+
+namespace
+{
+    struct Case
+    {
+        juce::String name;
+        std::function<void (DelaytutorialAudioProcessor&)> configure;
+    };
+
+    juce::Array<Case> getCases()
+    {
+        using TestSignals::setParameter;
+        juce::Array<Case> cases;
+
+        cases.add ({ "delay lines", [] (DelaytutorialAudioProcessor& p) {
+            setParameter (p, "delaytime", 0.2f);
+            setParameter (p, "feedback", 0.8f);
+        } });
+
+        cases.add ({ "multi-tap, granular", [] (DelaytutorialAudioProcessor& p) {
+            setParameter (p, "delaytime", 0.2f);
+
+            for (int index = 0; index < 4; ++index)
+                p.setTap (index, { 0.05f + 0.1f * (float) index, 0.5f, index % 2 == 0 ? -0.5f : 0.5f, 8000.0f });
+
+            p.setMultiTap (true);
+            p.setGranular (true);
+        } });
+
+        cases.add ({ "int16 storage", [] (DelaytutorialAudioProcessor& p) {
+            setParameter (p, "delaytime", 0.2f);
+            p.setDelayStorageFormat (DelayLineStorage::Format::int16);
+        } });
+
+        cases.add ({ "spectral", [] (DelaytutorialAudioProcessor& p) {
+            p.setDelayEngine (DelaytutorialAudioProcessor::DelayEngine::spectral);
+        } });
+
+        return cases;
+    }
+
+    /** Runs samples from start on through the processor, into output if given. */
+    void process (DelaytutorialAudioProcessor& processor, const juce::AudioBuffer<float>& input, int start, int numSamples,
+                  juce::AudioBuffer<float>* output)
+    {
+        juce::AudioBuffer<float> block (2, SnapshotBenchmarks::BLOCK_SIZE);
+        juce::MidiBuffer midi;
+
+        for (int position = 0; position < numSamples; position += SnapshotBenchmarks::BLOCK_SIZE)
+        {
+            const int blockSamples = juce::jmin ((int) SnapshotBenchmarks::BLOCK_SIZE, numSamples - position);
+            block.setSize (2, blockSamples, false, false, true);
+
+            for (int channel = 0; channel < 2; ++channel)
+                block.copyFrom (channel, 0, input, channel, start + position, blockSamples);
+
+            processor.processBlock (block, midi);
+
+            if (output != nullptr)
+                for (int channel = 0; channel < 2; ++channel)
+                    output->copyFrom (channel, position, block, channel, 0, blockSamples);
+        }
+    }
+
+    template <typename Body>
+    double measureSeconds (Body&& body)
+    {
+        double bestSeconds = std::numeric_limits<double>::max();
+
+        for (int i = 0; i < SnapshotBenchmarks::NUM_MEASUREMENTS; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            body();
+            bestSeconds = juce::jmin (bestSeconds, juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start));
+        }
+
+        return bestSeconds;
+    }
+}
+
+//==============================================================================
+bool SnapshotBenchmarks::run()
+{
+    std::cout << juce::String ("case").paddedRight (' ', 24) << juce::String ("rate").paddedLeft (' ', 8)
+              << juce::String ("state KB").paddedLeft (' ', 12) << juce::String ("save ms").paddedLeft (' ', 10)
+              << juce::String ("load ms").paddedLeft (' ', 10) << juce::String ("difference").paddedLeft (' ', 14) << std::endl;
+
+    int numFailed = 0;
+
+    for (double sampleRate : { 48000.0, 192000.0 })
+    {
+        const int settleSamples = juce::roundToInt (SETTLE_SECONDS * sampleRate);
+        const int continueSamples = juce::roundToInt (CONTINUE_SECONDS * sampleRate);
+        const auto input = TestSignals::makeReferenceInput (sampleRate, SETTLE_SECONDS + CONTINUE_SECONDS);
+
+        for (const auto& testCase : getCases())
+        {
+            DelaytutorialAudioProcessor saved, loaded;
+
+            for (auto* processor : { &saved, &loaded })
+            {
+                processor->setStateSnapshot (true);
+                testCase.configure (*processor);
+                processor->setPlayConfigDetails (2, 2, sampleRate, BLOCK_SIZE);
+                processor->prepareToPlay (sampleRate, BLOCK_SIZE);
+            }
+
+            process (saved, input, 0, settleSamples, nullptr);
+
+            juce::MemoryBlock state;
+            const double saveSeconds = measureSeconds ([&] {
+                state.reset();
+                saved.getStateInformation (state);
+            });
+
+            const double loadSeconds = measureSeconds ([&] {
+                loaded.setStateInformation (state.getData(), (int) state.getSize());
+            });
+
+            juce::AudioBuffer<float> expected (2, continueSamples), actual (2, continueSamples);
+            process (saved, input, settleSamples, continueSamples, &expected);
+            process (loaded, input, settleSamples, continueSamples, &actual);
+
+            const auto difference = TestSignals::compare (expected, actual);
+            const bool passed = difference.maxDifference <= TOLERANCE;
+
+            std::cout << juce::String (testCase.name).paddedRight (' ', 24)
+                      << juce::String (juce::roundToInt (sampleRate / 1000.0)).paddedLeft (' ', 6) << "k"
+                      << juce::String ((double) state.getSize() / 1024.0, 1).paddedLeft (' ', 13)
+                      << juce::String (saveSeconds * 1000.0, 2).paddedLeft (' ', 10)
+                      << juce::String (loadSeconds * 1000.0, 2).paddedLeft (' ', 10)
+                      << juce::String (difference.maxDifference, 8).paddedLeft (' ', 14)
+                      << (passed ? "" : "  FAIL") << std::endl;
+
+            if (! passed)
+                ++numFailed;
+
+            saved.releaseResources();
+            loaded.releaseResources();
+        }
+    }
+
+    std::cout << (numFailed == 0 ? "Every loaded snapshot carries on" : juce::String (numFailed) + " loaded snapshots went their own way") << std::endl;
+    return numFailed == 0;
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    SnapshotBenchmarks.h
+
+    Size and speed of saving and loading the state with a snapshot of the
+    running engine, and whether the loaded engine carries on where the
+    saved one was.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TestSignals.h"
+
+//==============================================================================
+/**
+    Each case runs SETTLE_SECONDS of the reference input through one
+    instance at 48 and 192 kHz. It then saves the state with its snapshot
+    and loads it into a second instance that is already playing. The table
+    shows the size of the state and the fastest of NUM_MEASUREMENTS saves
+    and loads. A case passes if both instances then render the next
+    CONTINUE_SECONDS within TOLERANCE of each other.
+*/
+class SnapshotBenchmarks
+{
+public:
+    static const int BLOCK_SIZE = 512;
+    static const int NUM_MEASUREMENTS = 5;
+    static constexpr double SETTLE_SECONDS = 1.0;
+    static constexpr double CONTINUE_SECONDS = 0.5;
+    static constexpr float TOLERANCE = 1.0e-6f;
+
+    /** Prints a row per case and rate. True if every loaded instance carried on. */
+    static bool run();
+};
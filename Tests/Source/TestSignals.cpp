@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    TestSignals.cpp
+
+  ==============================================================================
+*/
+
+#include "TestSignals.h"
+
+//==============================================================================
+juce::AudioBuffer<float> TestSignals::makeReferenceInput (double sampleRate, double seconds)
+{
+    const int length = (int) (seconds * sampleRate);
+    juce::AudioBuffer<float> input (2, length);
+    input.clear();
+
+    float* left = input.getWritePointer (0);
+
+    // Impulse at the start
+    left[0] = 0.8f;
+
+    // Sweep from 0.05 to 0.35 s, with the phase integrated in double precision
+    const int sweepStart = (int) (0.05 * sampleRate);
+    const int sweepLength = (int) (0.3 * sampleRate);
+    const double startFrequency = 20.0, endFrequency = 20000.0;
+    const double ratio = std::log (endFrequency / startFrequency);
+    double phase = 0.0;
+
+    for (int i = 0; i < sweepLength && sweepStart + i < length; ++i)
+    {
+        const double frequency = startFrequency * std::exp (ratio * i / sweepLength);
+        left[sweepStart + i] = 0.5f * (float) std::sin (phase);
+        phase += 2.0 * M_PI * frequency / sampleRate;
+    }
+
+    // Noise burst from 0.45 to 0.5 s
+    juce::Random random (0x5eed);
+    const int noiseStart = (int) (0.45 * sampleRate);
+    const int noiseLength = (int) (0.05 * sampleRate);
+
+    for (int i = 0; i < noiseLength && noiseStart + i < length; ++i)
+        left[noiseStart + i] = 0.4f * (random.nextFloat() * 2.0f - 1.0f);
+
+    input.copyFrom (1, 0, input, 0, 0, length);
+    input.applyGain (1, 0, length, 0.7f);
+    return input;
+}
+
+juce::AudioBuffer<float> TestSignals::render (DelaytutorialAudioProcessor& processor, const juce::AudioBuffer<float>& input,
+                                              double sampleRate, int blockSize, double* processSeconds)
+{
+    processor.setPlayConfigDetails (2, 2, sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+
+    const int length = input.getNumSamples();
+    juce::AudioBuffer<float> output (2, length);
+    juce::AudioBuffer<float> block (2, blockSize);
+    juce::MidiBuffer midi;
+    juce::int64 processTicks = 0;
+
+    // Whole blocks only, the input padded with silence past its end
+    for (int position = 0; position < length; position += blockSize)
+    {
+        const int numSamples = juce::jmin (blockSize, length - position);
+        block.clear();
+
+        for (int channel = 0; channel < 2; ++channel)
+            block.copyFrom (channel, 0, input, channel, position, numSamples);
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        processor.processBlock (block, midi);
+        processTicks += juce::Time::getHighResolutionTicks() - startTicks;
+
+        for (int channel = 0; channel < 2; ++channel)
+            output.copyFrom (channel, position, block, channel, 0, numSamples);
+    }
+
+    processor.releaseResources();
+
+    if (processSeconds != nullptr)
+        *processSeconds = juce::Time::highResolutionTicksToSeconds (processTicks);
+
+    return output;
+}
+
+void TestSignals::setParameter (DelaytutorialAudioProcessor& processor, const juce::String& parameterID, float value)
+{
+    for (auto* parameter : processor.getParameters())
+    {
+        auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*> (parameter);
+
+        if (withID == nullptr || withID->paramID != parameterID)
+            continue;
+
+        if (auto* floatParameter = dynamic_cast<juce::AudioParameterFloat*> (parameter))
+            *floatParameter = value;
+        else if (auto* boolParameter = dynamic_cast<juce::AudioParameterBool*> (parameter))
+            *boolParameter = value >= 0.5f;
+        else if (auto* choiceParameter = dynamic_cast<juce::AudioParameterChoice*> (parameter))
+            *choiceParameter = juce::roundToInt (value);
+        else if (auto* intParameter = dynamic_cast<juce::AudioParameterInt*> (parameter))
+            *intParameter = juce::roundToInt (value);
+
+        return;
+    }
+
+    jassertfalse;   // No parameter with that ID
+}
+
+float TestSignals::getParameter (DelaytutorialAudioProcessor& processor, const juce::String& parameterID)
+{
+    for (auto* parameter : processor.getParameters())
+    {
+        auto* floatParameter = dynamic_cast<juce::AudioParameterFloat*> (parameter);
+
+        if (floatParameter != nullptr && floatParameter->paramID == parameterID)
+            return floatParameter->get();
+    }
+
+    jassertfalse;   // No float parameter with that ID
+    return 0.0f;
+}
+
+TestSignals::Difference TestSignals::compare (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+{
+    jassert (a.getNumChannels() == b.getNumChannels() && a.getNumSamples() == b.getNumSamples());
+    Difference difference;
+    double sumOfSquares = 0.0;
+
+    for (int channel = 0; channel < a.getNumChannels(); ++channel)
+    {
+        const float* x = a.getReadPointer (channel);
+        const float* y = b.getReadPointer (channel);
+
+        for (int i = 0; i < a.getNumSamples(); ++i)
+        {
+            const float d = std::abs (x[i] - y[i]);
+            sumOfSquares += (double) d * d;
+
+            if (d > difference.maxDifference)
+                difference = { d, channel, i };
+        }
+    }
+
+    difference.rmsDifference = (float) std::sqrt (sumOfSquares / juce::jmax (1, a.getNumChannels() * a.getNumSamples()));
+    return difference;
+}
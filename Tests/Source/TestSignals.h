@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    TestSignals.h
+
+    Inputs and render loops shared by the test and benchmark commands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace TestSignals
+{
+    /** An impulse, a logarithmic sine sweep from 20 Hz to 20 kHz and a burst of
+        white noise, then silence for the tail. The right channel is the left at
+        0.7 times the level. The noise comes from a fixed juce::Random seed, so
+        the input is the same on every platform.
+    */
+    juce::AudioBuffer<float> makeReferenceInput (double sampleRate, double seconds);
+
+    /** Prepares the processor and runs the input through it in blocks of blockSize,
+        the last one padded with silence. Returns the output, and the time the
+        processBlock calls took in processSeconds if given.
+    */
+    juce::AudioBuffer<float> render (DelaytutorialAudioProcessor& processor, const juce::AudioBuffer<float>& input,
+                                     double sampleRate, int blockSize, double* processSeconds = nullptr);
+
+    /** Sets the parameter with the given ID, in its own units. Asserts if there is none. */
+    void setParameter (DelaytutorialAudioProcessor& processor, const juce::String& parameterID, float value);
+
+    /** The value of the float parameter with the given ID, in its own units. Asserts if there is none. */
+    float getParameter (DelaytutorialAudioProcessor& processor, const juce::String& parameterID);
+
+    /** Largest difference between two buffers of the same size, where it is, and the
+        RMS of the difference over both channels.
+    */
+    struct Difference
+    {
+        float maxDifference = 0.0f;
+        int channel = 0;
+        int sample = 0;
+        float rmsDifference = 0.0f;
+    };
+
+    Difference compare (const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b);
+}
@@ -0,0 +1,158 @@
+/*
+  ==============================================================================
+
+    TruePeakChecks.cpp
+
+  ==============================================================================
+*/
+
+#include "TruePeakChecks.h"
+
+namespace
+{
+    struct Signal
+    {
+        juce::String name;
+        std::function<float (int, double)> generate;    // Sample n at the rate
+    };
+
+    juce::Array<Signal> getSignals()
+    {
+        juce::Array<Signal> signals;
+
+        // Sampled 45 degrees either side of each peak at a quarter of the rate, 3 dB under it
+        for (double frequency : { 997.0, 5000.0, 0.0, 15000.0, 18000.0, 20000.0 })
+        {
+            const juce::String name = frequency == 0.0 ? "sine fs/4" : "sine " + juce::String (frequency, 0) + " Hz";
+
+            for (double phase : { 0.0, 0.25, 0.5 })
+            {
+                signals.add ({ name + ", phase " + juce::String (phase), [frequency, phase] (int n, double sampleRate) {
+                    const double f = frequency == 0.0 ? sampleRate / 4.0 : frequency;
+                    return (float) (2.0 * std::sin (2.0 * M_PI * f * n / sampleRate + M_PI * phase));
+                } });
+            }
+        }
+
+        signals.add ({ "clipped square 997 Hz", [] (int n, double sampleRate) {
+            return (float) juce::jlimit (-1.5, 1.5, 8.0 * std::sin (2.0 * M_PI * 997.0 * n / sampleRate));
+        } });
+
+        signals.add ({ "white noise", [] (int n, double) {
+            // A hash of n, so every call gives the same sample
+            uint32_t x = (uint32_t) n * 2654435761u;
+            x ^= x >> 15; x *= 2246822519u; x ^= x >> 13;
+            return (float) (4.0 * ((double) x / 4294967295.0 - 0.5));
+        } });
+
+        return signals;
+    }
+
+    double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+float TruePeakChecks::measureTruePeak (const float* samples, int numSamples)
+{
+    const int half = REFERENCE_TAPS / 2;
+    const double beta = 10.0;
+
+    // Phase 0 is the samples themselves, the others interpolate between sample n and n + 1
+    std::vector<std::vector<double>> phases;
+
+    for (int phase = 1; phase < REFERENCE_OVERSAMPLING; ++phase)
+    {
+        const double fraction = (double) phase / REFERENCE_OVERSAMPLING;
+        std::vector<double> taps;
+
+        for (int tap = -half; tap <= half; ++tap)
+        {
+            const double x = tap - fraction;
+            const double ratio = x / (half + 1);
+            const double window = besselI0 (beta * std::sqrt (std::max (0.0, 1.0 - ratio * ratio))) / besselI0 (beta);
+            taps.push_back (std::sin (M_PI * x) / (M_PI * x) * window);
+        }
+
+        phases.push_back (taps);
+    }
+
+    double peak = 0.0;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        peak = std::max (peak, (double) std::abs (samples[n]));
+
+        if (n < half || n + half + 1 >= numSamples)
+            continue;
+
+        for (auto& taps : phases)
+        {
+            double sum = 0.0;
+
+            for (int tap = -half; tap <= half; ++tap)
+                sum += samples[n + tap] * taps[(size_t) (tap + half)];
+
+            peak = std::max (peak, std::abs (sum));
+        }
+    }
+
+    return (float) peak;
+}
+
+bool TruePeakChecks::run()
+{
+    bool allPassed = true;
+
+    for (double sampleRate : { 44100.0, 48000.0 })
+    {
+        for (auto& signal : getSignals())
+        {
+            const int numSamples = (int) (SIGNAL_SECONDS * sampleRate);
+            juce::AudioBuffer<float> buffer (2, numSamples);
+
+            for (int n = 0; n < numSamples; ++n)
+            {
+                buffer.setSample (0, n, signal.generate (n, sampleRate));
+                buffer.setSample (1, n, 0.5f * signal.generate (n + 7, sampleRate));
+            }
+
+            const float inputPeak = measureTruePeak (buffer.getReadPointer (0), numSamples);
+
+            OutputLimiter limiter;
+            limiter.prepare (sampleRate, 512);
+
+            for (int start = 0; start < numSamples; start += 512)
+            {
+                const int length = std::min (512, numSamples - start);
+                limiter.process (buffer.getWritePointer (0, start), buffer.getWritePointer (1, start), length);
+            }
+
+            float outputPeak = 0.0f;
+
+            for (int channel = 0; channel < 2; ++channel)
+                outputPeak = std::max (outputPeak, measureTruePeak (buffer.getReadPointer (channel), numSamples));
+
+            const double overDb = juce::Decibels::gainToDecibels (outputPeak / OutputLimiter::CEILING, -200.0f);
+            const bool passed = overDb <= TOLERANCE_DB;
+            allPassed = allPassed && passed;
+
+            std::cout << (passed ? "ok   " : "FAIL ") << signal.name << " at " << juce::String (sampleRate, 0)
+                      << " Hz: input " << juce::String (juce::Decibels::gainToDecibels (inputPeak), 2)
+                      << " dBTP, output " << juce::String (overDb, 3) << " dB against the ceiling" << std::endl;
+        }
+    }
+
+    std::cout << (allPassed ? "The limiter holds every true peak" : "Some true peaks came over the ceiling") << std::endl;
+    return allPassed;
+}